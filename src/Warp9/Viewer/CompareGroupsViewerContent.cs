@@ -40,6 +40,8 @@ namespace Warp9.Viewer
         SpecimenTableSelection selectionA, selectionB;
         PointCloud? pclA = null;
         Mesh? meshB = null;
+        SearchContext? meshBGrid = null;
+        Mesh? meshBGridSource = null;
         int regIndex = 0;
         CompareGroupsSideBar sidebar;
 
@@ -67,6 +69,15 @@ namespace Warp9.Viewer
             base.AttachRenderer(renderer);
         }
 
+        public override void DetachRenderer()
+        {
+            meshBGrid?.Dispose();
+            meshBGrid = null;
+            meshBGridSource = null;
+
+            base.DetachRenderer();
+        }
+
         public override Page? GetSidebar()
         {
             return sidebar;
@@ -122,6 +133,28 @@ namespace Warp9.Viewer
             UpdateMappedField(true);
         }
 
+        // The trigrid on meshB is kept for as long as meshB stays the same.
+        private SearchContext? GetMeshBGrid()
+        {
+            if (meshB is null)
+                return null;
+
+            if (meshBGrid is null || !ReferenceEquals(meshBGridSource, meshB))
+            {
+                meshBGrid?.Dispose();
+                meshBGrid = null;
+                meshBGridSource = null;
+
+                if (SearchContext.TryInitTrigrid(meshB, 16, out SearchContext? grid) == WarpCoreStatus.WCORE_OK)
+                {
+                    meshBGrid = grid;
+                    meshBGridSource = meshB;
+                }
+            }
+
+            return meshBGrid;
+        }
+
         public void SwapGroups()
         {
             SpecimenTableSelection selT = selectionA;
@@ -240,6 +273,17 @@ namespace Warp9.Viewer
                     case 5: // log10 triangle expansion
                         HomoMeshDiff.FaceScalingFactor(field.AsSpan(), meshMean, pclA, meshB, true);
                         break;
+
+                    case 6: // nearest surface distance
+                    case 7: // signed nearest surface distance
+                        if (!HomoMeshDiff.MeshSurfaceDistance(field.AsSpan(), pclA, meshB, mappedFieldIndex == 7, 
+                            out _, GetMeshBGrid()))
+                        {
+                            sidebar?.SetInfoText("Surface distance could not be computed.");
+                            AttributeField = null;
+                            return;
+                        }
+                        break;
                 }
 
                 AttributeField = field;
@@ -46,7 +46,8 @@ namespace Warp9.Viewer
         {
             "Vertex distance", "Signed vertex distance",
             "Surface distance", "Signed surface distance",
-            "Triangle expansion", "Log10 triangle expansion"
+            "Triangle expansion", "Log10 triangle expansion",
+            "Nearest surface distance", "Signed nearest surface distance"
         };
 
         public List<string> MappedFieldsList => mappedFieldsList;
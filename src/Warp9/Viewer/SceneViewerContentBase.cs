@@ -49,7 +49,7 @@ namespace Warp9.Viewer
             sceneRend.Scene = scene;
         }
 
-        public void DetachRenderer()
+        public virtual void DetachRenderer()
         {
             if (sceneRend is not null)
             {
@@ -15,7 +15,8 @@ enum WCORE_STATUS {
     WCORE_INVALID_ARGUMENT = -1,
     WCORE_INVALID_DIMENSION = -2,
     WCORE_NONCONVERGENCE = -3,
-    WCORE_INVALID_DATA = -4
+    WCORE_INVALID_DATA = -4,
+    WCORE_IO_ERROR = -5
 };
 
 struct rigid3 {
@@ -1,33 +1,38 @@
 #include "gpa.h"
 #include "impl/gpa_impl.h"
+#include "impl/icp_impl.h"
 #include "impl/pcl_utils.h"
+#include <algorithm>
 #include <cfloat>
 #include <cstring>
 #include <memory>
 
 #include <iostream>
 
-extern "C" int gpa_fit(const void** data, const void* allow, int d, int n, int m, rigid3* xforms, void* mean, gparesult* res)
+// GPA iterations starting from the given mean. Returns the number of passes, maxit if it did not converge.
+static int gpa_iterate(const float** data, const void* allow, int d, int n, int m, int maxit, float tol, bool accel, rigid3* xforms, float* mean, float* err, float* last_err)
 {
-    constexpr int MAX_IT = 150;
-    constexpr float TOL_REL = 1e-5f;
+    constexpr int ANDERSON_DEPTH = 5;
 
-    if(d != 3 || m < 4 || xforms == NULL)
-        return WCORE_INVALID_ARGUMENT;
+    // Accelerated iterations do not decrease the error monotonically, stalling is only reported
+    // after it has not improved for a few of them.
+    constexpr int ANDERSON_PATIENCE = 3;
 
     float* temp_mean = new float[d * m];
-    float* m1 = (float*)mean;
+    float* m1 = mean;
     float* m2 = temp_mean;
 
-    warpcore::impl::gpa_init_mean((const float*)data[0], d, m, m1);
-    int it = 0;
-    float err = 1;
-    while(it < MAX_IT) {
-        for (int i = 0; i < n; i++) {
-            warpcore::impl::opa_fit((const float*)data[i], m1, allow, d, m, xforms[i].offs, &xforms[i].cs, xforms[i].rot);
-        }
+    warpcore::impl::anderson aa{};
+    if (accel)
+        warpcore::impl::anderson_init(&aa, d * m, ANDERSON_DEPTH);
+
+    int it = 0, stall = 0;
+    float prev_err = 1, best_err = FLT_MAX;
+    *last_err = 0;
+    while(it < maxit) {
+        warpcore::impl::opa_fit_batch(data, m1, allow, d, n, m, xforms);
         
-        warpcore::impl::gpa_update_mean((const float**)data, d, n, m, xforms, m2);
+        warpcore::impl::gpa_update_mean(data, d, n, m, xforms, m2);
         float new_err = 0;
         if (allow) {
             new_err = warpcore::impl::pcl_rmse(m1, m2, d, m, allow, false);
@@ -35,26 +40,130 @@ extern "C" int gpa_fit(const void** data, const void* allow, int d, int n, int m
             new_err = warpcore::impl::pcl_rmse(m1, m2, d, m);
         }
 
-        if((err-new_err) / new_err < TOL_REL) 
-            break;
-    
-        std::swap(m1, m2);
-        err = new_err;
+        if (err)
+            err[it] = new_err;
+
+        *last_err = new_err;
+        if (!accel) {
+            // A mean that stopped moving altogether would make the relative decrease 0/0.
+            if (new_err == 0 || (prev_err - new_err) / new_err < tol)
+                break;
+
+            prev_err = new_err;
+            std::swap(m1, m2);
+        } else {
+            float size = 0, center[3];
+            if (allow) {
+                warpcore::impl::pcl_center(m2, allow, d, m, center);
+                size = warpcore::impl::pcl_cs(m2, allow, d, m, center);
+            } else {
+                warpcore::impl::pcl_center(m2, d, m, center);
+                size = warpcore::impl::pcl_cs(m2, d, m, center);
+            }
+
+            if (new_err < best_err * (1.0f - tol)) {
+                best_err = new_err;
+                stall = 0;
+            } else {
+                stall++;
+            }
+
+            if (new_err < tol * size || stall >= ANDERSON_PATIENCE)
+                break;
+
+            // A step that made the mean much worse discards the history, the next step is a plain one.
+            if (new_err > 4 * best_err)
+                warpcore::impl::anderson_reset(&aa);
+
+            warpcore::impl::anderson_step(&aa, m1, m2, m1);
+        }
+
         it++;
     }
     
     if(mean != m1)
         memcpy(mean, temp_mean, sizeof(float) * d * m);
 
+    if (accel)
+        warpcore::impl::anderson_destroy(&aa);
+
     delete[] temp_mean;
+    return it;
+}
+
+extern "C" int gpa_fit(const void** data, const void* allow, int d, int n, int m, const gpainfo* info, rigid3* xforms, void* mean, float* err, gparesult* res)
+{
+    if(d != 3 || m < 4 || xforms == NULL)
+        return WCORE_INVALID_ARGUMENT;
+
+    const int maxit = info ? info->maxit : 150;
+    const float tol = info ? info->tol : 1e-5f;
+    const bool accel = info && (info->flags & GPA_ACCELERATE);
+    if (maxit < 1)
+        return WCORE_INVALID_ARGUMENT;
+
+    warpcore::impl::gpa_init_mean((const float*)data[0], d, m, (float*)mean);
+
+    float last_err = 0;
+    const int it = gpa_iterate((const float**)data, allow, d, n, m, maxit, tol, accel, xforms, (float*)mean, err, &last_err);
 
     if (res != NULL)
     {
         res->iter = it;
-        res->err = err;
+        res->err = last_err;
+        res->shift = 0;
     }
 
-    return (it < MAX_IT) ? WCORE_OK : WCORE_NONCONVERGENCE;
+    return (it < maxit) ? WCORE_OK : WCORE_NONCONVERGENCE;
+}
+
+extern "C" int gpa_fit_incremental(const void** data, const void* allow, int d, int n_old, int n, int m, const gpainfo* info, rigid3* xforms, void* mean, float* err, gparesult* res)
+{
+    if(d != 3 || m < 4 || xforms == NULL || mean == NULL || n_old < 1 || n_old > n)
+        return WCORE_INVALID_ARGUMENT;
+
+    const int maxit = info ? info->maxit : 3;
+    const float tol = info ? info->tol : 1e-5f;
+    const bool accel = info && (info->flags & GPA_ACCELERATE);
+    if (maxit < 0)
+        return WCORE_INVALID_ARGUMENT;
+
+    const float** x = (const float**)data;
+    float* meanf = (float*)mean;
+    float* prev_mean = new float[d * m];
+    memcpy(prev_mean, meanf, sizeof(float) * d * m);
+
+    // The old specimens average to the mean already, only the new ones need to be added in.
+    const int n_new = n - n_old;
+    if (n_new > 0) {
+        warpcore::impl::opa_fit_batch(x + n_old, meanf, allow, d, n_new, m, xforms + n_old);
+
+        float* added = new float[d * m];
+        warpcore::impl::gpa_update_mean(x + n_old, d, n_new, m, xforms + n_old, added);
+
+        const float wo = (float)n_old / n, wn = (float)n_new / n;
+        for (int i = 0; i < d * m; i++)
+            meanf[i] = wo * meanf[i] + wn * added[i];
+
+        delete[] added;
+    }
+
+    float last_err = 0;
+    int it = 0;
+    if (maxit > 0)
+        it = gpa_iterate(x, allow, d, n, m, maxit, tol, accel, xforms, meanf, err, &last_err);
+
+    if (res != NULL)
+    {
+        res->iter = it;
+        res->err = last_err;
+        res->shift = allow ? 
+            warpcore::impl::pcl_rmse(prev_mean, meanf, d, m, allow, false) : 
+            warpcore::impl::pcl_rmse(prev_mean, meanf, d, m);
+    }
+
+    delete[] prev_mean;
+    return WCORE_OK;
 }
 
 void print_rigid(const rigid3& r)
@@ -116,6 +225,49 @@ extern "C" int rigid_transform(const void* x, int d, int m, const rigid3* xform,
     return WCORE_OK;
 }
 
+extern "C" int rigid_transform_batch(const void** x, int nx, int d, int n, int m, const rigid3* xforms, const rigid3* post, void** res)
+{
+    constexpr int BLOCK = 8192;
+
+    if(d != 3 || m < 4 || n < 1 || x == NULL || xforms == NULL || res == NULL || (nx != 1 && nx != n))
+        return WCORE_INVALID_ARGUMENT;
+
+    // With a shared source, writing any of the results over it would race with the others reading it.
+    if (nx == 1) {
+        for (int i = 0; i < n; i++) {
+            if (res[i] == x[0])
+                return WCORE_INVALID_ARGUMENT;
+        }
+    }
+
+    rigid3* combined = nullptr;
+    if (post) {
+        // post(xforms[i](x)); rigid_combine would take the offset of post in the units of x instead.
+        combined = new rigid3[n];
+        for (int i = 0; i < n; i++) {
+            combined[i] = xforms[i];
+            warpcore::impl::icp_apply_update(combined + i, post);
+        }
+    }
+
+    const rigid3* xf = combined ? combined : xforms;
+    const int nb = (m + BLOCK - 1) / BLOCK;
+
+    // Blocks of all specimens go into one loop, so that a few large clouds keep all threads busy
+    // as well as many small ones.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < n * nb; k++) {
+        const int i = k / nb;
+        const int i0 = (k % nb) * BLOCK;
+        const float* xi = (const float*)x[nx == 1 ? 0 : i] + d * i0;
+        float* yi = (float*)res[i] + d * i0;
+        warpcore::impl::pcl_transform(xi, d, std::min(BLOCK, m - i0), false, 1.0f / xf[i].cs, xf[i].offs, xf[i].rot, yi);
+    }
+
+    delete[] combined;
+    return WCORE_OK;
+}
+
 extern "C" int pcl_stat(const void* x, int d, int m, pclstat3* stat)
 {
     if(d != 3 || x == NULL || m < 1 || stat == NULL)
@@ -10,12 +10,41 @@ struct pclstat3 {
     float size;
 };
 
+enum GPA_FLAGS {
+    GPA_ACCELERATE = 1 // Anderson acceleration on the mean
+};
+
+struct gpainfo {
+    int32_t maxit;
+    float tol;
+    int32_t flags;
+};
+
+// shift is the RMS distance the mean moved in gpa_fit_incremental.
 struct gparesult {
     int32_t iter;
     float err;
+    float shift;
 };
 
-extern "C" WCEXPORT int gpa_fit(const void** data, const void* allow, int d, int n, int m, rigid3* xforms, void* mean, gparesult* res);
+// Generalized Procrustes analysis of n specimens with m points each. The mean is updated until its
+// change (err) stops decreasing by more than a relative tol. With GPA_ACCELERATE, it also stops once
+// the change falls under tol times the size of the mean, and a stall is only accepted after three
+// steps without improvement, as accelerated steps do not decrease it monotonically. If info is null, maxit = 150, tol = 1e-5 and no flags are used. If err is not null, it receives the 
+// change of the mean in each iteration, min(res->iter + 1, info->maxit) values.
+extern "C" WCEXPORT int gpa_fit(const void** data, const void* allow, int d, int n, int m, const gpainfo* info, rigid3* xforms, void* mean, float* err, gparesult* res);
+
+// Adds specimens data[n_old..n-1] to a finished GPA of data[0..n_old-1], whose mean and xforms[0..n_old-1] 
+// are taken as a warm start. The new specimens are fitted to the mean, which is then updated with them 
+// and refined by at most info->maxit full GPA passes (none if maxit is 0, in which case the transforms 
+// refer to the previous mean). Hitting maxit is not an error here, res->err tells how much the mean 
+// still changed in the last pass.
+extern "C" WCEXPORT int gpa_fit_incremental(const void** data, const void* allow, int d, int n_old, int n, int m, const gpainfo* info, rigid3* xforms, void* mean, float* err, gparesult* res);
 extern "C" WCEXPORT int rigid_transform(const void* x, int d, int m, const rigid3* xform, void* res);
+
+// Applies xforms[i] to x[i] (nx = n) or to x[0] (nx = 1), writing into res[i]. res[i] may be x[i] only
+// when nx = n; with nx = 1, no res[i] may be x[0]. If post is not null, it is applied after each of the
+// transforms, as if rigid_transform was called with it on res[i].
+extern "C" WCEXPORT int rigid_transform_batch(const void** x, int nx, int d, int n, int m, const rigid3* xforms, const rigid3* post, void** res);
 extern "C" WCEXPORT int pcl_stat(const void* x, int d, int m, pclstat3* stat);
 extern "C" WCEXPORT int opa_fit(const void* templ, const void* floating, const void* allow, int d, int m, rigid3* xform);
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "icp.h"
+#include "search.h"
+#include "impl/icp_impl.h"
+#include "impl/nicp_impl.h"
+#include "impl/pcl_utils.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace warpcore::impl;
+
+extern "C" int icp_fit(const void* ctx, const float* vert, const int* idx, int nv, int nt, const float* src, int n, const icp_config* cfg, rigid3* xform, icp_result* res)
+{
+    constexpr int MIN_INLIERS = 6;
+    constexpr int MAX_GRID_DIM = 32;
+
+    if (!vert || !idx || !src || !cfg || !xform || n < MIN_INLIERS)
+        return WCORE_INVALID_ARGUMENT;
+
+    if (ctx && *(const int*)ctx != SEARCH_TRIGRID3)
+        return WCORE_INVALID_ARGUMENT;
+
+    // The correspondences index idx, so the grid must have been built on this very mesh.
+    if (ctx && (((const trigrid*)ctx)->nt != nt || ((const trigrid*)ctx)->nv != nv))
+        return WCORE_INVALID_ARGUMENT;
+
+    if (cfg->trim < 0 || cfg->trim >= 1)
+        return WCORE_INVALID_ARGUMENT;
+
+    const int max_iter = (cfg->max_iter > 0) ? cfg->max_iter : 30;
+    const int levels = (cfg->levels > 0) ? cfg->levels : 3;
+    const float max_dist = (cfg->max_dist > 0) ? cfg->max_dist : FLT_MAX;
+    const float tol = (cfg->tol > 0) ? cfg->tol : 1e-5f;
+    const bool plane = (cfg->flags & ICP_POINT_TO_PLANE) != 0;
+    const bool scale = (cfg->flags & ICP_FIT_SCALE) != 0;
+
+    if (!(cfg->flags & ICP_INIT_XFORM)) {
+        *xform = rigid3{ { 0, 0, 0 }, 1, { 1, 0, 0, 0, 1, 0, 0, 0, 1 } };
+    }
+
+    trigrid* temp = nullptr;
+    if (!ctx) {
+        temp = new trigrid;
+        temp->__magic = SEARCH_TRIGRID3;
+        trigrid_build(temp, vert, idx, nv, nt, 16);
+    }
+
+    const trigrid* g = ctx ? (const trigrid*)ctx : temp;
+    float* y = new float[3 * n];
+    icp_corr* corr = new icp_corr[n];
+    std::vector<int> sel;
+    int ret = WCORE_OK;
+    int it_total = 0;
+
+    for (int l = 0; l < levels && ret == WCORE_OK; l++) {
+        // The last level takes all points, the ones before it subsamples on coarser grids.
+        const int* psel = nullptr;
+        int m = n;
+        if (l < levels - 1) {
+            const int dim = std::max(4, MAX_GRID_DIM >> std::min(levels - 2 - l, 4));
+            sel.clear();
+            grid_select(sel, src, n, dim, nullptr, false);
+            if ((int)sel.size() < MIN_INLIERS)
+                continue;
+
+            psel = sel.data();
+            m = (int)sel.size();
+        }
+
+        float prev_err = FLT_MAX;
+        int it = 0;
+        for (; it < max_iter; it++) {
+            icp_transform(src, psel, m, xform, y);
+            icp_correspondences(g, vert, idx, y, m, max_dist, corr);
+
+            float err = 0;
+            if (icp_trim(corr, m, cfg->trim, err) < MIN_INLIERS) {
+                ret = WCORE_INVALID_DATA;
+                break;
+            }
+
+            if (prev_err - err <= tol * prev_err)
+                break;
+
+            rigid3 inc;
+            const bool ok = plane ? icp_step_plane(y, corr, m, &inc) : icp_step_point(y, corr, m, scale, &inc);
+            if (!ok) {
+                ret = WCORE_INVALID_DATA;
+                break;
+            }
+
+            icp_apply_update(xform, &inc);
+            prev_err = err;
+        }
+
+        it_total += it;
+        if (ret == WCORE_OK && l == levels - 1 && it == max_iter)
+            ret = WCORE_NONCONVERGENCE;
+    }
+
+    if (res) {
+        icp_transform(src, nullptr, n, xform, y);
+        icp_correspondences(g, vert, idx, y, n, max_dist, corr);
+        res->iter = it_total;
+        res->num_inliers = icp_trim(corr, n, cfg->trim, res->err);
+    }
+
+    delete[] corr;
+    delete[] y;
+
+    if (temp) {
+        trigrid_destroy(temp);
+        delete temp;
+    }
+
+    return ret;
+}
+
+extern "C" int nicp_fit(const void* ctx, const float* vert, const int* idx, int nv, int nt, const float* templ, const int* templ_idx, int m, int mt, const nicp_config* cfg, float* res, icp_result* result)
+{
+    constexpr int MIN_INLIERS = 4;
+    constexpr float CG_TOL = 1e-4f;
+    constexpr float EPS = 1e-6f;
+
+    if (!vert || !idx || !templ || !templ_idx || !cfg || !res || m < MIN_INLIERS || mt < 1)
+        return WCORE_INVALID_ARGUMENT;
+
+    if (ctx && *(const int*)ctx != SEARCH_TRIGRID3)
+        return WCORE_INVALID_ARGUMENT;
+
+    if (ctx && (((const trigrid*)ctx)->nt != nt || ((const trigrid*)ctx)->nv != nv))
+        return WCORE_INVALID_ARGUMENT;
+
+    if (cfg->trim < 0 || cfg->trim >= 1)
+        return WCORE_INVALID_ARGUMENT;
+
+    const int stages = (cfg->stages > 0) ? cfg->stages : 8;
+    const int max_iter = (cfg->max_iter > 0) ? cfg->max_iter : 10;
+    const int cg_iter = (cfg->cg_iter > 0) ? cfg->cg_iter : 100;
+    const float a0 = (cfg->stiffness_init > 0) ? cfg->stiffness_init : 10.0f;
+    const float a1 = (cfg->stiffness_final > 0) ? cfg->stiffness_final : 0.2f;
+    const float gamma = (cfg->gamma > 0) ? cfg->gamma : 1.0f;
+    const float max_dist = (cfg->max_dist > 0) ? cfg->max_dist : FLT_MAX;
+    const float tol = (cfg->tol > 0) ? cfg->tol : 1e-4f;
+
+    std::vector<int> adj_offs, adj;
+    if (!mesh_adjacency(templ_idx, m, mt, adj_offs, adj))
+        return WCORE_INVALID_DATA;
+
+    trigrid* temp = nullptr;
+    if (!ctx) {
+        temp = new trigrid;
+        temp->__magic = SEARCH_TRIGRID3;
+        trigrid_build(temp, vert, idx, nv, nt, 16);
+    }
+
+    const trigrid* g = ctx ? (const trigrid*)ctx : temp;
+
+    // Work on the template normalized to unit centroid size, so that the stiffness does not depend
+    // on its scale. Correspondences are searched for in the target's space.
+    float c[4];
+    pcl_center(templ, 3, m, c);
+    const float cs = std::max(pcl_cs(templ, 3, m, c), FLT_MIN);
+
+    float* v = new float[3 * m];
+    float* u = new float[3 * m];
+    float* w = new float[m];
+    float* x = new float[12 * (size_t)m];
+    float* x0 = new float[12 * (size_t)m];
+    float* b = new float[12 * (size_t)m];
+    icp_corr* corr = new icp_corr[m];
+    pcl_transform(templ, 3, m, false, 1.0f / cs, c, v);
+
+    for (int i = 0; i < m; i++) {
+        float* xi = x + 12 * i;
+        memset(xi, 0, sizeof(float) * 12);
+        xi[0] = xi[4] = xi[8] = 1;
+    }
+
+    nicp_system sys{ m, adj_offs.data(), adj.data(), v, w, 0, gamma * gamma, EPS };
+    int ret = WCORE_OK;
+    int it_total = 0;
+
+    for (int s = 0; s < stages && ret == WCORE_OK; s++) {
+        const float alpha = (stages > 1) ? (a0 * powf(a1 / a0, (float)s / (stages - 1))) : a1;
+        sys.alpha2 = alpha * alpha;
+
+        int it = 0;
+        for (; it < max_iter; it++) {
+            nicp_deform(v, x, m, u);
+            for (int i = 0; i < 3 * m; i++)
+                u[i] = u[i] * cs + c[i % 3];
+
+            icp_correspondences(g, vert, idx, u, m, max_dist, corr);
+
+            float err = 0;
+            if (icp_trim(corr, m, cfg->trim, err) < MIN_INLIERS) {
+                ret = WCORE_INVALID_DATA;
+                break;
+            }
+
+            for (int i = 0; i < m; i++) {
+                w[i] = (corr[i].tri >= 0) ? 1.0f : 0.0f;
+                for (int j = 0; j < 3; j++)
+                    u[3 * i + j] = (corr[i].tri >= 0) ? ((corr[i].q[j] - c[j]) / cs) : 0.0f;
+            }
+
+            memcpy(x0, x, sizeof(float) * 12 * m);
+            nicp_rhs(sys, u, x0, b);
+            nicp_solve(sys, b, x, cg_iter, CG_TOL);
+
+            double dx = 0;
+            for (int64_t i = 0; i < 12 * (int64_t)m; i++)
+                dx += (double)(x[i] - x0[i]) * (x[i] - x0[i]);
+
+            if (sqrt(dx / m) < tol) {
+                it++;
+                break;
+            }
+        }
+
+        it_total += it;
+        if (ret == WCORE_OK && s == stages - 1 && it == max_iter)
+            ret = WCORE_NONCONVERGENCE;
+    }
+
+    nicp_deform(v, x, m, res);
+    for (int i = 0; i < 3 * m; i++)
+        res[i] = res[i] * cs + c[i % 3];
+
+    if (result) {
+        icp_correspondences(g, vert, idx, res, m, max_dist, corr);
+        result->iter = it_total;
+        result->num_inliers = icp_trim(corr, m, cfg->trim, result->err);
+    }
+
+    delete[] corr;
+    delete[] b;
+    delete[] x0;
+    delete[] x;
+    delete[] w;
+    delete[] u;
+    delete[] v;
+
+    if (temp) {
+        trigrid_destroy(temp);
+        delete temp;
+    }
+
+    return ret;
+}
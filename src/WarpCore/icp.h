@@ -0,0 +1,63 @@
+#pragma once
+
+#include "defs.h"
+#include "config.h"
+
+enum ICP_FLAGS {
+    ICP_POINT_TO_PLANE = 1,
+    ICP_FIT_SCALE = 2, // point-to-point only
+    ICP_INIT_XFORM = 4 // start from the transform in xform instead of identity
+};
+
+// max_iter <= 0 selects 30 iterations per level, levels <= 0 selects 3. All levels but the last
+// one work on grid_select subsamples of the source, doubling the grid resolution each time.
+// The worst trim fraction of the correspondences is rejected in every iteration. max_dist <= 0 
+// means unlimited correspondence distance. A level ends when the RMS distance improves by less
+// than tol (<= 0 selects 1e-5) relative to the previous iteration.
+struct icp_config {
+    int max_iter;
+    int levels;
+    int flags;
+    float trim;
+    float max_dist;
+    float tol;
+};
+
+// err is the RMS distance of the num_inliers correspondences kept after trimming, evaluated with
+// the final transform on the full source. iter counts the iterations over all levels.
+struct icp_result {
+    int iter;
+    int num_inliers;
+    float err;
+};
+
+// Register the n points src onto the mesh (vert, idx). ctx is an optional SEARCH_TRIGRID3 on the
+// mesh, a temporary one is built otherwise. A ctx built with other nt or nv is rejected. The
+// transform that moves src onto the mesh is written to xform, as in rigid_transform.
+extern "C" WCEXPORT int icp_fit(const void* ctx, const float* vert, const int* idx, int nv, int nt, const float* src, int n, const icp_config* cfg, rigid3* xform, icp_result* res);
+
+// Stiffness goes from stiffness_init to stiffness_final (<= 0 select 10 and 0.2) geometrically over
+// the stages (<= 0 selects 8). Each stage runs up to max_iter (<= 0 selects 10) correspondence 
+// updates and ends early when the per-vertex affine transforms change by less than tol (<= 0 
+// selects 1e-4) in RMS. gamma (<= 0 selects 1) weighs the stiffness of the translations against 
+// the linear parts. Each linear system gets up to cg_iter (<= 0 selects 100) conjugate gradient 
+// iterations. trim and max_dist are as in icp_config. Stiffness and gamma are relative to the 
+// template normalized to unit centroid size.
+struct nicp_config {
+    int stages;
+    int max_iter;
+    int cg_iter;
+    float stiffness_init;
+    float stiffness_final;
+    float gamma;
+    float trim;
+    float max_dist;
+    float tol;
+};
+
+// Deform the m vertices of the template mesh (templ, templ_idx) onto the mesh (vert, idx) with 
+// optimal step non-rigid ICP and write the deformed template vertices to res. The template should
+// already be rigidly aligned to the target, such as by icp_fit. ctx is as in icp_fit. In result, 
+// iter counts the correspondence updates over all stages. Returns WCORE_INVALID_DATA if templ_idx
+// refers to vertices outside [0, m).
+extern "C" WCEXPORT int nicp_fit(const void* ctx, const float* vert, const int* idx, int nv, int nt, const float* templ, const int* templ_idx, int m, int mt, const nicp_config* cfg, float* res, icp_result* result);
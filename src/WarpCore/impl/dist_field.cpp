@@ -0,0 +1,288 @@
+#include "dist_field.h"
+#include "tri_grid_nn.h"
+#include "search_impl.h"
+#include "pcl_utils.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+namespace warpcore::impl
+{
+    void distfield_vertex_normals(const float* vert, const int* idx, int nv, int nt, float* nrm)
+    {
+        memset(nrm, 0, sizeof(float) * 3 * nv);
+
+        // Unnormalized face normals are area-weighted, which is what the vertices should get.
+        for (int i = 0; i < nt; i++) {
+            const int* f = idx + 3 * i;
+            const float* a = vert + 3 * f[0];
+            const float* b = vert + 3 * f[1];
+            const float* c = vert + 3 * f[2];
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            const float fn[3] = {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0]
+            };
+
+            for (int j = 0; j < 3; j++) {
+                nrm[3 * f[j]] += fn[0];
+                nrm[3 * f[j] + 1] += fn[1];
+                nrm[3 * f[j] + 2] += fn[2];
+            }
+        }
+
+        for (int i = 0; i < nv; i++) {
+            float* n = nrm + 3 * i;
+            const float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (len > 0) {
+                n[0] /= len;
+                n[1] /= len;
+                n[2] /= len;
+            }
+        }
+    }
+
+    int64_t distfield_mark_bricks(const distfield* df, const float* vert, const int* idx, float pad, uint8_t* mark)
+    {
+        const int64_t nb = (int64_t)df->nbrick[0] * df->nbrick[1] * df->nbrick[2];
+        memset(mark, 0, nb);
+
+        for (int i = 0; i < df->nt; i++) {
+            int b0[3], b1[3];
+            for (int j = 0; j < 3; j++) {
+                const float lo = std::min({ vert[3 * idx[3 * i] + j], vert[3 * idx[3 * i + 1] + j], vert[3 * idx[3 * i + 2] + j] });
+                const float hi = std::max({ vert[3 * idx[3 * i] + j], vert[3 * idx[3 * i + 1] + j], vert[3 * idx[3 * i + 2] + j] });
+                const int l0 = (int)floorf((lo - pad - df->x0[j]) / df->voxel);
+                const int l1 = (int)ceilf((hi + pad - df->x0[j]) / df->voxel);
+                b0[j] = std::clamp(l0, 0, df->dim[j] - 1) / DISTFIELD_BRICK;
+                b1[j] = std::clamp(l1, 0, df->dim[j] - 1) / DISTFIELD_BRICK;
+            }
+
+            for (int z = b0[2]; z <= b1[2]; z++) {
+                for (int y = b0[1]; y <= b1[1]; y++) {
+                    for (int x = b0[0]; x <= b1[0]; x++)
+                        mark[x + df->nbrick[0] * (y + (int64_t)df->nbrick[1] * z)] = 1;
+                }
+            }
+        }
+
+        int64_t ret = 0;
+        for (int64_t i = 0; i < nb; i++)
+            ret += mark[i];
+
+        return ret;
+    }
+
+    void distfield_layout(distfield* df, const float* x0, const float* x1, float voxel, float pad)
+    {
+        df->voxel = voxel;
+        for (int i = 0; i < 3; i++) {
+            df->x0[i] = x0[i] - pad;
+            df->dim[i] = (int)ceilf((x1[i] - x0[i] + 2 * pad) / voxel) + 2;
+            df->nbrick[i] = (df->dim[i] + DISTFIELD_BRICK - 1) / DISTFIELD_BRICK;
+        }
+        df->x0[3] = 0;
+        df->dim[3] = df->nbrick[3] = 0;
+    }
+
+    bool distfield_build(distfield* df, const float* vert, const int* idx, int nv, int nt, float voxel, float band, bool store_tri, int64_t max_bytes)
+    {
+        float x0[3], x1[3];
+        pcl_aabb(vert, 3, nv, x0, x1);
+
+        if (voxel <= 0)
+            voxel = std::max({ x1[0] - x0[0], x1[1] - x0[1], x1[2] - x0[2], FLT_MIN }) / 64.0f;
+
+        if (band <= 0)
+            band = 2.0f * voxel;
+
+        df->nt = nt;
+        df->nv = nv;
+        df->band = band;
+        df->brick_idx = nullptr;
+        df->dist = nullptr;
+        df->tri = nullptr;
+
+        trigrid_build(&df->grid, vert, idx, nv, nt, 16);
+        df->vert_normal = new float[3 * nv];
+        distfield_vertex_normals(vert, idx, nv, nt, df->vert_normal);
+
+        const int64_t bytes_per_brick = DISTFIELD_BRICK_SIZE * (sizeof(float) + (store_tri ? sizeof(int) : 0));
+        uint8_t* mark = nullptr;
+        int64_t nb = 0;
+
+        // A point within the band has all eight lattice points around it within band + one voxel
+        // diagonal (1.75 > sqrt 3 voxels), that is how far the lattice must be sampled for the
+        // interpolation to be valid. Bricks are kept where a triangle's AABB comes that close.
+        // Doubling stops being useful once the lattice is a single brick or a voxel spans the whole 
+        // mesh, if the budget is still not met by then, it cannot be met at all.
+        const float extent = std::max({ x1[0] - x0[0], x1[1] - x0[1], x1[2] - x0[2] });
+        for (;;) {
+            const float pad = band + 2.0f * voxel;
+            distfield_layout(df, x0, x1, voxel, pad);
+
+            const int64_t ntotal = (int64_t)df->nbrick[0] * df->nbrick[1] * df->nbrick[2];
+            const int64_t index_bytes = ntotal * sizeof(int);
+            if (max_bytes <= 0 || index_bytes <= max_bytes) {
+                mark = new uint8_t[ntotal];
+                nb = distfield_mark_bricks(df, vert, idx, band + 1.75f * voxel, mark);
+
+                if (max_bytes <= 0 || index_bytes + nb * bytes_per_brick <= max_bytes)
+                    break;
+
+                delete[] mark;
+                mark = nullptr;
+            }
+
+            if (ntotal == 1 || voxel > extent)
+                return false;
+
+            voxel *= 2.0f;
+        }
+
+        const int64_t ntotal = (int64_t)df->nbrick[0] * df->nbrick[1] * df->nbrick[2];
+        df->num_bricks = (int)nb;
+        df->brick_idx = new int[ntotal];
+        for (int64_t i = 0, j = 0; i < ntotal; i++)
+            df->brick_idx[i] = mark[i] ? (int)(j++) : -1;
+        delete[] mark;
+
+        df->dist = new float[nb * DISTFIELD_BRICK_SIZE];
+        df->tri = store_tri ? new int[nb * DISTFIELD_BRICK_SIZE] : nullptr;
+
+        const float clamp = band + 1.75f * voxel;
+
+        #pragma omp parallel for schedule(dynamic, 4)
+        for (int64_t i = 0; i < ntotal; i++) {
+            const int b = df->brick_idx[i];
+            if (b < 0)
+                continue;
+
+            const int bx = (int)(i % df->nbrick[0]);
+            const int by = (int)((i / df->nbrick[0]) % df->nbrick[1]);
+            const int bz = (int)(i / ((int64_t)df->nbrick[0] * df->nbrick[1]));
+
+            for (int j = 0; j < DISTFIELD_BRICK_SIZE; j++) {
+                const float pt[3] = {
+                    df->x0[0] + df->voxel * (bx * DISTFIELD_BRICK + (j % DISTFIELD_BRICK)),
+                    df->x0[1] + df->voxel * (by * DISTFIELD_BRICK + (j / DISTFIELD_BRICK) % DISTFIELD_BRICK),
+                    df->x0[2] + df->voxel * (bz * DISTFIELD_BRICK + j / (DISTFIELD_BRICK * DISTFIELD_BRICK))
+                };
+
+                float d;
+                const int h = distfield_query_exact(df, pt, clamp, d);
+                df->dist[(int64_t)b * DISTFIELD_BRICK_SIZE + j] = d;
+                if (df->tri)
+                    df->tri[(int64_t)b * DISTFIELD_BRICK_SIZE + j] = h;
+            }
+        }
+
+        return true;
+    }
+
+    void distfield_destroy(distfield* df)
+    {
+        trigrid_destroy(&df->grid);
+        delete[] df->brick_idx;
+        delete[] df->dist;
+        delete[] df->tri;
+        delete[] df->vert_normal;
+
+        df->brick_idx = nullptr;
+        df->dist = nullptr;
+        df->tri = nullptr;
+        df->vert_normal = nullptr;
+    }
+
+    // Offset of lattice point (x, y, z) in distfield::dist, -1 if its brick is not stored.
+    inline int64_t distfield_sample_offs(const distfield* df, int x, int y, int z) noexcept
+    {
+        const int b = df->brick_idx[(x / DISTFIELD_BRICK) + df->nbrick[0] * ((y / DISTFIELD_BRICK) + (int64_t)df->nbrick[1] * (z / DISTFIELD_BRICK))];
+        if (b < 0)
+            return -1;
+
+        const int j = (x % DISTFIELD_BRICK) + DISTFIELD_BRICK * ((y % DISTFIELD_BRICK) + DISTFIELD_BRICK * (z % DISTFIELD_BRICK));
+        return (int64_t)b * DISTFIELD_BRICK_SIZE + j;
+    }
+
+    int distfield_query(const distfield* df, const float* pt, float max_dist, float& d) noexcept
+    {
+        float f[3];
+        int c[3];
+        bool inside = true;
+        for (int i = 0; i < 3; i++) {
+            const float p = (pt[i] - df->x0[i]) / df->voxel;
+            const float pf = floorf(p);
+            inside &= (pf >= 0 && pf < df->dim[i] - 1);
+            c[i] = (int)pf;
+            f[i] = p - pf;
+        }
+
+        if (inside) {
+            float s[8];
+            int64_t offs[8];
+            bool valid = true;
+            float smin = FLT_MAX, smax = -FLT_MAX;
+            for (int i = 0; i < 8; i++) {
+                offs[i] = distfield_sample_offs(df, c[0] + (i & 1), c[1] + ((i >> 1) & 1), c[2] + (i >> 2));
+                s[i] = (offs[i] >= 0) ? df->dist[offs[i]] : NAN;
+                valid &= !isnan(s[i]);
+                smin = std::min(smin, s[i]);
+                smax = std::max(smax, s[i]);
+            }
+
+            // The distance to a surface cannot change faster than the distance between the samples.
+            // If it does, the sign flips across an open boundary or a self-intersection within the
+            // voxel and interpolation would be wrong.
+            valid &= (smax - smin <= 1.75f * df->voxel);
+
+            if (valid) {
+                const float sx0 = s[0] + f[0] * (s[1] - s[0]);
+                const float sx1 = s[2] + f[0] * (s[3] - s[2]);
+                const float sx2 = s[4] + f[0] * (s[5] - s[4]);
+                const float sx3 = s[6] + f[0] * (s[7] - s[6]);
+                const float sy0 = sx0 + f[1] * (sx1 - sx0);
+                const float sy1 = sx2 + f[1] * (sx3 - sx2);
+                const float di = sy0 + f[2] * (sy1 - sy0);
+
+                if (fabsf(di) <= df->band && fabsf(di) <= max_dist) {
+                    d = di;
+                    if (!df->tri)
+                        return -1;
+
+                    // The triangle of the closest lattice point.
+                    const int nearest = (f[0] >= 0.5f ? 1 : 0) | (f[1] >= 0.5f ? 2 : 0) | (f[2] >= 0.5f ? 4 : 0);
+                    return df->tri[offs[nearest]];
+                }
+            }
+        }
+
+        return distfield_query_exact(df, pt, max_dist, d);
+    }
+
+    int distfield_query_exact(const distfield* df, const float* pt, float max_dist, float& d) noexcept
+    {
+        alignas(16) float res[PtTri_DPtBary::ResultSize];
+        const int h = trigrid_nn<PtTri_DPtBary>(&df->grid, pt, max_dist, res);
+        if (h < 0) {
+            d = NAN;
+            return -1;
+        }
+
+        // The sign comes from the vertex normals interpolated at the closest point, which unlike
+        // the face normal is also reliable when the closest point lies on an edge or a vertex.
+        const int* f = df->grid.tri_idx + 3 * h;
+        const float u = res[4], v = res[5];
+        float dot = 0;
+        for (int j = 0; j < 3; j++) {
+            const float n = (1 - u - v) * df->vert_normal[3 * f[0] + j] + u * df->vert_normal[3 * f[1] + j] + v * df->vert_normal[3 * f[2] + j];
+            dot += (pt[j] - res[1 + j]) * n;
+        }
+
+        d = (dot < 0) ? -res[0] : res[0];
+        return h;
+    }
+};
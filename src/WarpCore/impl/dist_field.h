@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include "tri_grid.h"
+
+namespace warpcore::impl
+{
+    constexpr int DISTFIELD_BRICK = 8;
+    constexpr int DISTFIELD_BRICK_SIZE = DISTFIELD_BRICK * DISTFIELD_BRICK * DISTFIELD_BRICK;
+
+    // Signed distances sampled at the points of a regular lattice with spacing voxel, starting at x0.
+    // The lattice is split into bricks of 8x8x8 points and only the bricks near the surface are
+    // stored, brick_idx maps brick coordinates to their slot or -1. Lattice points with no surface
+    // within the sampling distance hold NaN. If tri is not null, it holds the closest triangle for
+    // each lattice point. The exact trigrid on the mesh serves queries outside the band.
+    struct distfield {
+        int __magic;
+        int nt, nv;
+
+        float voxel;
+        float band;
+        float x0[4];
+        int dim[4];
+        int nbrick[4];
+
+        int num_bricks;
+        int* brick_idx;
+        float* dist;
+        int* tri;
+
+        float* vert_normal;
+        trigrid grid;
+    };
+
+    // Build the distance field on a mesh. Non-positive voxel defaults to 1/64 of the longest side of the
+    // mesh AABB, non-positive band to two voxels. If the brick index and the bricks would take more than
+    // max_bytes (if positive), the voxel size is doubled until they fit. The budget does not cover the
+    // exact trigrid and the vertex normals, which do not depend on the voxel size. Returns false if the
+    // budget cannot be met, df must still be destroyed then.
+    bool distfield_build(distfield* df, const float* vert, const int* idx, int nv, int nt, float voxel, float band, bool store_tri, int64_t max_bytes);
+    void distfield_destroy(distfield* df);
+
+    // Signed distance from pt to the mesh, positive outside. Interpolated from the lattice within the
+    // band, exact elsewhere. Returns the closest triangle if known, -1 otherwise. If the exact query
+    // finds nothing within max_dist, d is NaN.
+    int distfield_query(const distfield* df, const float* pt, float max_dist, float& d) noexcept;
+
+    // Exact signed distance from pt to the mesh. Returns the closest triangle or -1 if there is none
+    // within max_dist.
+    int distfield_query_exact(const distfield* df, const float* pt, float max_dist, float& d) noexcept;
+};
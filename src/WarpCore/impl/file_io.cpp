@@ -0,0 +1,160 @@
+#include "file_io.h"
+
+#ifdef _MSC_VER
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <string>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace warpcore::impl
+{
+#ifdef _MSC_VER
+    // The A functions would read path in the ANSI code page.
+    static bool utf8_to_wide(const char* s, std::wstring& ret)
+    {
+        const int len = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, s, -1, NULL, 0);
+        if (len <= 0)
+            return false;
+
+        ret.resize(len);
+        if (MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, s, -1, ret.data(), len) != len)
+            return false;
+
+        ret.resize(len - 1);
+        return true;
+    }
+#endif
+
+    FILE* file_open(const char* path, const char* mode)
+    {
+        FILE* f = nullptr;
+#ifdef _MSC_VER
+        std::wstring wpath, wmode;
+        if (utf8_to_wide(path, wpath) && utf8_to_wide(mode, wmode))
+            _wfopen_s(&f, wpath.c_str(), wmode.c_str());
+#else
+        f = fopen(path, mode);
+#endif
+        return f;
+    }
+
+    bool file_write_padded(FILE* f, const void* data, int64_t size, int64_t align)
+    {
+        static const uint8_t zeros[64] = { 0 };
+
+        if (size > 0 && fwrite(data, 1, size, f) != (size_t)size)
+            return false;
+
+        int64_t pad = (align - size % align) % align;
+        while (pad > 0) {
+            int64_t n = pad < 64 ? pad : 64;
+            if (fwrite(zeros, 1, n, f) != (size_t)n)
+                return false;
+            pad -= n;
+        }
+
+        return true;
+    }
+
+#ifdef _MSC_VER
+    bool mapped_file_open(mapped_file* mf, const char* path)
+    {
+        mf->file = nullptr;
+        mf->mapping = nullptr;
+        mf->view = nullptr;
+        mf->size = 0;
+
+        std::wstring wpath;
+        if (!utf8_to_wide(path, wpath))
+            return false;
+
+        HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            CloseHandle(file);
+            return false;
+        }
+
+        const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == NULL) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        mf->file = file;
+        mf->mapping = mapping;
+        mf->view = view;
+        mf->size = size.QuadPart;
+        return true;
+    }
+
+    void mapped_file_close(mapped_file* mf)
+    {
+        if (mf->view)
+            UnmapViewOfFile(mf->view);
+
+        if (mf->mapping)
+            CloseHandle((HANDLE)mf->mapping);
+
+        if (mf->file)
+            CloseHandle((HANDLE)mf->file);
+
+        mf->file = nullptr;
+        mf->mapping = nullptr;
+        mf->view = nullptr;
+        mf->size = 0;
+    }
+#else
+    bool mapped_file_open(mapped_file* mf, const char* path)
+    {
+        mf->file = nullptr;
+        mf->mapping = nullptr;
+        mf->view = nullptr;
+        mf->size = 0;
+
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (view == MAP_FAILED)
+            return false;
+
+        mf->view = view;
+        mf->size = st.st_size;
+        return true;
+    }
+
+    void mapped_file_close(mapped_file* mf)
+    {
+        if (mf->view)
+            munmap((void*)mf->view, mf->size);
+
+        mf->view = nullptr;
+        mf->size = 0;
+    }
+#endif
+};
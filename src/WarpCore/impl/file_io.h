@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace warpcore::impl
+{
+    // A read-only view of a whole file. The view is shared between all processes that
+    // map the same file and is at least page-aligned.
+    struct mapped_file {
+        void* file;
+        void* mapping;
+        const void* view;
+        int64_t size;
+    };
+
+    // Paths are UTF-8 on all platforms.
+    FILE* file_open(const char* path, const char* mode);
+    bool file_write_padded(FILE* f, const void* data, int64_t size, int64_t align);
+    bool mapped_file_open(mapped_file* mf, const char* path);
+    void mapped_file_close(mapped_file* mf);
+};
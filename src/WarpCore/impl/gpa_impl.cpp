@@ -2,7 +2,10 @@
 #include "vec_math.h"
 #include "pcl_utils.h"
 #include "utils.h"
+#include "cpu_info.h"
 #include <immintrin.h>
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
 #include <cstring>
 #include <lapacke.h>
@@ -13,77 +16,237 @@ namespace warpcore::impl
 {
     void opa_cov(const float* x, const float* y, int d, int m, const float* xoff, float xcs, float* cov);
     void opa_cov(const float* x, const float* y, const void* allow, int d, int m, const float* xoff, float xcs, float* cov);
+    void anderson_init(anderson* aa, int len, int depth)
+    {
+        aa->len = len;
+        aa->depth = depth;
+        aa->count = 0;
+        aa->df = new float[(size_t)len * depth];
+        aa->dg = new float[(size_t)len * depth];
+        aa->f_prev = new float[len];
+        aa->g_prev = new float[len];
+    }
+
+    void anderson_destroy(anderson* aa)
+    {
+        delete[] aa->df;
+        delete[] aa->dg;
+        delete[] aa->f_prev;
+        delete[] aa->g_prev;
+        aa->df = aa->dg = aa->f_prev = aa->g_prev = nullptr;
+    }
+
+    void anderson_reset(anderson* aa)
+    {
+        aa->count = 0;
+    }
+
+    void anderson_step(anderson* aa, const float* x, const float* gx, float* xnext)
+    {
+        const int len = aa->len;
+        const int depth = aa->depth;
+
+        // The history is a ring buffer, the new differences go to slot.
+        const int slot = (aa->count - 1) % depth;
+        float* dfs = aa->df + (size_t)len * std::max(slot, 0);
+        float* dgs = aa->dg + (size_t)len * std::max(slot, 0);
+        for (int i = 0; i < len; i++) {
+            const float f = gx[i] - x[i];
+            if (aa->count > 0) {
+                dfs[i] = f - aa->f_prev[i];
+                dgs[i] = gx[i] - aa->g_prev[i];
+            }
+            aa->f_prev[i] = f;
+            aa->g_prev[i] = gx[i];
+        }
+
+        const int k = std::min(aa->count, depth);
+        aa->count++;
+
+        if (k == 0) {
+            memcpy(xnext, gx, sizeof(float) * len);
+            return;
+        }
+
+        // gamma = argmin |f - dF gamma| through the normal equations, with a little Tikhonov 
+        // regularization as the differences become nearly collinear close to convergence.
+        double ata[8 * 8], atb[8];
+        WCORE_ASSERT(depth <= 8);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int r = 0; r < k; r++) {
+            const float* dfr = aa->df + (size_t)len * r;
+            for (int c = r; c < k; c++) {
+                const float* dfc = aa->df + (size_t)len * c;
+                double sum = 0;
+                for (int i = 0; i < len; i++)
+                    sum += (double)dfr[i] * dfc[i];
+                ata[r * k + c] = ata[c * k + r] = sum;
+            }
+
+            double sum = 0;
+            for (int i = 0; i < len; i++)
+                sum += (double)dfr[i] * aa->f_prev[i];
+            atb[r] = sum;
+        }
+
+        double tr = 0;
+        for (int r = 0; r < k; r++)
+            tr += ata[r * k + r];
+        for (int r = 0; r < k; r++)
+            ata[r * k + r] += 1e-10 * tr + DBL_MIN;
+
+        if (LAPACKE_dposv(LAPACK_ROW_MAJOR, 'U', k, 1, ata, k, atb, 1) != 0) {
+            anderson_reset(aa);
+            memcpy(xnext, gx, sizeof(float) * len);
+            return;
+        }
+
+        for (int i = 0; i < len; i++) {
+            double xi = gx[i];
+            for (int r = 0; r < k; r++)
+                xi -= atb[r] * aa->dg[(size_t)len * r + i];
+            xnext[i] = (float)xi;
+        }
+    }
+
     float mat3_det(const float* m);
     void mat3_transpose(float* m);
-    void extract_mat3_transpose(float* dest, __m128 row0, __m128 row1, __m128 row2);
   
-    void opa_cov(const float* x, const float* y, int d, int m, const float* xoff, float xcs, float* cov)
+    // cov[3a+b] = sum_i y_ia * (x_ib - xoff_b) / xcs over the allowed points, 8 or 16 points at a time.
+    static void opa_cov3_avx2(const float* x, const float* y, const void* allow, int m, const float* xoff, float xcs, float* cov)
     {
-        __m128 offset = _mm_loadu_ps(xoff);
-        __m128 rcs = _mm_set1_ps(1.0f / xcs);
-        __m128 cov0 = _mm_setzero_ps(), cov1 = _mm_setzero_ps(), cov2 = _mm_setzero_ps();
+        const __m256 o0 = _mm256_set1_ps(xoff[0]), o1 = _mm256_set1_ps(xoff[1]), o2 = _mm256_set1_ps(xoff[2]);
+        const __m256 rcs = _mm256_set1_ps(1.0f / xcs);
+        __m256 acc[9];
+        for (int j = 0; j < 9; j++)
+            acc[j] = _mm256_setzero_ps();
+
+        const int m8 = round_down(m, 8);
+        for (int i = 0; i < m8; i += 8) {
+            const uint32_t bits = allow_bits(allow, i, 8);
+            if (!bits)
+                continue;
+
+            __m256 x0 = _mm256_loadu_ps(x + 3 * i);
+            __m256 x1 = _mm256_loadu_ps(x + 3 * i + 8);
+            __m256 x2 = _mm256_loadu_ps(x + 3 * i + 16);
+            demux(x0, x1, x2);
+
+            __m256 y0 = _mm256_loadu_ps(y + 3 * i);
+            __m256 y1 = _mm256_loadu_ps(y + 3 * i + 8);
+            __m256 y2 = _mm256_loadu_ps(y + 3 * i + 16);
+            demux(y0, y1, y2);
+
+            __m256 xs[3] = {
+                _mm256_mul_ps(rcs, _mm256_sub_ps(x0, o0)),
+                _mm256_mul_ps(rcs, _mm256_sub_ps(x1, o1)),
+                _mm256_mul_ps(rcs, _mm256_sub_ps(x2, o2))
+            };
+            __m256 ys[3] = { y0, y1, y2 };
 
-        for (int i = 0; i < m; i++) {
-            __m128 xi = _mm_mul_ps(rcs, _mm_sub_ps(_mm_loadu_ps(x + 3 * i), offset));
-            __m128 yi = _mm_loadu_ps(y + 3 * i);
+            if (bits != 0xff) {
+                const __m256 mask = mask_from_bits(bits);
+                for (int j = 0; j < 3; j++) {
+                    xs[j] = _mm256_and_ps(xs[j], mask);
+                    ys[j] = _mm256_and_ps(ys[j], mask);
+                }
+            }
 
-            cov0 = _mm_fmadd_ps(yi, _mm_shuffle_ps(xi, xi, 0b00000000), cov0);
-            cov1 = _mm_fmadd_ps(yi, _mm_shuffle_ps(xi, xi, 0b01010101), cov1);
-            cov2 = _mm_fmadd_ps(yi, _mm_shuffle_ps(xi, xi, 0b10101010), cov2);
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++)
+                    acc[3 * a + b] = _mm256_fmadd_ps(ys[a], xs[b], acc[3 * a + b]);
+            }
         }
 
-        extract_mat3_transpose(cov, cov0, cov1, cov2);
+        for (int j = 0; j < 9; j++)
+            cov[j] = reduce_add(acc[j]);
+
+        for (int i = m8; i < m; i++) {
+            if (!is_allowed(allow, i))
+                continue;
+
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++)
+                    cov[3 * a + b] += y[3 * i + a] * (x[3 * i + b] - xoff[b]) / xcs;
+            }
+        }
     }
 
-    void opa_cov(const float* x, const float* y, const void* allow, int d, int m, const float* xoff, float xcs, float* cov)
+    static void opa_cov3_avx512(const float* x, const float* y, const void* allow, int m, const float* xoff, float xcs, float* cov)
     {
-        __m128 offset = _mm_loadu_ps(xoff);
-        __m128 rcs = _mm_set1_ps(1.0f / xcs);
-        __m128 cov0 = _mm_setzero_ps(), cov1 = _mm_setzero_ps(), cov2 = _mm_setzero_ps();
+        const __m512 o0 = _mm512_set1_ps(xoff[0]), o1 = _mm512_set1_ps(xoff[1]), o2 = _mm512_set1_ps(xoff[2]);
+        const __m512 rcs = _mm512_set1_ps(1.0f / xcs);
+        __m512 acc[9];
+        for (int j = 0; j < 9; j++)
+            acc[j] = _mm512_setzero_ps();
 
-        int dummy = 0;
-        FOR_MASKED(i, m, allow, dummy, false, {
-            __m128 xi = _mm_mul_ps(rcs, _mm_sub_ps(_mm_loadu_ps(x + 3 * i), offset));
-            __m128 yi = _mm_loadu_ps(y + 3 * i);
+        const int m16 = round_down(m, 16);
+        for (int i = 0; i < m16; i += 16) {
+            const __mmask16 bits = (__mmask16)allow_bits(allow, i, 16);
+            if (!bits)
+                continue;
 
-            cov0 = _mm_fmadd_ps(yi, _mm_shuffle_ps(xi, xi, 0b00000000), cov0);
-            cov1 = _mm_fmadd_ps(yi, _mm_shuffle_ps(xi, xi, 0b01010101), cov1);
-            cov2 = _mm_fmadd_ps(yi, _mm_shuffle_ps(xi, xi, 0b10101010), cov2);
-        });
-       
-        extract_mat3_transpose(cov, cov0, cov1, cov2);
-    }
+            __m512 x0 = _mm512_loadu_ps(x + 3 * i);
+            __m512 x1 = _mm512_loadu_ps(x + 3 * i + 16);
+            __m512 x2 = _mm512_loadu_ps(x + 3 * i + 32);
+            demux(x0, x1, x2);
 
-    int opa_fit(const float* x, const float* y, const void* allow, int d, int m, float* xoffs, float* xcs, float* rot)
-    {
-        WCORE_ASSERT(d == 3); // static cov size
+            __m512 y0 = _mm512_loadu_ps(y + 3 * i);
+            __m512 y1 = _mm512_loadu_ps(y + 3 * i + 16);
+            __m512 y2 = _mm512_loadu_ps(y + 3 * i + 32);
+            demux(y0, y1, y2);
 
-        float cs = 0;
-        if (allow) {
-            pcl_center(x, allow, d, m, xoffs);
-            cs = pcl_cs(x, allow, d, m, xoffs);
-        } else {
-            pcl_center(x, d, m, xoffs);
-            cs = pcl_cs(x, d, m, xoffs);            
+            const __m512 xs[3] = {
+                _mm512_mul_ps(rcs, _mm512_sub_ps(x0, o0)),
+                _mm512_mul_ps(rcs, _mm512_sub_ps(x1, o1)),
+                _mm512_mul_ps(rcs, _mm512_sub_ps(x2, o2))
+            };
+            const __m512 ys[3] = { y0, y1, y2 };
+
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++)
+                    acc[3 * a + b] = _mm512_mask3_fmadd_ps(ys[a], xs[b], acc[3 * a + b], bits);
+            }
         }
 
-        *xcs = cs;
+        for (int j = 0; j < 9; j++)
+            cov[j] = reduce_add(acc[j]);
 
-        // Kabsch algorithm follows
-        float cov[33 + 10];
-        memset(cov, 0x0, sizeof(float) * 43);
-        float* u = cov + d * d;
-        float* vt = u + d * d;
-        float* s = vt + d * d;
-        float* superb = s + d;
+        for (int i = m16; i < m; i++) {
+            if (!is_allowed(allow, i))
+                continue;
 
-        if (allow) {
-            opa_cov(x, y, allow, d, m, xoffs, cs, cov);
-        } else {
-            opa_cov(x, y, d, m, xoffs, cs, cov);
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++)
+                    cov[3 * a + b] += y[3 * i + a] * (x[3 * i + b] - xoff[b]) / xcs;
+            }
         }
+    }
+
+    void opa_cov(const float* x, const float* y, int d, int m, const float* xoff, float xcs, float* cov)
+    {
+        if (has_feature(WCORE_OPTPATH::AVX512))
+            opa_cov3_avx512(x, y, nullptr, m, xoff, xcs, cov);
+        else
+            opa_cov3_avx2(x, y, nullptr, m, xoff, xcs, cov);
+    }
+
+    void opa_cov(const float* x, const float* y, const void* allow, int d, int m, const float* xoff, float xcs, float* cov)
+    {
+        if (has_feature(WCORE_OPTPATH::AVX512))
+            opa_cov3_avx512(x, y, allow, m, xoff, xcs, cov);
+        else
+            opa_cov3_avx2(x, y, allow, m, xoff, xcs, cov);
+    }
 
-        int info = LAPACKE_sgesvd(LAPACK_COL_MAJOR, 'A', 'A', d, d, cov, d, s, u, d, vt, d, superb);
+    int opa_rot_svd(const float* cov, float* rot)
+    {
+        constexpr int d = 3;
+        float a[9], u[9], vt[9], s[3], superb[3];
+        memcpy(a, cov, sizeof(float) * 9);
+
+        int info = LAPACKE_sgesvd(LAPACK_COL_MAJOR, 'A', 'A', d, d, a, d, s, u, d, vt, d, superb);
         if (info != 0)
             return -1;
 
@@ -104,6 +267,189 @@ namespace warpcore::impl
         return 0;
     }
 
+    void opa_rot_horn(const float* cov, int n, float* rot, bool* ok)
+    {
+        constexpr int Sweeps = 5;
+        constexpr double GapTol = 1e-6;
+        constexpr int Pairs[6][2] = { {0, 1}, {2, 3}, {0, 2}, {1, 3}, {0, 3}, {1, 2} };
+
+        for (int i0 = 0; i0 < n; i0 += 4) {
+            const int nb = std::min(4, n - i0);
+
+            // S_ab = sum x_a y_b, four specimens side by side. Missing lanes get the identity.
+            alignas(32) double sl[9][4];
+            for (int l = 0; l < 4; l++) {
+                for (int a = 0; a < 3; a++) {
+                    for (int b = 0; b < 3; b++)
+                        sl[3 * a + b][l] = (l < nb) ? cov[9 * (i0 + l) + 3 * b + a] : (a == b ? 1.0 : 0.0);
+                }
+            }
+
+            __m256d S[9];
+            for (int j = 0; j < 9; j++)
+                S[j] = _mm256_load_pd(sl[j]);
+
+            // Horn's symmetric 4x4 matrix. Its dominant eigenvector is the quaternion of the rotation.
+            __m256d A[4][4];
+            A[0][0] = _mm256_add_pd(_mm256_add_pd(S[0], S[4]), S[8]);
+            A[1][1] = _mm256_sub_pd(_mm256_sub_pd(S[0], S[4]), S[8]);
+            A[2][2] = _mm256_sub_pd(_mm256_sub_pd(S[4], S[0]), S[8]);
+            A[3][3] = _mm256_sub_pd(_mm256_sub_pd(S[8], S[0]), S[4]);
+            A[0][1] = _mm256_sub_pd(S[5], S[7]);
+            A[0][2] = _mm256_sub_pd(S[6], S[2]);
+            A[0][3] = _mm256_sub_pd(S[1], S[3]);
+            A[1][2] = _mm256_add_pd(S[1], S[3]);
+            A[1][3] = _mm256_add_pd(S[6], S[2]);
+            A[2][3] = _mm256_add_pd(S[5], S[7]);
+            for (int r = 0; r < 4; r++) {
+                for (int c = 0; c < r; c++)
+                    A[r][c] = A[c][r];
+            }
+
+            __m256d V[4][4];
+            for (int r = 0; r < 4; r++) {
+                for (int c = 0; c < 4; c++)
+                    V[r][c] = _mm256_set1_pd(r == c ? 1.0 : 0.0);
+            }
+
+            // Cyclic Jacobi with a fixed number of sweeps, so that all lanes take the same path. 
+            // t = tan(phi) is the smaller root, formulated not to divide by zero when a_pq = 0.
+            const __m256d one = _mm256_set1_pd(1.0), two = _mm256_set1_pd(2.0), four = _mm256_set1_pd(4.0);
+            const __m256d tiny = _mm256_set1_pd(1e-300), sgnmask = _mm256_set1_pd(-0.0);
+            for (int sweep = 0; sweep < Sweeps; sweep++) {
+                for (const auto& pq : Pairs) {
+                    const int p = pq[0], q = pq[1];
+                    const __m256d apq = A[p][q];
+                    const __m256d tau = _mm256_sub_pd(A[q][q], A[p][p]);
+                    const __m256d den = _mm256_add_pd(_mm256_add_pd(_mm256_andnot_pd(sgnmask, tau),
+                        _mm256_sqrt_pd(_mm256_fmadd_pd(four, _mm256_mul_pd(apq, apq), _mm256_mul_pd(tau, tau)))), tiny);
+                    const __m256d t = _mm256_xor_pd(_mm256_div_pd(_mm256_mul_pd(two, apq), den), _mm256_and_pd(sgnmask, tau));
+                    const __m256d c = _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_fmadd_pd(t, t, one)));
+                    const __m256d sn = _mm256_mul_pd(t, c);
+
+                    A[p][p] = _mm256_fnmadd_pd(t, apq, A[p][p]);
+                    A[q][q] = _mm256_fmadd_pd(t, apq, A[q][q]);
+                    A[p][q] = A[q][p] = _mm256_setzero_pd();
+
+                    for (int r = 0; r < 4; r++) {
+                        if (r != p && r != q) {
+                            const __m256d arp = A[r][p], arq = A[r][q];
+                            A[r][p] = A[p][r] = _mm256_fmsub_pd(c, arp, _mm256_mul_pd(sn, arq));
+                            A[r][q] = A[q][r] = _mm256_fmadd_pd(sn, arp, _mm256_mul_pd(c, arq));
+                        }
+
+                        const __m256d vrp = V[r][p], vrq = V[r][q];
+                        V[r][p] = _mm256_fmsub_pd(c, vrp, _mm256_mul_pd(sn, vrq));
+                        V[r][q] = _mm256_fmadd_pd(sn, vrp, _mm256_mul_pd(c, vrq));
+                    }
+                }
+            }
+
+            // The largest eigenvalue and its vector, plus the second largest eigenvalue to tell whether
+            // the rotation is well determined.
+            __m256d best = A[0][0], second = _mm256_set1_pd(-DBL_MAX);
+            __m256d qv[4] = { V[0][0], V[1][0], V[2][0], V[3][0] };
+            for (int k = 1; k < 4; k++) {
+                const __m256d dk = A[k][k];
+                const __m256d gt = _mm256_cmp_pd(dk, best, _CMP_GT_OQ);
+                second = _mm256_blendv_pd(_mm256_max_pd(second, dk), best, gt);
+                best = _mm256_blendv_pd(best, dk, gt);
+                for (int r = 0; r < 4; r++)
+                    qv[r] = _mm256_blendv_pd(qv[r], V[r][k], gt);
+            }
+
+            alignas(32) double bl[4], sl2[4], ql[4][4];
+            _mm256_store_pd(bl, best);
+            _mm256_store_pd(sl2, second);
+            for (int r = 0; r < 4; r++)
+                _mm256_store_pd(ql[r], qv[r]);
+
+            for (int l = 0; l < nb; l++) {
+                const double w = ql[0][l], x = ql[1][l], y = ql[2][l], z = ql[3][l];
+                const double nq = w * w + x * x + y * y + z * z;
+                ok[i0 + l] = std::isfinite(bl[l]) && std::isfinite(nq) && nq > 0 &&
+                    (bl[l] - sl2[l]) > GapTol * (fabs(bl[l]) + DBL_MIN);
+
+                // rot = Q^T, where Q rotates column vectors x to y
+                const double k = 2.0 / nq;
+                float* r = rot + 9 * (i0 + l);
+                r[0] = (float)(1 - k * (y * y + z * z));
+                r[1] = (float)(k * (x * y + w * z));
+                r[2] = (float)(k * (x * z - w * y));
+                r[3] = (float)(k * (x * y - w * z));
+                r[4] = (float)(1 - k * (x * x + z * z));
+                r[5] = (float)(k * (y * z + w * x));
+                r[6] = (float)(k * (x * z + w * y));
+                r[7] = (float)(k * (y * z - w * x));
+                r[8] = (float)(1 - k * (x * x + y * y));
+            }
+        }
+    }
+
+    int opa_rot(const float* cov, int n, float* rot)
+    {
+        bool okl[16];
+        bool* ok = (n <= 16) ? okl : new bool[n];
+        opa_rot_horn(cov, n, rot, ok);
+
+        int ret = 0;
+        for (int i = 0; i < n; i++) {
+            if (!ok[i] && opa_rot_svd(cov + 9 * i, rot + 9 * i) != 0)
+                ret = -1;
+        }
+
+        if (ok != okl)
+            delete[] ok;
+
+        return ret;
+    }
+
+    // Centroid, centroid size and the covariance with y of x, as in opa_fit.
+    static void opa_prepare(const float* x, const float* y, const void* allow, int d, int m, float* xoffs, float* xcs, float* cov)
+    {
+        float cs = 0;
+        if (allow) {
+            pcl_center(x, allow, d, m, xoffs);
+            cs = pcl_cs(x, allow, d, m, xoffs);
+            opa_cov(x, y, allow, d, m, xoffs, cs, cov);
+        } else {
+            pcl_center(x, d, m, xoffs);
+            cs = pcl_cs(x, d, m, xoffs);            
+            opa_cov(x, y, d, m, xoffs, cs, cov);
+        }
+
+        *xcs = cs;
+    }
+
+    int opa_fit(const float* x, const float* y, const void* allow, int d, int m, float* xoffs, float* xcs, float* rot)
+    {
+        WCORE_ASSERT(d == 3); // static cov size
+
+        float cov[9];
+        opa_prepare(x, y, allow, d, m, xoffs, xcs, cov);
+        return opa_rot(cov, 1, rot);
+    }
+
+    int opa_fit_batch(const float** x, const float* y, const void* allow, int d, int n, int m, rigid3* xforms)
+    {
+        WCORE_ASSERT(d == 3);
+
+        float* cov = new float[9 * n];
+        float* rot = new float[9 * n];
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < n; i++)
+            opa_prepare(x[i], y, allow, d, m, xforms[i].offs, &xforms[i].cs, cov + 9 * i);
+
+        const int ret = opa_rot(cov, n, rot);
+        for (int i = 0; i < n; i++)
+            memcpy(xforms[i].rot, rot + 9 * i, sizeof(float) * 9);
+
+        delete[] rot;
+        delete[] cov;
+        return ret;
+    }
+
     void gpa_init_mean(const float* x, int d, int m, float* mean)
     {
         WCORE_ASSERT(d == 3);
@@ -119,11 +465,26 @@ namespace warpcore::impl
 
     void gpa_update_mean(const float** data, int d, int n, int m, const rigid3* xforms, float* mean) 
     {
-        pcl_transform(data[0], d, m, false, 1.0f / xforms[0].cs, xforms[0].offs, xforms[0].rot, mean);
-        for(int i = 1; i < n; i++)
-            pcl_transform(data[i], d, m, true, 1.0f / xforms[i].cs, xforms[i].offs, xforms[i].rot, mean);
+        constexpr int BLOCK = 2048;
+        const int nb = (m + BLOCK - 1) / BLOCK;
+        const float rn = 1.0f / n;
+
+        // Blocks of vertices are accumulated independently, each over all specimens in order. The
+        // sums are the same as in a serial pass regardless of the number of threads and a block
+        // of the mean stays in cache while the specimens stream by.
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < nb; b++) {
+            const int i0 = b * BLOCK;
+            const int mb = std::min(BLOCK, m - i0);
+            float* meanb = mean + d * i0;
+
+            pcl_transform(data[0] + d * i0, d, mb, false, 1.0f / xforms[0].cs, xforms[0].offs, xforms[0].rot, meanb);
+            for (int i = 1; i < n; i++)
+                pcl_transform(data[i] + d * i0, d, mb, true, 1.0f / xforms[i].cs, xforms[i].offs, xforms[i].rot, meanb);
 
-        cblas_sscal(d * m, 1.0f / n, mean, 1);
+            for (int j = 0; j < d * mb; j++)
+                meanb[j] *= rn;
+        }
     }
 
     void rigid_combine(rigid3* ret, const rigid3* f, const rigid3* g)
@@ -171,17 +532,4 @@ namespace warpcore::impl
         SWAP(5, 7);
     }
 
-    void extract_mat3_transpose(float* dest, __m128 row0, __m128 row1, __m128 row2)
-    {
-        int* icov = (int*)dest;
-        icov[0] = _mm_extract_ps(row0, 0);
-        icov[1] = _mm_extract_ps(row1, 0);
-        icov[2] = _mm_extract_ps(row2, 0);
-        icov[3] = _mm_extract_ps(row0, 1);
-        icov[4] = _mm_extract_ps(row1, 1);
-        icov[5] = _mm_extract_ps(row2, 1);
-        icov[6] = _mm_extract_ps(row0, 2);
-        icov[7] = _mm_extract_ps(row1, 2);
-        icov[8] = _mm_extract_ps(row2, 2);
-    }
 };
\ No newline at end of file
@@ -4,7 +4,39 @@
 namespace warpcore::impl
 {
     int opa_fit(const float* x, const float* y, const void* allow, int d, int m, float* xoffs, float* xcs, float* rot);
+
+    // opa_fit for n specimens x[i] against the same y, writing xforms[i].offs, cs and rot.
+    int opa_fit_batch(const float** x, const float* y, const void* allow, int d, int n, int m, rigid3* xforms);
+
+    // Kabsch rotations for n 3x3 covariances cov[3a+b] = sum y_a x_b (as made by opa_cov). Horn's 
+    // quaternion method runs on four covariances at a time and falls back to the SVD where the 
+    // rotation is not well determined. Returns -1 if the SVD failed for any of them.
+    int opa_rot(const float* cov, int n, float* rot);
+
+    // Horn's method only, ok[i] tells if the rotation for cov[i] is well determined.
+    void opa_rot_horn(const float* cov, int n, float* rot, bool* ok);
+
+    // The SVD path. Returns -1 on failure.
+    int opa_rot_svd(const float* cov, float* rot);
+
     void gpa_init_mean(const float* x, int d, int m, float* mean);
     void gpa_update_mean(const float** data, int d, int n, int m, const rigid3* xforms, float* mean);
     void rigid_combine(rigid3* ret, const rigid3* f, const rigid3* g);
+
+    // Anderson acceleration of a fixed point iteration x <- g(x) on vectors of length len, keeping
+    // up to depth previous differences of g(x) and of the residuals f = g(x) - x.
+    struct anderson {
+        int len, depth, count;
+        float* df;
+        float* dg;
+        float* f_prev;
+        float* g_prev;
+    };
+
+    void anderson_init(anderson* aa, int len, int depth);
+    void anderson_destroy(anderson* aa);
+    void anderson_reset(anderson* aa);
+
+    // Given x and gx = g(x), writes the next iterate into xnext, which may alias x.
+    void anderson_step(anderson* aa, const float* x, const float* gx, float* xnext);
 };
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "icp_impl.h"
+#include "tri_grid_nn.h"
+#include "search_impl.h"
+#include "gpa_impl.h"
+#include "pcl_utils.h"
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <lapacke.h>
+
+namespace warpcore::impl
+{
+    int icp_correspondences(const trigrid* grid, const float* vert, const int* idx, const float* y, int m, float max_dist, icp_corr* corr)
+    {
+        int nhit = 0;
+
+        #pragma omp parallel for schedule(dynamic, 256) reduction(+: nhit)
+        for (int i = 0; i < m; i++) {
+            alignas(16) float res[PtTri_DPtBary::ResultSize];
+            icp_corr& c = corr[i];
+            c.tri = trigrid_nn<PtTri_DPtBary>(grid, y + 3 * i, max_dist, res);
+            if (c.tri < 0)
+                continue;
+
+            c.d = res[0];
+            c.q[0] = res[1];
+            c.q[1] = res[2];
+            c.q[2] = res[3];
+
+            const float* a = vert + 3 * idx[3 * c.tri];
+            const float* b = vert + 3 * idx[3 * c.tri + 1];
+            const float* cc = vert + 3 * idx[3 * c.tri + 2];
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { cc[0] - a[0], cc[1] - a[1], cc[2] - a[2] };
+            c.n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+            c.n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+            c.n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+            const float len = sqrtf(c.n[0] * c.n[0] + c.n[1] * c.n[1] + c.n[2] * c.n[2]);
+            const float rlen = (len > 0) ? (1.0f / len) : 0.0f;
+            c.n[0] *= rlen;
+            c.n[1] *= rlen;
+            c.n[2] *= rlen;
+            nhit++;
+        }
+
+        return nhit;
+    }
+
+    int icp_trim(icp_corr* corr, int m, float trim, float& rms)
+    {
+        std::vector<float> d;
+        d.reserve(m);
+        for (int i = 0; i < m; i++) {
+            if (corr[i].tri >= 0)
+                d.push_back(corr[i].d);
+        }
+
+        float thresh = FLT_MAX;
+        if (trim > 0 && !d.empty()) {
+            const size_t keep = std::max<size_t>(1, (size_t)ceilf((1.0f - trim) * d.size()));
+            std::nth_element(d.begin(), d.begin() + (keep - 1), d.end());
+            thresh = d[keep - 1];
+        }
+
+        int ret = 0;
+        double sum2 = 0;
+        for (int i = 0; i < m; i++) {
+            if (corr[i].tri < 0)
+                continue;
+
+            if (corr[i].d > thresh) {
+                corr[i].tri = -1;
+            } else {
+                sum2 += (double)corr[i].d * corr[i].d;
+                ret++;
+            }
+        }
+
+        rms = (ret > 0) ? (float)sqrt(sum2 / ret) : 0.0f;
+        return ret;
+    }
+
+    // Make inc the transform y -> s * (y - c) * rot + t, where rot is applied to row vectors.
+    static void icp_make_update(const float* c, const float* t, const float* rot, float s, rigid3* inc)
+    {
+        // ((y - offs) * rot) / cs = s * (y - c) * rot + t, given rot * rot^T = I
+        inc->cs = 1.0f / s;
+        for (int j = 0; j < 3; j++)
+            inc->offs[j] = c[j] - (t[0] * rot[3 * j] + t[1] * rot[3 * j + 1] + t[2] * rot[3 * j + 2]) / s;
+
+        memcpy(inc->rot, rot, sizeof(float) * 9);
+    }
+
+    bool icp_step_point(const float* y, const icp_corr* corr, int m, bool scale, rigid3* inc)
+    {
+        std::vector<float> ys, qs;
+        ys.reserve(3 * m);
+        qs.reserve(3 * m);
+        for (int i = 0; i < m; i++) {
+            if (corr[i].tri < 0)
+                continue;
+
+            ys.insert(ys.end(), y + 3 * i, y + 3 * i + 3);
+            qs.insert(qs.end(), corr[i].q, corr[i].q + 3);
+        }
+
+        const int k = (int)(ys.size() / 3);
+        if (k < 3)
+            return false;
+
+        // opa_fit centers and scales the floating points, but expects the template centered.
+        float qc[4], yc[4], ycs, rot[9];
+        pcl_center(qs.data(), 3, k, qc);
+        const float qcs = pcl_cs(qs.data(), 3, k, qc);
+        pcl_transform(qs.data(), 3, k, false, 1.0f, qc, qs.data());
+
+        if (opa_fit(ys.data(), qs.data(), nullptr, 3, k, yc, &ycs, rot) != 0)
+            return false;
+
+        icp_make_update(yc, qc, rot, scale ? (qcs / ycs) : 1.0f, inc);
+        return true;
+    }
+
+    bool icp_step_plane(const float* y, const icp_corr* corr, int m, rigid3* inc)
+    {
+        // Rotate by a small angle w about the centroid c and shift by t. Linearized, each 
+        // correspondence contributes a residual ((y - c) x n) . w + n . t + (y - q) . n.
+        double yc[3] = { 0, 0, 0 };
+        int k = 0;
+        for (int i = 0; i < m; i++) {
+            if (corr[i].tri < 0)
+                continue;
+
+            yc[0] += y[3 * i];
+            yc[1] += y[3 * i + 1];
+            yc[2] += y[3 * i + 2];
+            k++;
+        }
+
+        if (k < 6)
+            return false;
+
+        const float c[3] = { (float)(yc[0] / k), (float)(yc[1] / k), (float)(yc[2] / k) };
+
+        double ata[36], atb[6];
+        memset(ata, 0, sizeof(ata));
+        memset(atb, 0, sizeof(atb));
+        for (int i = 0; i < m; i++) {
+            const icp_corr& cr = corr[i];
+            if (cr.tri < 0)
+                continue;
+
+            const float* yi = y + 3 * i;
+            const float p[3] = { yi[0] - c[0], yi[1] - c[1], yi[2] - c[2] };
+            const double a[6] = {
+                p[1] * cr.n[2] - p[2] * cr.n[1],
+                p[2] * cr.n[0] - p[0] * cr.n[2],
+                p[0] * cr.n[1] - p[1] * cr.n[0],
+                cr.n[0], cr.n[1], cr.n[2]
+            };
+            const double r = (yi[0] - cr.q[0]) * cr.n[0] + (yi[1] - cr.q[1]) * cr.n[1] + (yi[2] - cr.q[2]) * cr.n[2];
+
+            for (int u = 0; u < 6; u++) {
+                for (int v = 0; v <= u; v++)
+                    ata[6 * u + v] += a[u] * a[v];
+
+                atb[u] -= a[u] * r;
+            }
+        }
+
+        // A flat or rotationally symmetric target leaves some directions unconstrained. A little
+        // damping keeps the system solvable and the update small there.
+        double tr = 0;
+        for (int u = 0; u < 6; u++)
+            tr += ata[7 * u];
+
+        float af[36], bf[6];
+        for (int u = 0; u < 6; u++) {
+            for (int v = 0; v <= u; v++)
+                af[6 * u + v] = af[6 * v + u] = (float)ata[6 * u + v];
+
+            af[7 * u] += (float)(1e-6 * tr / 6 + 1e-12);
+            bf[u] = (float)atb[u];
+        }
+
+        if (LAPACKE_sposv(LAPACK_COL_MAJOR, 'L', 6, 1, af, 6, bf, 6) != 0)
+            return false;
+
+        // Rodrigues' formula for the rotation by |w| about w, in the row vector convention.
+        const float* w = bf;
+        const float theta = sqrtf(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+        float rot[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+        if (theta > 0) {
+            const float kx = w[0] / theta, ky = w[1] / theta, kz = w[2] / theta;
+            const float s = sinf(theta), cc = 1 - cosf(theta);
+            const float rc[9] = {
+                1 - cc * (ky * ky + kz * kz), -s * kz + cc * kx * ky, s * ky + cc * kx * kz,
+                s * kz + cc * kx * ky, 1 - cc * (kx * kx + kz * kz), -s * kx + cc * ky * kz,
+                -s * ky + cc * kx * kz, s * kx + cc * ky * kz, 1 - cc * (kx * kx + ky * ky)
+            };
+
+            for (int u = 0; u < 3; u++) {
+                for (int v = 0; v < 3; v++)
+                    rot[3 * u + v] = rc[3 * v + u];
+            }
+        }
+
+        const float t[3] = { c[0] + bf[3], c[1] + bf[4], c[2] + bf[5] };
+        icp_make_update(c, t, rot, 1.0f, inc);
+        return true;
+    }
+
+    void icp_apply_update(rigid3* xform, const rigid3* inc)
+    {
+        // inc(xform(x)) = ((x - offs - cs * inc.offs * rot^T) * rot * inc.rot) / (cs * inc.cs)
+        const float* R = xform->rot;
+        const float* H = inc->rot;
+        rigid3 ret;
+
+        ret.cs = xform->cs * inc->cs;
+        for (int i = 0; i < 3; i++) {
+            ret.offs[i] = xform->offs[i] + xform->cs * (R[3 * i] * inc->offs[0] + R[3 * i + 1] * inc->offs[1] + R[3 * i + 2] * inc->offs[2]);
+            for (int j = 0; j < 3; j++)
+                ret.rot[3 * i + j] = R[3 * i] * H[j] + R[3 * i + 1] * H[3 + j] + R[3 * i + 2] * H[6 + j];
+        }
+
+        *xform = ret;
+    }
+
+    void icp_transform(const float* x, const int* sel, int m, const rigid3* xform, float* y)
+    {
+        if (!sel) {
+            pcl_transform(x, 3, m, false, 1.0f / xform->cs, xform->offs, xform->rot, y);
+            return;
+        }
+
+        const float* r = xform->rot;
+        const float s = 1.0f / xform->cs;
+        for (int i = 0; i < m; i++) {
+            const float* xi = x + 3 * sel[i];
+            const float p[3] = { xi[0] - xform->offs[0], xi[1] - xform->offs[1], xi[2] - xform->offs[2] };
+            y[3 * i] = s * (p[0] * r[0] + p[1] * r[3] + p[2] * r[6]);
+            y[3 * i + 1] = s * (p[0] * r[1] + p[1] * r[4] + p[2] * r[7]);
+            y[3 * i + 2] = s * (p[0] * r[2] + p[1] * r[5] + p[2] * r[8]);
+        }
+    }
+};
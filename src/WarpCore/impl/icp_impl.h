@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../config.h"
+#include "../defs.h"
+#include "tri_grid.h"
+
+namespace warpcore::impl
+{
+    // Closest point q on the target mesh to a source point, the normal of the triangle tri that
+    // holds it and the distance d. tri is -1 if there is no target point within the search distance.
+    struct icp_corr {
+        float q[3];
+        float n[3];
+        float d;
+        int tri;
+    };
+
+    // Find correspondences for the m points y on the mesh (vert, idx) in grid, no further than max_dist.
+    // Returns the number of points that found one.
+    int icp_correspondences(const trigrid* grid, const float* vert, const int* idx, const float* y, int m, float max_dist, icp_corr* corr);
+
+    // Reject the correspondences with distance above the (1 - trim) quantile by setting their tri to -1.
+    // Returns the number of correspondences kept and writes their RMS distance to rms.
+    int icp_trim(icp_corr* corr, int m, float trim, float& rms);
+
+    // Find the transform that moves the points y closer to their correspondences, minimizing the
+    // point-to-point distances (Kabsch, optionally with scale) or the point-to-plane distances
+    // (linearized rotation). The update is written to inc, as in rigid_transform.
+    bool icp_step_point(const float* y, const icp_corr* corr, int m, bool scale, rigid3* inc);
+    bool icp_step_plane(const float* y, const icp_corr* corr, int m, rigid3* inc);
+
+    // Replace xform with inc applied after xform. Unlike rigid_combine, the offset of inc is taken
+    // in the units of the output of xform, so that inc is a transform of its own.
+    void icp_apply_update(rigid3* xform, const rigid3* inc);
+
+    // y[i] = xform(x[sel[i]]), for all m entries in sel. If sel is null, the first m points are taken.
+    void icp_transform(const float* x, const int* sel, int m, const rigid3* xform, float* y);
+};
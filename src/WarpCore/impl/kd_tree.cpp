@@ -0,0 +1,207 @@
+#include "kd_tree.h"
+#include "pcl_utils.h"
+#include <algorithm>
+#include <numeric>
+#include <float.h>
+#include <string.h>
+
+namespace warpcore::impl
+{
+    void kdtree_build_node(kdtree* tree, const float* pts, int* perm, int node, int begin, int end, int level);
+
+    inline bool kdtree_hit_less(const kdtree_hit& a, const kdtree_hit& b) noexcept
+    {
+        return a.d2 < b.d2;
+    }
+
+    inline float kdtree_dist2(const float* a, const float* b) noexcept
+    {
+        const float dx = a[0] - b[0];
+        const float dy = a[1] - b[1];
+        const float dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    void kdtree_build(kdtree* tree, const float* pts, int n, int leaf_size)
+    {
+        if (leaf_size < 1)
+            leaf_size = 1;
+
+        // Split until the leaves are small enough. Median splits keep the tree balanced, so
+        // every leaf ends up at the same depth.
+        int depth = 0;
+        while (((int64_t)leaf_size << depth) < n)
+            depth++;
+
+        tree->n = n;
+        tree->depth = depth;
+        tree->nodes = new kdtree_node[(2 << depth) - 1];
+
+        for (int i = 0; i < 4; i++) {
+            tree->x0[i] = FLT_MAX;
+            tree->x1[i] = -FLT_MAX;
+        }
+
+        pcl_aabb(pts, 3, n, tree->x0, tree->x1);
+        tree->x0[3] = tree->x1[3] = 0;
+
+        int* perm = new int[n];
+        std::iota(perm, perm + n, 0);
+        kdtree_build_node(tree, pts, perm, 0, 0, n, 0);
+
+        tree->pts = new float[3 * n];
+        for (int i = 0; i < n; i++) {
+            tree->pts[3 * i] = pts[3 * perm[i]];
+            tree->pts[3 * i + 1] = pts[3 * perm[i] + 1];
+            tree->pts[3 * i + 2] = pts[3 * perm[i] + 2];
+        }
+
+        tree->orig_idx = perm;
+    }
+
+    void kdtree_destroy(kdtree* tree)
+    {
+        delete[] tree->nodes;
+        delete[] tree->pts;
+        delete[] tree->orig_idx;
+
+        tree->nodes = nullptr;
+        tree->pts = nullptr;
+        tree->orig_idx = nullptr;
+    }
+
+    void kdtree_build_node(kdtree* tree, const float* pts, int* perm, int node, int begin, int end, int level)
+    {
+        kdtree_node& nd = tree->nodes[node];
+        nd.begin = begin;
+        nd.end = end;
+        nd.split = 0;
+        nd.axis = -1;
+
+        if (level == tree->depth)
+            return;
+
+        // Split along the longest side of the range's bounding box.
+        float x0[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float x1[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (int i = begin; i < end; i++) {
+            for (int j = 0; j < 3; j++) {
+                x0[j] = std::min(x0[j], pts[3 * perm[i] + j]);
+                x1[j] = std::max(x1[j], pts[3 * perm[i] + j]);
+            }
+        }
+
+        int axis = 0;
+        for (int j = 1; j < 3; j++) {
+            if (x1[j] - x0[j] > x1[axis] - x0[axis])
+                axis = j;
+        }
+
+        const int mid = (begin + end) / 2;
+        if (mid < end) {
+            std::nth_element(perm + begin, perm + mid, perm + end,
+                [pts, axis](int a, int b) { return pts[3 * a + axis] < pts[3 * b + axis]; });
+            nd.split = pts[3 * perm[mid] + axis];
+        }
+
+        nd.axis = axis;
+        kdtree_build_node(tree, pts, perm, 2 * node + 1, begin, mid, level + 1);
+        kdtree_build_node(tree, pts, perm, 2 * node + 2, mid, end, level + 1);
+    }
+
+    void kdtree_knn_inner(const kdtree* tree, int node, const float* q, int k, float& worst, kdtree_hit* hits, int& nhits) noexcept
+    {
+        const kdtree_node& nd = tree->nodes[node];
+
+        if (nd.axis < 0) {
+            for (int i = nd.begin; i < nd.end; i++) {
+                const float d2 = kdtree_dist2(q, tree->pts + 3 * i);
+                if (d2 > worst)
+                    continue;
+
+                if (nhits < k) {
+                    hits[nhits++] = { d2, i };
+                    std::push_heap(hits, hits + nhits, kdtree_hit_less);
+                } else {
+                    std::pop_heap(hits, hits + k, kdtree_hit_less);
+                    hits[k - 1] = { d2, i };
+                    std::push_heap(hits, hits + k, kdtree_hit_less);
+                }
+
+                if (nhits == k)
+                    worst = std::min(worst, hits[0].d2);
+            }
+            return;
+        }
+
+        const float diff = q[nd.axis] - nd.split;
+        const int near_child = (diff <= 0) ? (2 * node + 1) : (2 * node + 2);
+        const int far_child = (diff <= 0) ? (2 * node + 2) : (2 * node + 1);
+
+        kdtree_knn_inner(tree, near_child, q, k, worst, hits, nhits);
+
+        if (diff * diff <= worst)
+            kdtree_knn_inner(tree, far_child, q, k, worst, hits, nhits);
+    }
+
+    int kdtree_knn(const kdtree* tree, const float* q, int k, float max_dist, kdtree_hit* hits) noexcept
+    {
+        if (k <= 0)
+            return 0;
+
+        // hits is kept as a max-heap during the descent, so that the worst of the k best is on top.
+        float worst = max_dist * max_dist;
+        int nhits = 0;
+        kdtree_knn_inner(tree, 0, q, k, worst, hits, nhits);
+        std::sort_heap(hits, hits + nhits, kdtree_hit_less);
+
+        for (int i = 0; i < nhits; i++)
+            hits[i].idx = tree->orig_idx[hits[i].idx];
+
+        return nhits;
+    }
+
+    template<typename TFun>
+    void kdtree_radius_inner(const kdtree* tree, int node, const float* q, float r, TFun& fun)
+    {
+        const kdtree_node& nd = tree->nodes[node];
+
+        if (nd.axis < 0) {
+            const float r2 = r * r;
+            for (int i = nd.begin; i < nd.end; i++) {
+                const float d2 = kdtree_dist2(q, tree->pts + 3 * i);
+                if (d2 <= r2)
+                    fun(d2, i);
+            }
+            return;
+        }
+
+        const float diff = q[nd.axis] - nd.split;
+        if (diff <= r)
+            kdtree_radius_inner(tree, 2 * node + 1, q, r, fun);
+
+        if (diff >= -r)
+            kdtree_radius_inner(tree, 2 * node + 2, q, r, fun);
+    }
+
+    int kdtree_radius_count(const kdtree* tree, const float* q, float r) noexcept
+    {
+        int count = 0;
+        auto fun = [&count](float, int) { count++; };
+        kdtree_radius_inner(tree, 0, q, r, fun);
+        return count;
+    }
+
+    int kdtree_radius(const kdtree* tree, const float* q, float r, std::vector<kdtree_hit>& hits)
+    {
+        hits.clear();
+        auto fun = [&hits](float d2, int i) { hits.push_back({ d2, i }); };
+        kdtree_radius_inner(tree, 0, q, r, fun);
+        std::sort(hits.begin(), hits.end(), kdtree_hit_less);
+
+        for (kdtree_hit& h : hits)
+            h.idx = tree->orig_idx[h.idx];
+
+        return (int)hits.size();
+    }
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace warpcore::impl
+{
+    // Nodes are stored as a complete binary tree in breadth-first order, the children of
+    // node i are 2i+1 and 2i+2. All leaves are at the same depth and hold the points
+    // [begin, end) of kdtree::pts. Inner nodes split their range at the median along axis.
+    struct kdtree_node {
+        float split;
+        int axis;
+        int begin, end;
+    };
+
+    // Points are reordered to follow the leaves, orig_idx maps them back to the input.
+    struct kdtree {
+        int __magic;
+        int n;
+        int depth;
+
+        float x0[4];
+        float x1[4];
+
+        kdtree_node* nodes;
+        float* pts;
+        int* orig_idx;
+    };
+
+    struct kdtree_hit {
+        float d2;
+        int idx;
+    };
+
+    void kdtree_build(kdtree* tree, const float* pts, int n, int leaf_size);
+    void kdtree_destroy(kdtree* tree);
+
+    // Find up to k nearest points to q no further than max_dist and write them to hits, sorted by
+    // increasing distance. Returns the number of points found.
+    int kdtree_knn(const kdtree* tree, const float* q, int k, float max_dist, kdtree_hit* hits) noexcept;
+
+    // Count the points that are no further than r from q.
+    int kdtree_radius_count(const kdtree* tree, const float* q, float r) noexcept;
+
+    // Replace the contents of hits with the points that are no further than r from q, sorted by
+    // increasing distance. Returns the number of points found.
+    int kdtree_radius(const kdtree* tree, const float* q, float r, std::vector<kdtree_hit>& hits);
+};
@@ -0,0 +1,244 @@
+#include "nicp_impl.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace warpcore::impl
+{
+    bool mesh_adjacency(const int* idx, int m, int nt, std::vector<int>& offs, std::vector<int>& adj)
+    {
+        for (int i = 0; i < 3 * nt; i++) {
+            if (idx[i] < 0 || idx[i] >= m)
+                return false;
+        }
+
+        std::vector<int64_t> edges;
+        edges.reserve(6 * (size_t)nt);
+        for (int i = 0; i < nt; i++) {
+            for (int j = 0; j < 3; j++) {
+                const int64_t a = idx[3 * i + j];
+                const int64_t b = idx[3 * i + (j + 1) % 3];
+                if (a == b)
+                    continue;
+
+                edges.push_back((a << 32) | b);
+                edges.push_back((b << 32) | a);
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        offs.assign(m + 1, 0);
+        adj.resize(edges.size());
+        for (size_t i = 0; i < edges.size(); i++) {
+            offs[(edges[i] >> 32) + 1]++;
+            adj[i] = (int)(edges[i] & 0xffffffff);
+        }
+
+        for (int i = 0; i < m; i++)
+            offs[i + 1] += offs[i];
+
+        return true;
+    }
+
+    void nicp_apply(const nicp_system& sys, const float* x, float* y)
+    {
+        const float g[4] = { sys.alpha2, sys.alpha2, sys.alpha2, sys.alpha2 * sys.gamma2 };
+
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (int i = 0; i < sys.m; i++) {
+            const float* xi = x + 12 * i;
+            float* yi = y + 12 * i;
+
+            // Stiffness, the graph Laplacian applied to each row of X, weighted by G^2.
+            const int deg = sys.offs[i + 1] - sys.offs[i];
+            float lap[12];
+            for (int k = 0; k < 12; k++)
+                lap[k] = deg * xi[k];
+
+            for (int e = sys.offs[i]; e < sys.offs[i + 1]; e++) {
+                const float* xj = x + 12 * sys.adj[e];
+                for (int k = 0; k < 12; k++)
+                    lap[k] -= xj[k];
+            }
+
+            for (int r = 0; r < 4; r++) {
+                for (int c = 0; c < 3; c++)
+                    yi[3 * r + c] = g[r] * lap[3 * r + c] + sys.eps * xi[3 * r + c];
+            }
+
+            // Data, w [v 1]^T [v 1] X.
+            const float wi = sys.w[i];
+            if (wi > 0) {
+                const float vh[4] = { sys.v[3 * i], sys.v[3 * i + 1], sys.v[3 * i + 2], 1.0f };
+                for (int c = 0; c < 3; c++) {
+                    const float p = wi * (vh[0] * xi[c] + vh[1] * xi[3 + c] + vh[2] * xi[6 + c] + xi[9 + c]);
+                    for (int r = 0; r < 4; r++)
+                        yi[3 * r + c] += vh[r] * p;
+                }
+            }
+        }
+    }
+
+    void nicp_rhs(const nicp_system& sys, const float* u, const float* x0, float* b)
+    {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < sys.m; i++) {
+            const float vh[4] = { sys.v[3 * i], sys.v[3 * i + 1], sys.v[3 * i + 2], 1.0f };
+            const float wi = sys.w[i];
+            for (int r = 0; r < 4; r++) {
+                for (int c = 0; c < 3; c++)
+                    b[12 * i + 3 * r + c] = wi * vh[r] * u[3 * i + c] + sys.eps * x0[12 * i + 3 * r + c];
+            }
+        }
+    }
+
+    // Cholesky factor L of the 4x4 diagonal block of vertex i, packed by rows (10 floats).
+    static void nicp_block_factor(const nicp_system& sys, int i, float* l)
+    {
+        const double deg = sys.offs[i + 1] - sys.offs[i];
+        const double g[4] = { sys.alpha2, sys.alpha2, sys.alpha2, (double)sys.alpha2 * sys.gamma2 };
+        const double vh[4] = { sys.v[3 * i], sys.v[3 * i + 1], sys.v[3 * i + 2], 1.0 };
+
+        double a[16];
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++)
+                a[4 * r + c] = sys.w[i] * vh[r] * vh[c];
+
+            a[5 * r] += deg * g[r] + sys.eps;
+        }
+
+        double ld[16] = { 0 };
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c <= r; c++) {
+                double s = a[4 * r + c];
+                for (int k = 0; k < c; k++)
+                    s -= ld[4 * r + k] * ld[4 * c + k];
+
+                ld[4 * r + c] = (r == c) ? sqrt(std::max(s, 1e-30)) : (s / ld[5 * c]);
+            }
+        }
+
+        for (int r = 0, k = 0; r < 4; r++) {
+            for (int c = 0; c <= r; c++)
+                l[k++] = (float)ld[4 * r + c];
+        }
+    }
+
+    // z = (L L^T)^-1 r for each of the three columns.
+    static void nicp_block_solve(const float* l, const float* r, float* z)
+    {
+        const float l00 = l[0], l10 = l[1], l11 = l[2], l20 = l[3], l21 = l[4], l22 = l[5];
+        const float l30 = l[6], l31 = l[7], l32 = l[8], l33 = l[9];
+
+        for (int c = 0; c < 3; c++) {
+            const float y0 = r[c] / l00;
+            const float y1 = (r[3 + c] - l10 * y0) / l11;
+            const float y2 = (r[6 + c] - l20 * y0 - l21 * y1) / l22;
+            const float y3 = (r[9 + c] - l30 * y0 - l31 * y1 - l32 * y2) / l33;
+
+            const float x3 = y3 / l33;
+            const float x2 = (y2 - l32 * x3) / l22;
+            const float x1 = (y1 - l21 * x2 - l31 * x3) / l11;
+            const float x0 = (y0 - l10 * x1 - l20 * x2 - l30 * x3) / l00;
+            z[c] = x0;
+            z[3 + c] = x1;
+            z[6 + c] = x2;
+            z[9 + c] = x3;
+        }
+    }
+
+    int nicp_solve(const nicp_system& sys, const float* b, float* x, int max_iter, float tol)
+    {
+        const int m = sys.m;
+        const int64_t n = 12 * (int64_t)m;
+        float* l = new float[10 * (size_t)m];
+        float* r = new float[n];
+        float* z = new float[n];
+        float* p = new float[n];
+        float* ap = new float[n];
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < m; i++)
+            nicp_block_factor(sys, i, l + 10 * i);
+
+        nicp_apply(sys, x, ap);
+
+        double rz = 0, bb = 0;
+        #pragma omp parallel for schedule(static) reduction(+: rz, bb)
+        for (int i = 0; i < m; i++) {
+            for (int k = 12 * i; k < 12 * i + 12; k++) {
+                r[k] = b[k] - ap[k];
+                bb += (double)b[k] * b[k];
+            }
+
+            nicp_block_solve(l + 10 * i, r + 12 * i, z + 12 * i);
+            for (int k = 12 * i; k < 12 * i + 12; k++) {
+                p[k] = z[k];
+                rz += (double)r[k] * z[k];
+            }
+        }
+
+        const double thresh = (double)tol * tol * bb;
+        int it = 0;
+        for (; it < max_iter; it++) {
+            nicp_apply(sys, p, ap);
+
+            double pap = 0;
+            #pragma omp parallel for schedule(static) reduction(+: pap)
+            for (int64_t k = 0; k < n; k++)
+                pap += (double)p[k] * ap[k];
+
+            if (pap <= 0)
+                break;
+
+            const float alpha = (float)(rz / pap);
+            double rz_new = 0, rr = 0;
+
+            #pragma omp parallel for schedule(static) reduction(+: rz_new, rr)
+            for (int i = 0; i < m; i++) {
+                for (int k = 12 * i; k < 12 * i + 12; k++) {
+                    x[k] += alpha * p[k];
+                    r[k] -= alpha * ap[k];
+                    rr += (double)r[k] * r[k];
+                }
+
+                nicp_block_solve(l + 10 * i, r + 12 * i, z + 12 * i);
+                for (int k = 12 * i; k < 12 * i + 12; k++)
+                    rz_new += (double)r[k] * z[k];
+            }
+
+            if (rr <= thresh) {
+                it++;
+                break;
+            }
+
+            const float beta = (float)(rz_new / rz);
+            rz = rz_new;
+
+            #pragma omp parallel for schedule(static)
+            for (int64_t k = 0; k < n; k++)
+                p[k] = z[k] + beta * p[k];
+        }
+
+        delete[] ap;
+        delete[] p;
+        delete[] z;
+        delete[] r;
+        delete[] l;
+
+        return it;
+    }
+
+    void nicp_deform(const float* v, const float* x, int m, float* y)
+    {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < m; i++) {
+            const float* vi = v + 3 * i;
+            const float* xi = x + 12 * i;
+            for (int c = 0; c < 3; c++)
+                y[3 * i + c] = vi[0] * xi[c] + vi[1] * xi[3 + c] + vi[2] * xi[6 + c] + xi[9 + c];
+        }
+    }
+};
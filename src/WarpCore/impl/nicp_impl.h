@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../config.h"
+#include <vector>
+
+namespace warpcore::impl
+{
+    // Vertex adjacency of a triangle mesh with m vertices in CSR form, the neighbours of vertex i are 
+    // adj[offs[i]] .. adj[offs[i+1]-1]. Each undirected edge appears once in each direction.
+    // Returns false if idx refers to a vertex outside [0, m).
+    bool mesh_adjacency(const int* idx, int m, int nt, std::vector<int>& offs, std::vector<int>& adj);
+
+    // Normal equations of the optimal step non-rigid ICP. Each template vertex v has its own affine 
+    // transform X (4x3, row-major, 12 floats), so that the vertex moves to [v 1] X. The energy is
+    //   alpha2 * sum over edges (i,j) |G (X_i - X_j)|^2 + sum_i w_i |[v_i 1] X_i - u_i|^2 + eps |X - X0|^2
+    // with G = diag(1, 1, 1, gamma) and u_i the correspondences. The last term keeps the system 
+    // positive definite where neither stiffness nor data constrain it.
+    struct nicp_system {
+        int m;
+        const int* offs;
+        const int* adj;
+        const float* v;
+        const float* w;
+        float alpha2, gamma2, eps;
+    };
+
+    // y = A x
+    void nicp_apply(const nicp_system& sys, const float* x, float* y);
+
+    // b = sum_i w_i [v_i 1]^T u_i + eps X0
+    void nicp_rhs(const nicp_system& sys, const float* u, const float* x0, float* b);
+
+    // Solve A x = b with conjugate gradients, preconditioned by the 4x4 diagonal blocks of A. x holds the
+    // initial guess. Returns the number of iterations taken.
+    int nicp_solve(const nicp_system& sys, const float* b, float* x, int max_iter, float tol);
+
+    // y_i = [v_i 1] X_i
+    void nicp_deform(const float* v, const float* x, int m, float* y);
+};
@@ -6,6 +6,7 @@
 #include "utils.h"
 #include "math.h"
 #include <algorithm>
+#include <cstring>
 
 namespace warpcore::impl
 {
@@ -13,16 +14,15 @@ namespace warpcore::impl
     // see Bishop CM: Pattern Recognition and Machine Learning, 2007 -  section 12.1.4
     // Notation: n = datapoint count, m = datapoint dimension
 
-    void pca_covmat_base(const float** data, const float* mean, const void* allow, int n, int m, float* cov);
-    void pca_covmat_avx512(const float** data, const float* mean, const void* allow, int n, int m, float* cov);
-    float dot_centered_pred(const float* x, const float* y, const float* x0, const void* allow, int n);
+    // Largest panel of packed specimen data in floats, anything larger is processed in chunks of rows.
+    constexpr size_t PcaPanelSize = (size_t)1 << 26;
 
     void pca_mean(const float** data, int n, int m, float* mean)
     {
         constexpr int BlockSize = 8;
         int mb = round_down(m, BlockSize);
 
-        memset(mean, 0, sizeof(float) * n);
+        memset(mean, 0, sizeof(float) * m);
         for (int i = 0; i < n; i++) {
             const float* datai = data[i];
 
@@ -46,91 +46,126 @@ namespace warpcore::impl
             mean[j] *= f;
     }
 
-    void pca_covmat(const float** data, const float* mean, const void* allow, int n, int m, float* cov)
+    void pca_rows_make(const void* allow, int m, pca_rows& rows)
     {
-        if (has_feature(WCORE_OPTPATH::AVX512))
-            pca_covmat_avx512(data, mean, allow, n, m, cov);
-        else
-            pca_covmat_base(data, mean, allow, n, m, cov);
+        rows.count = 0;
+        rows.start.clear();
+        rows.offs.clear();
+        rows.len.clear();
+
+        int i = 0;
+        while (i < m) {
+            // Skip whole words of disallowed rows, then find the end of the run.
+            if (allow && (i & 31) == 0 && ((const uint32_t*)allow)[i >> 5] == 0) {
+                i += 32;
+                continue;
+            }
+
+            if (!is_allowed(allow, i)) {
+                i++;
+                continue;
+            }
+
+            int j = i + 1;
+            while (j < m && is_allowed(allow, j))
+                j++;
+
+            rows.start.push_back(i);
+            rows.offs.push_back(rows.count);
+            rows.len.push_back(j - i);
+            rows.count += j - i;
+            i = j;
+        }
     }
 
-    void pca_covmat_base(const float** data, const float* mean, const void* allow, int n, int m, float* cov)
+    void pca_rows_pack(const pca_rows& rows, const float* x, const float* mean, int r0, int r1, float* p)
     {
-        float norm = 1.0f / (n - 1);
-        const int* allowq = (const int*)allow;
+        // The run containing r0.
+        int k = (int)(std::upper_bound(rows.offs.begin(), rows.offs.end(), r0) - rows.offs.begin()) - 1;
+
+        for (int r = r0; r < r1; k++) {
+            const int skip = r - rows.offs[k];
+            const int len = std::min(rows.len[k] - skip, r1 - r);
+            const float* xk = x + rows.start[k] + skip;
+            float* pk = p + (r - r0);
+
+            if (mean) {
+                const float* mk = mean + rows.start[k] + skip;
+                for (int j = 0; j < len; j++)
+                    pk[j] = xk[j] - mk[j];
+            } else {
+                memcpy(pk, xk, sizeof(float) * len);
+            }
 
-        for (int i = 0; i < n; i++) {
-            const float* datai = data[i];
+            r += len;
+        }
+    }
 
-            for (int j = i; j < n; j++) {
-                const float* dataj = data[j];
-                float aa0 = 0;
-                for (int k = 0; k < m; k++) {
-                    if ((allowq[k >> 5] >> (k & 0x1f)) & 0x1) {
-                        aa0 += (datai[k] - mean[k]) * (dataj[k] - mean[k]);
-                    }
+    int pca_rows_compact(const pca_rows& rows, const float* mean, int r0, int r1, int n, float* p)
+    {
+        // The first run that ends after r0.
+        int k0 = (int)(std::upper_bound(rows.start.begin(), rows.start.end(), r0) - rows.start.begin()) - 1;
+        if (k0 < 0 || rows.start[k0] + rows.len[k0] <= r0)
+            k0++;
+
+        const int nk = (int)rows.start.size();
+        int kept = 0;
+        for (int k = k0; k < nk && rows.start[k] < r1; k++)
+            kept += std::min(rows.start[k] + rows.len[k], r1) - std::max(rows.start[k], r0);
+
+        // Columns are moved towards the start of the panel, so this must go in order.
+        const int mc = r1 - r0;
+        for (int i = 0; i < n; i++) {
+            const float* src = p + (size_t)i * mc;
+            float* dest = p + (size_t)i * kept;
+
+            for (int k = k0; k < nk && rows.start[k] < r1; k++) {
+                const int a = std::max(rows.start[k], r0);
+                const int b = std::min(rows.start[k] + rows.len[k], r1);
+
+                if (mean) {
+                    for (int r = a; r < b; r++)
+                        *(dest++) = src[r - r0] - mean[r];
+                } else {
+                    for (int r = a; r < b; r++)
+                        *(dest++) = src[r - r0];
                 }
-                aa0 *= norm;
-                cov[i * n + j] = aa0;
-                cov[j * n + i] = aa0;
             }
         }
+
+        return kept;
     }
 
-	void pca_covmat_avx512(const float** data, const float* mean, const void* allow, int n, int m, float* cov)
-	{
-        constexpr int BlockSize = 16;
-        constexpr int FullBlockMask = (1 << (BlockSize)) - 1;
-        int n2 = round_down(n, 2);
-        int m16 = round_down(m, BlockSize);
-        float norm = 1.0f / (n - 1);
-        const __mmask16* allowb = (const __mmask16*)allow;
+    void pca_covmat(const float** data, const float* mean, const void* allow, int n, int m, float* cov)
+    {
+        pca_rows rows;
+        pca_rows_make(allow, m, rows);
 
-        for (int i = 0; i < n; i++) {
-            const float* datai = data[i];
-            int n2i = ((i & 0x1) == 0) ? n2 : (n2 - 1);
-
-            for (int j = i; j < n2i; j += 2) {
-                __m512 a0 = _mm512_setzero_ps();
-                __m512 a1 = _mm512_setzero_ps();
-
-                for (int k = 0, ki = 0; k < m16; k += BlockSize, ki++) {
-                    int numOutOfRangeItems = std::max(0, k + BlockSize - m);
-                    __mmask16 allowMask = allowb[ki] & (FullBlockMask >> numOutOfRangeItems);
-                    __m512 meank = _mm512_loadu_ps(mean + k);
-                    __m512 coli = _mm512_sub_ps(_mm512_loadu_ps(datai + k), meank);
-                    __m512 colj0 = _mm512_sub_ps(_mm512_loadu_ps(data[j] + k), meank);
-                    __m512 colj1 = _mm512_sub_ps(_mm512_loadu_ps(data[j + 1] + k), meank);
-                    a0 = _mm512_mask_fmadd_ps(coli, allowMask, colj0, a0);
-                    a1 = _mm512_mask_fmadd_ps(coli, allowMask, colj1, a1);
-                }
+        const float norm = 1.0f / (n - 1);
+        const int chunk = (int)std::max<size_t>(1, std::min<size_t>(rows.count, PcaPanelSize / n));
+        float* panel = new float[(size_t)chunk * n];
 
-                float aa0 = reduce_add(a0) * norm;
-                float aa1 = reduce_add(a1) * norm;
-                cov[i * n + j] = aa0;
-                cov[j * n + i] = aa0;
-                cov[i * n + j + 1] = aa1;
-                cov[(j + 1) * n + i] = aa1;
-            }
+        memset(cov, 0, sizeof(float) * n * n);
 
-            for (int j = n2i; j < n; j++) {
-                __m512 a0 = _mm512_setzero_ps();
+        // cov += P^T P / (n - 1), where the columns of P are the centred allowed rows of the specimens.
+        for (int r0 = 0; r0 < rows.count; r0 += chunk) {
+            const int mc = std::min(chunk, rows.count - r0);
 
-                for (int k = 0, ki = 0; k < m16; k += BlockSize, ki++) {
-                    int numOutOfRangeItems = std::max(0, k + BlockSize - m);
-                    __mmask16 allowMask = allowb[ki] & (FullBlockMask >> numOutOfRangeItems);
-                    __m512 meank = _mm512_loadu_ps(mean + k);
-                    __m512 coli = _mm512_sub_ps(_mm512_loadu_ps(datai + k), meank);
-                    __m512 colj0 = _mm512_sub_ps(_mm512_loadu_ps(data[j] + k), meank);
-                    a0 = _mm512_mask_fmadd_ps(coli, allowMask, colj0, a0);
-                }
+            #pragma omp parallel for schedule(dynamic, 4)
+            for (int i = 0; i < n; i++)
+                pca_rows_pack(rows, data[i], mean, r0, r0 + mc, panel + (size_t)i * mc);
 
-                float aa0 = reduce_add(a0) * norm;
-                cov[i * n + j] = aa0;
-                cov[j * n + i] = aa0;
-            }
+            cblas_ssyrk(CblasColMajor, CblasUpper, CblasTrans, n, mc, norm, panel, mc, 1.0f, cov, n);
         }
-	}
+
+        delete[] panel;
+
+        // ssyrk only updates the upper triangle.
+        for (int j = 0; j < n; j++) {
+            for (int i = j + 1; i < n; i++)
+                cov[i + j * n] = cov[j + i * n];
+        }
+    }
 
     void pca_cov_to_cor(float* mat, int dim)
     {
@@ -147,71 +182,249 @@ namespace warpcore::impl
         delete[] f;
     }
 
-    void pca_make_pcs(const float** data, const float* mean, float* cov, int n, int m, int npcs, float* var, float* pcs)
+    void pca_make_weights(float* cov, int n, int npcs, float* var, float* weights)
     {
-        float* evals = new float[n];
-        LAPACKE_ssyev(LAPACK_COL_MAJOR, 'V', 'U', n, cov, n, evals);
-        
-        // Find the order that sorts the eigenvalues in a descending order of magnitude.
-        int* order = new int[n];
-        for (int i = 0; i < n; i++)
-            order[i] = i;
-
-        // Absolute values for eigenvalues are ommitted as the matrix should be positive-semidefinite.
-        std::sort(order, order + n,
-            [evals](int a, int b) { return evals[a] > evals[b]; });
-
-        // Use the eigenvectors corresponding to 'npcs' eigenvalues with the largest magnitude
-        // and transform centered data with these weights to get the principal vectors.
-        //#pragma omp parallel for schedule(static, 4)
-        for (int i = 0; i < std::min(npcs, n); i++) {
-            wsumc(data, mean, cov + order[i] * n, n, m, pcs + i * m);
+        // Reduce cov to tridiagonal form once. The explained variance needs all eigenvalues, which the
+        // tridiagonal matrix gives in O(n^2), and only the npcs largest eigenpairs are solved for.
+        float* d = new float[n];
+        float* offd = new float[n];
+        float* tau = new float[n];
+        LAPACKE_ssytrd(LAPACK_COL_MAJOR, 'U', n, cov, n, d, offd, tau);
+
+        float* all_evals = nullptr;
+        if (var != nullptr && npcs < n) {
+            all_evals = new float[n];
+            float* e_copy = new float[n];
+            memcpy(all_evals, d, sizeof(float) * n);
+            memcpy(e_copy, offd, sizeof(float) * n);
+            LAPACKE_ssterf(n, all_evals, e_copy);
+            delete[] e_copy;
         }
 
-        normalize_columns(pcs, m, n);
+        // Only the eigenpairs with the npcs largest eigenvalues, in ascending order. sstemr is the
+        // solver ssyevr would use, its vectors are mapped back to those of cov by sormtr.
+        float* evals = new float[n];
+        float* evecs = new float[(size_t)n * npcs];
+        int* isuppz = new int[2 * npcs];
+        int nfound = 0;
+        lapack_logical tryrac = 1;
+        LAPACKE_sstemr(LAPACK_COL_MAJOR, 'V', 'I', n, d, offd, 0, 0, n - npcs + 1, n, &nfound, evals, evecs, n, npcs, isuppz, &tryrac);
+        LAPACKE_sormtr(LAPACK_COL_MAJOR, 'L', 'U', 'N', n, npcs, cov, n, tau, evecs, n);
+        delete[] isuppz;
+        delete[] tau;
+        delete[] offd;
+        delete[] d;
+
+        // Descending order of eigenvalues. Absolute values are ommitted as the matrix should be 
+        // positive-semidefinite.
+        for (int i = 0; i < npcs; i++)
+            memcpy(weights + (size_t)i * n, evecs + (size_t)(npcs - 1 - i) * n, sizeof(float) * n);
 
         // Calculate proportion of explained variance if desired.
         if (var != nullptr) {
+            const float* ev = all_evals ? all_evals : evals;
+            float sumev = 0;
             for (int i = 0; i < n; i++) {
-                evals[i] = sqrtf(evals[i]);
-
-                if (!isnormal(evals[i]))
-                    evals[i] = 0;
+                const float e = sqrtf(ev[i]);
+                if (isnormal(e))
+                    sumev += e;
             }
 
-            float sumev = reduce_add(evals, n);
-            for (int i = 0; i < std::min(npcs, n); i++)
-                var[i] = evals[order[i]] / sumev;
+            for (int i = 0; i < npcs; i++) {
+                const float e = sqrtf(evals[npcs - 1 - i]);
+                var[i] = isnormal(e) ? e / sumev : 0;
+            }
         }
 
-        delete[] order;
+        delete[] all_evals;
+        delete[] evecs;
         delete[] evals;
     }
 
-    float dot_centered_pred(const float* x, const float* y, const float* x0, const void* allow, int n)
+    void pca_make_pcs(const float** data, const float* mean, float* cov, int n, int m, int npcs, float* var, float* pcs)
     {
-        // TODO: avx512 after proving the following is correct
-        const int* allowq = (const int*)allow;
-        float ret = 0;
-        for (int i = 0; i < n; i++) {
-            if ((allowq[i >> 5] >> (i & 0x1f)) & 0x1) // HOT
-                ret += (x[i] - x0[i]) * y[i];
+        npcs = std::min(npcs, n);
+        if (npcs < 1)
+            return;
+
+        float* weights = new float[(size_t)n * npcs];
+        pca_make_weights(cov, n, npcs, var, weights);
+
+        // Transform the centered data with the eigenvectors to get the principal vectors, pcs = X * W, 
+        // where the columns of X are the centered specimens. X is packed in panels of rows.
+        const int chunk = (int)std::max<size_t>(1, std::min<size_t>(m, PcaPanelSize / n));
+        float* panel = new float[(size_t)chunk * n];
+
+        pca_rows rows;
+        pca_rows_make(nullptr, m, rows);
+
+        for (int r0 = 0; r0 < m; r0 += chunk) {
+            const int mc = std::min(chunk, m - r0);
+
+            #pragma omp parallel for schedule(dynamic, 4)
+            for (int i = 0; i < n; i++)
+                pca_rows_pack(rows, data[i], mean, r0, r0 + mc, panel + (size_t)i * mc);
+
+            cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, mc, npcs, n, 1.0f, panel, mc, weights, n, 0.0f, pcs + r0, m);
         }
 
+        delete[] panel;
+        delete[] weights;
+
+        normalize_columns(pcs, m, npcs);
+    }
+
+    bool pca_mean_stream(pca_read_rows read, void* user, int n, int m, int chunk, float* panel, float* mean)
+    {
+        for (int r0 = 0; r0 < m; r0 += chunk) {
+            const int mc = std::min(chunk, m - r0);
+            if (read(user, r0, r0 + mc, panel) != 0)
+                return false;
+
+            float* meanc = mean + r0;
+            memset(meanc, 0, sizeof(float) * mc);
+            for (int i = 0; i < n; i++) {
+                const float* pi = panel + (size_t)i * mc;
+                for (int j = 0; j < mc; j++)
+                    meanc[j] += pi[j];
+            }
+
+            const float f = 1.0f / (float)n;
+            for (int j = 0; j < mc; j++)
+                meanc[j] *= f;
+        }
+
+        return true;
+    }
+
+    bool pca_covmat_stream(pca_read_rows read, void* user, const float* mean, const void* allow, int n, int m, int chunk, float* panel, float* cov)
+    {
+        pca_rows rows;
+        pca_rows_make(allow, m, rows);
+
+        const float norm = 1.0f / (n - 1);
+        memset(cov, 0, sizeof(float) * n * n);
+
+        for (int r0 = 0; r0 < m; r0 += chunk) {
+            const int mc = std::min(chunk, m - r0);
+
+            // Skip the panels without allowed rows before reading them.
+            if (pca_rows_compact(rows, nullptr, r0, r0 + mc, 0, panel) == 0)
+                continue;
+
+            if (read(user, r0, r0 + mc, panel) != 0)
+                return false;
+
+            const int kept = pca_rows_compact(rows, mean, r0, r0 + mc, n, panel);
+            cblas_ssyrk(CblasColMajor, CblasUpper, CblasTrans, n, kept, norm, panel, kept, 1.0f, cov, n);
+        }
+
+        for (int j = 0; j < n; j++) {
+            for (int i = j + 1; i < n; i++)
+                cov[i + j * n] = cov[j + i * n];
+        }
+
+        return true;
+    }
+
+    bool pca_make_pcs_stream(pca_read_rows read, void* user, const float* mean, float* cov, int n, int m, int npcs, int chunk, float* panel, float* var, float* pcs)
+    {
+        npcs = std::min(npcs, n);
+        if (npcs < 1)
+            return true;
+
+        float* weights = new float[(size_t)n * npcs];
+        pca_make_weights(cov, n, npcs, var, weights);
+
+        pca_rows rows;
+        pca_rows_make(nullptr, m, rows);
+
+        bool ret = true;
+        for (int r0 = 0; r0 < m; r0 += chunk) {
+            const int mc = std::min(chunk, m - r0);
+            if (read(user, r0, r0 + mc, panel) != 0) {
+                ret = false;
+                break;
+            }
+
+            pca_rows_compact(rows, mean, r0, r0 + mc, n, panel);
+            cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, mc, npcs, n, 1.0f, panel, mc, weights, n, 0.0f, pcs + r0, m);
+        }
+
+        delete[] weights;
+
+        if (ret)
+            normalize_columns(pcs, m, npcs);
+
         return ret;
     }
 
-    void pca_make_scores(const float* x, const float* mean, const float* pcs, const void* allow, int n, int m, float* sc)
+    static void pca_center_masked_avx2(const float* x, const float* mean, const void* allow, int r0, int r1, float* p)
     {
-        // sc := pcs * (x - mean) with rows predicated on allow
-        for (int i = 0; i < n; i++)
-            sc[i] = dot_centered_pred(x, pcs + i * m, mean, allow, m);
+        int r = r0;
+        for (; r + 8 <= r1; r += 8) {
+            const uint32_t bits = allow_bits(allow, r, 8);
+            __m256 t = _mm256_sub_ps(_mm256_loadu_ps(x + r), _mm256_loadu_ps(mean + r));
+
+            if (bits != 0xff)
+                t = _mm256_and_ps(t, mask_from_bits(bits));
+
+            _mm256_storeu_ps(p + r - r0, t);
+        }
+
+        for (; r < r1; r++)
+            p[r - r0] = is_allowed(allow, r) ? x[r] - mean[r] : 0.0f;
+    }
+
+    static void pca_center_masked_avx512(const float* x, const float* mean, const void* allow, int r0, int r1, float* p)
+    {
+        int r = r0;
+        for (; r + 16 <= r1; r += 16) {
+            const __mmask16 bits = (__mmask16)allow_bits(allow, r, 16);
+            _mm512_storeu_ps(p + r - r0, _mm512_maskz_sub_ps(bits, _mm512_loadu_ps(x + r), _mm512_loadu_ps(mean + r)));
+        }
+
+        for (; r < r1; r++)
+            p[r - r0] = is_allowed(allow, r) ? x[r] - mean[r] : 0.0f;
+    }
+
+    void pca_center_masked(const float* x, const float* mean, const void* allow, int r0, int r1, float* p)
+    {
+        WCORE_ASSERT((r0 & 31) == 0);
+
+        if (has_feature(WCORE_OPTPATH::AVX512))
+            pca_center_masked_avx512(x, mean, allow, r0, r1, p);
+        else
+            pca_center_masked_avx2(x, mean, allow, r0, r1, p);
+    }
+
+    void pca_make_scores(const float** x, const float* mean, const float* pcs, const void* allow, int count, int npcs, int m, float* sc)
+    {
+        // sc := pcs^T * (x - mean) with rows predicated on allow, the centred specimens are packed in panels
+        // of rows with the disallowed rows zeroed. Panels start on whole words of allow.
+        const int chunk = (int)std::min<size_t>(round_up(m, 32), std::max<size_t>(32, (PcaPanelSize / count) & ~(size_t)31));
+        float* panel = new float[(size_t)chunk * count];
+
+        for (int r0 = 0; r0 < m; r0 += chunk) {
+            const int mc = std::min(chunk, m - r0);
+
+            #pragma omp parallel for schedule(dynamic, 4)
+            for (int i = 0; i < count; i++)
+                pca_center_masked(x[i], mean, allow, r0, r0 + mc, panel + (size_t)i * mc);
+
+            cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, npcs, count, mc, 1.0f, pcs + r0, m, panel, mc, 
+                (r0 == 0) ? 0.0f : 1.0f, sc, npcs);
+        }
+
+        delete[] panel;
     }
 
-    void pca_predict(const float* scores, const float* mean, const float* pcs, int n, int m, float* x)
+    void pca_predict(const float* scores, const float* mean, const float* pcs, int count, int npcs, int m, float* x)
     {
-        // x := scores * pcs + mean
-        memcpy(x, mean, sizeof(float) * m);
-        cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, m, 1, n, 1.0f, pcs, m, scores, n, 1.0f, x, m);
+        // x := pcs * scores + mean, for count specimens at once
+        for (int i = 0; i < count; i++)
+            memcpy(x + (size_t)i * m, mean, sizeof(float) * m);
+
+        cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, m, count, npcs, 1.0f, pcs, m, scores, npcs, 1.0f, x, m);
     }
 };
\ No newline at end of file
@@ -1,11 +1,46 @@
 #include "../config.h"
+#include "../pca.h"
+#include <vector>
 
 namespace warpcore::impl
 {
+	// Runs of consecutive rows allowed by a bitfield (all rows if it is null). offs holds the index of
+	// the first row of each run among the allowed rows.
+	struct pca_rows {
+		int count;
+		std::vector<int> start;
+		std::vector<int> offs;
+		std::vector<int> len;
+	};
+
+	void pca_rows_make(const void* allow, int m, pca_rows& rows);
+
+	// Copies the allowed rows r0..r1-1 (counted among the allowed rows) of x to p, subtracting mean if 
+	// it is not null.
+	void pca_rows_pack(const pca_rows& rows, const float* x, const float* mean, int r0, int r1, float* p);
+
+	// Compacts a panel of raw rows r0..r1-1 of n specimens (one column of r1 - r0 rows per specimen) in place 
+	// to the allowed rows, subtracting mean if it is not null. Returns the number of rows kept, which is the 
+	// new column length.
+	int pca_rows_compact(const pca_rows& rows, const float* mean, int r0, int r1, int n, float* p);
+
 	void pca_mean(const float** data, int n, int m, float* mean);
 	void pca_covmat(const float** data, const float* mean, const void* allow, int n, int m, float* cov);
 	void pca_cov_to_cor(float* mat, int dim);
+	// Descending eigenvectors for the npcs largest eigenvalues of cov to weights (n x npcs), cov is destroyed.
+	void pca_make_weights(float* cov, int n, int npcs, float* var, float* weights);
 	void pca_make_pcs(const float** data, const float* mean, float* cov, int n, int m, int npcs, float* var, float* pcs);
-	void pca_make_scores(const float* x, const float* mean, const float* pcs, const void* allow, int n, int m, float* sc);
-	void pca_predict(const float* scores, const float* mean, const float* pcs, int n, int m, float* x);
+
+	// As above, with the specimens read by read in panels of at most chunk rows into panel (chunk * n floats).
+	// These return false if read fails.
+	bool pca_mean_stream(pca_read_rows read, void* user, int n, int m, int chunk, float* panel, float* mean);
+	bool pca_covmat_stream(pca_read_rows read, void* user, const float* mean, const void* allow, int n, int m, int chunk, float* panel, float* cov);
+	bool pca_make_pcs_stream(pca_read_rows read, void* user, const float* mean, float* cov, int n, int m, int npcs, int chunk, float* panel, float* var, float* pcs);
+	// p := x - mean on rows r0..r1-1, zero where they are not allowed. r0 must be a multiple of 32.
+	void pca_center_masked(const float* x, const float* mean, const void* allow, int r0, int r1, float* p);
+
+	// Scores (npcs per specimen) of count specimens, and count specimens (m floats each, one after another) 
+	// from their scores.
+	void pca_make_scores(const float** x, const float* mean, const float* pcs, const void* allow, int count, int npcs, int m, float* sc);
+	void pca_predict(const float* scores, const float* mean, const float* pcs, int count, int npcs, int m, float* x);
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "pcl_utils.h"
 #include "vec_math.h"
 #include "utils.h"
+#include "cpu_info.h"
 #include <immintrin.h>
 #include <algorithm>
 #include <cmath>
@@ -12,10 +13,332 @@ using namespace std;
 
 namespace warpcore::impl
 {
+    // The kernels below handle 3D points only, 8 (AVX2) or 16 (AVX-512) of them at a time. The AoS
+    // input is demuxed into SoA registers. Masked kernels take the allow bits of a whole block at 
+    // once and skip the blocks with no allowed points.
+    static int pcl_center3_avx2(const float* x, const void* allow, int m, float* c)
+    {
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps();
+        int n = 0;
+
+        const int m8 = round_down(m, 8);
+        for (int i = 0; i < m8; i += 8) {
+            const uint32_t bits = allow_bits(allow, i, 8);
+            if (!bits)
+                continue;
+
+            __m256 a = _mm256_loadu_ps(x + 3 * i);
+            __m256 b = _mm256_loadu_ps(x + 3 * i + 8);
+            __m256 cc = _mm256_loadu_ps(x + 3 * i + 16);
+            demux(a, b, cc);
+
+            if (bits != 0xff) {
+                const __m256 mask = mask_from_bits(bits);
+                a = _mm256_and_ps(a, mask);
+                b = _mm256_and_ps(b, mask);
+                cc = _mm256_and_ps(cc, mask);
+            }
+
+            s0 = _mm256_add_ps(s0, a);
+            s1 = _mm256_add_ps(s1, b);
+            s2 = _mm256_add_ps(s2, cc);
+            n += _mm_popcnt_u32(bits);
+        }
+
+        float sum[3] = { reduce_add(s0), reduce_add(s1), reduce_add(s2) };
+        for (int i = m8; i < m; i++) {
+            if (!is_allowed(allow, i))
+                continue;
+
+            sum[0] += x[3 * i];
+            sum[1] += x[3 * i + 1];
+            sum[2] += x[3 * i + 2];
+            n++;
+        }
+
+        for (int j = 0; j < 3; j++)
+            c[j] = sum[j] / n;
+
+        return n;
+    }
+
+    static int pcl_center3_avx512(const float* x, const void* allow, int m, float* c)
+    {
+        __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps(), s2 = _mm512_setzero_ps();
+        int n = 0;
+
+        const int m16 = round_down(m, 16);
+        for (int i = 0; i < m16; i += 16) {
+            const __mmask16 bits = (__mmask16)allow_bits(allow, i, 16);
+            if (!bits)
+                continue;
+
+            __m512 a = _mm512_loadu_ps(x + 3 * i);
+            __m512 b = _mm512_loadu_ps(x + 3 * i + 16);
+            __m512 cc = _mm512_loadu_ps(x + 3 * i + 32);
+            demux(a, b, cc);
+
+            s0 = _mm512_mask_add_ps(s0, bits, s0, a);
+            s1 = _mm512_mask_add_ps(s1, bits, s1, b);
+            s2 = _mm512_mask_add_ps(s2, bits, s2, cc);
+            n += _mm_popcnt_u32(bits);
+        }
+
+        float sum[3] = { reduce_add(s0), reduce_add(s1), reduce_add(s2) };
+        for (int i = m16; i < m; i++) {
+            if (!is_allowed(allow, i))
+                continue;
+
+            sum[0] += x[3 * i];
+            sum[1] += x[3 * i + 1];
+            sum[2] += x[3 * i + 2];
+            n++;
+        }
+
+        for (int j = 0; j < 3; j++)
+            c[j] = sum[j] / n;
+
+        return n;
+    }
+
+    static float pcl_cs3_avx2(const float* x, const void* allow, int m, const float* offs)
+    {
+        const __m256 o0 = _mm256_set1_ps(offs[0]), o1 = _mm256_set1_ps(offs[1]), o2 = _mm256_set1_ps(offs[2]);
+        __m256 ssq = _mm256_setzero_ps();
+        int n = 0;
+
+        const int m8 = round_down(m, 8);
+        for (int i = 0; i < m8; i += 8) {
+            const uint32_t bits = allow_bits(allow, i, 8);
+            if (!bits)
+                continue;
+
+            __m256 a = _mm256_loadu_ps(x + 3 * i);
+            __m256 b = _mm256_loadu_ps(x + 3 * i + 8);
+            __m256 c = _mm256_loadu_ps(x + 3 * i + 16);
+            demux(a, b, c);
+
+            a = _mm256_sub_ps(a, o0);
+            b = _mm256_sub_ps(b, o1);
+            c = _mm256_sub_ps(c, o2);
+            __m256 d2 = _mm256_fmadd_ps(a, a, _mm256_fmadd_ps(b, b, _mm256_mul_ps(c, c)));
+
+            if (bits != 0xff)
+                d2 = _mm256_and_ps(d2, mask_from_bits(bits));
+
+            ssq = _mm256_add_ps(ssq, d2);
+            n += _mm_popcnt_u32(bits);
+        }
+
+        float ret = reduce_add(ssq);
+        for (int i = m8; i < m; i++) {
+            if (!is_allowed(allow, i))
+                continue;
+
+            for (int j = 0; j < 3; j++)
+                ret += (x[3 * i + j] - offs[j]) * (x[3 * i + j] - offs[j]);
+            n++;
+        }
+
+        return sqrtf(ret / n);
+    }
+
+    static float pcl_cs3_avx512(const float* x, const void* allow, int m, const float* offs)
+    {
+        const __m512 o0 = _mm512_set1_ps(offs[0]), o1 = _mm512_set1_ps(offs[1]), o2 = _mm512_set1_ps(offs[2]);
+        __m512 ssq = _mm512_setzero_ps();
+        int n = 0;
+
+        const int m16 = round_down(m, 16);
+        for (int i = 0; i < m16; i += 16) {
+            const __mmask16 bits = (__mmask16)allow_bits(allow, i, 16);
+            if (!bits)
+                continue;
+
+            __m512 a = _mm512_loadu_ps(x + 3 * i);
+            __m512 b = _mm512_loadu_ps(x + 3 * i + 16);
+            __m512 c = _mm512_loadu_ps(x + 3 * i + 32);
+            demux(a, b, c);
+
+            a = _mm512_sub_ps(a, o0);
+            b = _mm512_sub_ps(b, o1);
+            c = _mm512_sub_ps(c, o2);
+            const __m512 d2 = _mm512_fmadd_ps(a, a, _mm512_fmadd_ps(b, b, _mm512_mul_ps(c, c)));
+
+            ssq = _mm512_mask_add_ps(ssq, bits, ssq, d2);
+            n += _mm_popcnt_u32(bits);
+        }
+
+        float ret = reduce_add(ssq);
+        for (int i = m16; i < m; i++) {
+            if (!is_allowed(allow, i))
+                continue;
+
+            for (int j = 0; j < 3; j++)
+                ret += (x[3 * i + j] - offs[j]) * (x[3 * i + j] - offs[j]);
+            n++;
+        }
+
+        return sqrtf(ret / n);
+    }
+
+    static void pcl_transform3_avx2(const float* x, int m, bool add, float sc, const float* offs, float* y)
+    {
+        // No need to demux, the offset repeats every three lanes.
+        alignas(32) float op[24];
+        for (int j = 0; j < 24; j++)
+            op[j] = offs[j % 3];
+
+        const __m256 o0 = _mm256_load_ps(op), o1 = _mm256_load_ps(op + 8), o2 = _mm256_load_ps(op + 16);
+        const __m256 scale = _mm256_set1_ps(sc);
+
+        const int m8 = round_down(m, 8);
+        for (int i = 0; i < m8; i += 8) {
+            const float* xi = x + 3 * i;
+            float* yi = y + 3 * i;
+            const __m256 y0 = add ? _mm256_loadu_ps(yi) : _mm256_setzero_ps();
+            const __m256 y1 = add ? _mm256_loadu_ps(yi + 8) : _mm256_setzero_ps();
+            const __m256 y2 = add ? _mm256_loadu_ps(yi + 16) : _mm256_setzero_ps();
+            _mm256_storeu_ps(yi, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(xi), o0), scale, y0));
+            _mm256_storeu_ps(yi + 8, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(xi + 8), o1), scale, y1));
+            _mm256_storeu_ps(yi + 16, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(xi + 16), o2), scale, y2));
+        }
+
+        for (int i = 3 * m8; i < 3 * m; i++)
+            y[i] = (add ? y[i] : 0) + (x[i] - offs[i % 3]) * sc;
+    }
+
+    static void pcl_transform3_avx512(const float* x, int m, bool add, float sc, const float* offs, float* y)
+    {
+        alignas(64) float op[48];
+        for (int j = 0; j < 48; j++)
+            op[j] = offs[j % 3];
+
+        const __m512 o0 = _mm512_load_ps(op), o1 = _mm512_load_ps(op + 16), o2 = _mm512_load_ps(op + 32);
+        const __m512 scale = _mm512_set1_ps(sc);
+
+        const int m16 = round_down(m, 16);
+        for (int i = 0; i < m16; i += 16) {
+            const float* xi = x + 3 * i;
+            float* yi = y + 3 * i;
+            const __m512 y0 = add ? _mm512_loadu_ps(yi) : _mm512_setzero_ps();
+            const __m512 y1 = add ? _mm512_loadu_ps(yi + 16) : _mm512_setzero_ps();
+            const __m512 y2 = add ? _mm512_loadu_ps(yi + 32) : _mm512_setzero_ps();
+            _mm512_storeu_ps(yi, _mm512_fmadd_ps(_mm512_sub_ps(_mm512_loadu_ps(xi), o0), scale, y0));
+            _mm512_storeu_ps(yi + 16, _mm512_fmadd_ps(_mm512_sub_ps(_mm512_loadu_ps(xi + 16), o1), scale, y1));
+            _mm512_storeu_ps(yi + 32, _mm512_fmadd_ps(_mm512_sub_ps(_mm512_loadu_ps(xi + 32), o2), scale, y2));
+        }
+
+        for (int i = 3 * m16; i < 3 * m; i++)
+            y[i] = (add ? y[i] : 0) + (x[i] - offs[i % 3]) * sc;
+    }
+
+    static void pcl_transform3_avx2(const float* x, int m, bool add, float sc, const float* offs, const float* rot, float* y)
+    {
+        const __m256 o0 = _mm256_set1_ps(offs[0]), o1 = _mm256_set1_ps(offs[1]), o2 = _mm256_set1_ps(offs[2]);
+        const __m256 scale = _mm256_set1_ps(sc);
+        __m256 r[9];
+        for (int j = 0; j < 9; j++)
+            r[j] = _mm256_set1_ps(rot[j]);
+
+        const int m8 = round_down(m, 8);
+        for (int i = 0; i < m8; i += 8) {
+            float* yi = y + 3 * i;
+            __m256 a = _mm256_loadu_ps(x + 3 * i);
+            __m256 b = _mm256_loadu_ps(x + 3 * i + 8);
+            __m256 c = _mm256_loadu_ps(x + 3 * i + 16);
+            demux(a, b, c);
+
+            a = _mm256_sub_ps(a, o0);
+            b = _mm256_sub_ps(b, o1);
+            c = _mm256_sub_ps(c, o2);
+
+            __m256 y0 = _mm256_setzero_ps(), y1 = _mm256_setzero_ps(), y2 = _mm256_setzero_ps();
+            if (add) {
+                y0 = _mm256_loadu_ps(yi);
+                y1 = _mm256_loadu_ps(yi + 8);
+                y2 = _mm256_loadu_ps(yi + 16);
+                demux(y0, y1, y2);
+            }
+
+            y0 = _mm256_fmadd_ps(scale, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[0], a), _mm256_mul_ps(r[3], b)), _mm256_mul_ps(r[6], c)), y0);
+            y1 = _mm256_fmadd_ps(scale, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[1], a), _mm256_mul_ps(r[4], b)), _mm256_mul_ps(r[7], c)), y1);
+            y2 = _mm256_fmadd_ps(scale, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[2], a), _mm256_mul_ps(r[5], b)), _mm256_mul_ps(r[8], c)), y2);
+
+            mux(y0, y1, y2);
+            _mm256_storeu_ps(yi, y0);
+            _mm256_storeu_ps(yi + 8, y1);
+            _mm256_storeu_ps(yi + 16, y2);
+        }
+
+        for (int i = m8; i < m; i++) {
+            const float xt[3] = { x[3 * i] - offs[0], x[3 * i + 1] - offs[1], x[3 * i + 2] - offs[2] };
+            for (int j = 0; j < 3; j++) {
+                const float t = rot[j] * xt[0] + rot[3 + j] * xt[1] + rot[6 + j] * xt[2];
+                y[3 * i + j] = fmaf(sc, t, add ? y[3 * i + j] : 0.0f);
+            }
+        }
+    }
+
+    static void pcl_transform3_avx512(const float* x, int m, bool add, float sc, const float* offs, const float* rot, float* y)
+    {
+        const __m512 o0 = _mm512_set1_ps(offs[0]), o1 = _mm512_set1_ps(offs[1]), o2 = _mm512_set1_ps(offs[2]);
+        const __m512 scale = _mm512_set1_ps(sc);
+        __m512 r[9];
+        for (int j = 0; j < 9; j++)
+            r[j] = _mm512_set1_ps(rot[j]);
+
+        const int m16 = round_down(m, 16);
+        for (int i = 0; i < m16; i += 16) {
+            float* yi = y + 3 * i;
+            __m512 a = _mm512_loadu_ps(x + 3 * i);
+            __m512 b = _mm512_loadu_ps(x + 3 * i + 16);
+            __m512 c = _mm512_loadu_ps(x + 3 * i + 32);
+            demux(a, b, c);
+
+            a = _mm512_sub_ps(a, o0);
+            b = _mm512_sub_ps(b, o1);
+            c = _mm512_sub_ps(c, o2);
+
+            __m512 y0 = _mm512_setzero_ps(), y1 = _mm512_setzero_ps(), y2 = _mm512_setzero_ps();
+            if (add) {
+                y0 = _mm512_loadu_ps(yi);
+                y1 = _mm512_loadu_ps(yi + 16);
+                y2 = _mm512_loadu_ps(yi + 32);
+                demux(y0, y1, y2);
+            }
+
+            y0 = _mm512_fmadd_ps(scale, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(r[0], a), _mm512_mul_ps(r[3], b)), _mm512_mul_ps(r[6], c)), y0);
+            y1 = _mm512_fmadd_ps(scale, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(r[1], a), _mm512_mul_ps(r[4], b)), _mm512_mul_ps(r[7], c)), y1);
+            y2 = _mm512_fmadd_ps(scale, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(r[2], a), _mm512_mul_ps(r[5], b)), _mm512_mul_ps(r[8], c)), y2);
+
+            mux(y0, y1, y2);
+            _mm512_storeu_ps(yi, y0);
+            _mm512_storeu_ps(yi + 16, y1);
+            _mm512_storeu_ps(yi + 32, y2);
+        }
+
+        for (int i = m16; i < m; i++) {
+            const float xt[3] = { x[3 * i] - offs[0], x[3 * i + 1] - offs[1], x[3 * i + 2] - offs[2] };
+            for (int j = 0; j < 3; j++) {
+                const float t = rot[j] * xt[0] + rot[3 + j] * xt[1] + rot[6 + j] * xt[2];
+                y[3 * i + j] = fmaf(sc, t, add ? y[3 * i + j] : 0.0f);
+            }
+        }
+    }
+
     void pcl_center(const float* x, int d, int m, float* c)
     {
         WCORE_ASSERT(d <= 4);
 
+        if (d == 3) {
+            if (has_feature(WCORE_OPTPATH::AVX512))
+                pcl_center3_avx512(x, nullptr, m, c);
+            else
+                pcl_center3_avx2(x, nullptr, m, c);
+            return;
+        }
+
         __m128 sum = _mm_setzero_ps();
         for (int i = 0; i < m; i++) {
             sum = _mm_add_ps(sum, _mm_loadu_ps(x + d * i));
@@ -33,6 +356,14 @@ namespace warpcore::impl
     {
         WCORE_ASSERT(d <= 4);
 
+        if (d == 3) {
+            if (has_feature(WCORE_OPTPATH::AVX512))
+                pcl_center3_avx512(x, allow, m, c);
+            else
+                pcl_center3_avx2(x, allow, m, c);
+            return;
+        }
+
         __m128 sum = _mm_setzero_ps();
         int nallow = 0;
         FOR_MASKED(i, m, allow, nallow, false, {
@@ -51,6 +382,13 @@ namespace warpcore::impl
     {
         WCORE_ASSERT(d <= 4);
 
+        if (d == 3) {
+            if (has_feature(WCORE_OPTPATH::AVX512))
+                return pcl_cs3_avx512(x, nullptr, m, offs);
+            else
+                return pcl_cs3_avx2(x, nullptr, m, offs);
+        }
+
         __m128 center = _mm_loadu_ps(offs);
         __m128 ssq = _mm_setzero_ps();
 
@@ -73,6 +411,13 @@ namespace warpcore::impl
     {
         WCORE_ASSERT(d <= 4);
 
+        if (d == 3) {
+            if (has_feature(WCORE_OPTPATH::AVX512))
+                return pcl_cs3_avx512(x, allow, m, offs);
+            else
+                return pcl_cs3_avx2(x, allow, m, offs);
+        }
+
         __m128 center = _mm_loadu_ps(offs);
         __m128 ssq = _mm_setzero_ps();
         int num_allowed = 0;
@@ -96,52 +441,22 @@ namespace warpcore::impl
     {
         WCORE_ASSERT(d == 3);
 
-        __m128 center = _mm_loadu_ps(offs);
-        __m128 scale = _mm_set1_ps(sc);
-
-        // TODO: unwrap by 4, loading 3 xmms in one pass
-        for (int i = 0; i < m; i++) {
-            float* yi = y + 3 * i;
-            __m128 yy = add ? _mm_loadu_ps(yi) : _mm_setzero_ps();
-
-            yy = _mm_fmadd_ps(_mm_sub_ps(_mm_loadu_ps(x + 3 * i), center), scale, yy);
-
-            _mm_storel_pi((__m64*)yi, yy);
-            ((int*)yi)[2] = _mm_extract_ps(yy, 2);
-        }
+        if (has_feature(WCORE_OPTPATH::AVX512))
+            pcl_transform3_avx512(x, m, add, sc, offs, y);
+        else
+            pcl_transform3_avx2(x, m, add, sc, offs, y);
     }
 
     void pcl_transform(const float* x, int d, int m, bool add, float sc, const float* offs, const float* rot, float* y)
     {
         WCORE_ASSERT(d == 3);
 
-        __m128 center = _mm_loadu_ps(offs);
-        __m128 scale = _mm_set1_ps(sc);
-
-        __m128 rot0 = _mm_loadu_ps(rot);
-        __m128 rot1 = _mm_loadu_ps(rot + 3);
-        __m128 rot2 = _mm_loadu_ps(rot + 6);
-
-        // TODO: unwrap by 4, loading 3 xmms in one pass
-        for (int i = 0; i < m; i++) {
-            float* yi = y + 3 * i;
-
-            __m128 yy = add ? _mm_loadu_ps(yi) : _mm_setzero_ps();
-            __m128 xt = _mm_sub_ps(_mm_loadu_ps(x + 3 * i), center);
-
-            __m128 xtr0 = _mm_mul_ps(rot0, _mm_shuffle_ps(xt, xt, 0b00000000));
-            __m128 xtr1 = _mm_mul_ps(rot1, _mm_shuffle_ps(xt, xt, 0b01010101));
-            __m128 xtr2 = _mm_mul_ps(rot2, _mm_shuffle_ps(xt, xt, 0b10101010));
-            __m128 xtr = _mm_add_ps(_mm_add_ps(xtr0, xtr1), xtr2);
-
-            yy = _mm_fmadd_ps(scale, xtr, yy);
-
-            _mm_storel_pi((__m64*)yi, yy);
-            ((int*)yi)[2] = _mm_extract_ps(yy, 2);
-        }
+        if (has_feature(WCORE_OPTPATH::AVX512))
+            pcl_transform3_avx512(x, m, add, sc, offs, rot, y);
+        else
+            pcl_transform3_avx2(x, m, add, sc, offs, rot, y);
     }
 
-
     float pcl_rmse(const float* x, const float* y, int d, int m)
     {
         float rms = 0;
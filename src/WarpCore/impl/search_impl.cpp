@@ -5,12 +5,87 @@
 
 namespace warpcore::impl
 {
+    // Loads the 9 coordinate registers of 8 consecutive triangles starting at the i-th from AoSoA blocks of 
+    // vsize floats, see _raytri.
+    struct aosoa_block_f32
+    {
+        static constexpr float BaryEps = 0;
+
+        aosoa_block_f32(const float* vert, int i, int vsize) noexcept :
+            base(vert + 9 * (i - (i & (vsize - 1))) + (i & (vsize - 1))), stride(vsize)
+        {
+        }
+
+        const float* base;
+        int stride;
+
+        inline __m256 WCORE_VECCALL load(int k) const noexcept
+        {
+            return _mm256_loadu_ps(base + k * stride);
+        }
+
+        static inline void extract(const float* vert, int idx, p3f& a, p3f& b, p3f& c) noexcept
+        {
+            extract_aosoa_triangle<8>(vert, idx, a, b, c);
+        }
+    };
+
+    // Same for 16-bit quantized blocks of 8 triangles, see AOSOA_Q16_BLOCK. The coordinates are
+    // dequantized right after the load. Quantization moves the vertices by up to half a step, so
+    // ray hits are accepted slightly outside the triangles to keep the neighbours watertight.
+    struct aosoa_block_q16
+    {
+        static constexpr float BaryEps = 1.0f / 4096.0f;
+
+        aosoa_block_q16(const float* vert, int i, int) noexcept
+        {
+            const float* blk = vert + AOSOA_Q16_BLOCK * (i / 8);
+            q = (const uint16_t*)(blk + 8);
+            for (int j = 0; j < 3; j++) {
+                x0[j] = _mm256_broadcast_ss(blk + j);
+                sx[j] = _mm256_broadcast_ss(blk + 4 + j);
+            }
+        }
+
+        const uint16_t* q;
+        __m256 x0[3], sx[3];
+
+        inline __m256 WCORE_VECCALL load(int k) const noexcept
+        {
+            const __m256i qi = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(q + 8 * k)));
+            return _mm256_fmadd_ps(_mm256_cvtepi32_ps(qi), sx[k % 3], x0[k % 3]);
+        }
+
+        static inline void extract(const float* vert, int idx, p3f& a, p3f& b, p3f& c) noexcept
+        {
+            const float* blk = vert + AOSOA_Q16_BLOCK * (idx / 8);
+            const uint16_t* qb = (const uint16_t*)(blk + 8) + (idx & 7);
+            float v[12];
+            for (int j = 0; j < 9; j++)
+                v[j + j / 3] = blk[j % 3] + blk[4 + j % 3] * qb[8 * j];
+
+            a = p3f_set(v[0], v[1], v[2]);
+            b = p3f_set(v[4], v[5], v[6]);
+            c = p3f_set(v[8], v[9], v[10]);
+        }
+    };
+
+    template<typename TBlock>
+    static inline __m256 WCORE_VECCALL mask_bary_positive(__m256 x) noexcept
+    {
+        if constexpr (TBlock::BaryEps == 0)
+            return mask_positive(x);
+        else
+            return _mm256_cmp_ps(x, _mm256_set1_ps(-TBlock::BaryEps), _CMP_GE_OQ);
+    }
+
     // Vert is assumed to be in an AoSoA order {x0,y0,z0,x1,y1,z1,x2,y2,z2}, where each element contains
     // one register worth of coordinates. A register is currently 8 floats. The last such block may be
     // partially filled, where each of the x0..z2 elements only has valid data in its lower k lanes. The
     // content of the other lanes does not matter. It is advisable though to fill that with valid data
     // (e.g. repeated lower lanes) so that the arithmetic does not generate expensive NaNs.
-    __declspec(noalias) void _raytri(p3f orig, p3f dir, const float* vert, int n, __m256& bestu, __m256& bestv, __m256& bestt, __m256i& besti) noexcept
+    template<typename TBlock>
+    __declspec(noalias) static void _raytri_impl(p3f orig, p3f dir, const float* vert, int n, __m256& bestu, __m256& bestv, __m256& bestt, __m256i& besti) noexcept
     {
         constexpr int VectorSize = 8;
 
@@ -24,20 +99,19 @@ namespace warpcore::impl
         for(int i = 0; i < n; i += VectorSize) {
             __m256 mask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), rng));
 
-            //const float* vert_base = vert + 9 * (i & (~(VectorSize - 1)));
-            const float* vert_base = vert + 9 * i;
+            const TBlock blk(vert, i, VectorSize);
 
-            const __m256 ax = _mm256_loadu_ps(vert_base);
-            const __m256 ay = _mm256_loadu_ps(vert_base + 1 * VectorSize);
-            const __m256 az = _mm256_loadu_ps(vert_base + 2 * VectorSize);
+            const __m256 ax = blk.load(0);
+            const __m256 ay = blk.load(1);
+            const __m256 az = blk.load(2);
 
-            const __m256 e1x = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 3 * VectorSize), ax);
-            const __m256 e1y = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 4 * VectorSize), ay);
-            const __m256 e1z = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 5 * VectorSize), az);
+            const __m256 e1x = _mm256_sub_ps(blk.load(3), ax);
+            const __m256 e1y = _mm256_sub_ps(blk.load(4), ay);
+            const __m256 e1z = _mm256_sub_ps(blk.load(5), az);
 
-            const __m256 e2x = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 6 * VectorSize), ax);
-            const __m256 e2y = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 7 * VectorSize), ay);
-            const __m256 e2z = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 8 * VectorSize), az);
+            const __m256 e2x = _mm256_sub_ps(blk.load(6), ax);
+            const __m256 e2y = _mm256_sub_ps(blk.load(7), ay);
+            const __m256 e2z = _mm256_sub_ps(blk.load(8), az);
 
             __m256 px = _mm256_undefined_ps(), py = _mm256_undefined_ps(), pz = _mm256_undefined_ps();
             cross(_mm256_permute_ps(d, 0b00000000), _mm256_permute_ps(d, 0b01010101), _mm256_permute_ps(d, 0b10101010),
@@ -56,8 +130,8 @@ namespace warpcore::impl
 
             __m256 u = _mm256_mul_ps(dot(sx, sy, sz, px, py, pz), inv_det);
 
-            mask = _mm256_and_ps(mask, mask_positive(u));
-            mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, _mm256_set1_ps(1), _CMP_LE_OQ));
+            mask = _mm256_and_ps(mask, mask_bary_positive<TBlock>(u));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, _mm256_set1_ps(1 + TBlock::BaryEps), _CMP_LE_OQ));
 
             __m256 qx = _mm256_undefined_ps(), qy = _mm256_undefined_ps(), qz = _mm256_undefined_ps();
             cross(sx, sy, sz, e1x, e1y, e1z, qx, qy, qz);
@@ -65,8 +139,8 @@ namespace warpcore::impl
             __m256 v = dot(_mm256_permute_ps(d, 0b00000000), _mm256_permute_ps(d, 0b01010101), _mm256_permute_ps(d, 0b10101010), qx, qy, qz);
             v = _mm256_mul_ps(v, inv_det);
 
-            mask = _mm256_and_ps(mask, mask_positive(v));
-            mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), _mm256_set1_ps(1), _CMP_LE_OQ));
+            mask = _mm256_and_ps(mask, mask_bary_positive<TBlock>(v));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), _mm256_set1_ps(1 + TBlock::BaryEps), _CMP_LE_OQ));
 
             if (_mm256_testz_ps(mask, mask))
                 continue;
@@ -86,8 +160,114 @@ namespace warpcore::impl
         }
     }
 
+    __declspec(noalias) void _raytri(p3f orig, p3f dir, const float* vert, int n, __m256& bestu, __m256& bestv, __m256& bestt, __m256i& besti) noexcept
+    {
+        _raytri_impl<aosoa_block_f32>(orig, dir, vert, n, bestu, bestv, bestt, besti);
+    }
+
+    __declspec(noalias) void _raytri_q16(p3f orig, p3f dir, const float* vert, int n, __m256& bestu, __m256& bestv, __m256& bestt, __m256i& besti) noexcept
+    {
+        _raytri_impl<aosoa_block_q16>(orig, dir, vert, n, bestu, bestv, bestt, besti);
+    }
+
+    // Same as _raytri, but reports every hit instead of the closest one. The AoSoA blocks hold vsize
+    // (8 or 16) triangles, both are processed 8 lanes at a time.
+    template<typename TBlock>
+    __declspec(noalias) static int _raytri_all_impl(p3f orig, p3f dir, const float* vert, int n, int vsize, int* idx, float* tuv) noexcept
+    {
+        constexpr int VectorSize = 8;
+        constexpr float EPS = 1e-30f;
+        const __m256i rng = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+        __m256 o = _mm256_set_m128(orig, orig);
+        __m256 d = _mm256_set_m128(dir, dir);
+        int nhit = 0;
+
+        for (int i = 0; i < n; i += VectorSize) {
+            __m256 mask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), rng));
+            const TBlock blk(vert, i, vsize);
+
+            const __m256 ax = blk.load(0);
+            const __m256 ay = blk.load(1);
+            const __m256 az = blk.load(2);
+
+            const __m256 e1x = _mm256_sub_ps(blk.load(3), ax);
+            const __m256 e1y = _mm256_sub_ps(blk.load(4), ay);
+            const __m256 e1z = _mm256_sub_ps(blk.load(5), az);
+
+            const __m256 e2x = _mm256_sub_ps(blk.load(6), ax);
+            const __m256 e2y = _mm256_sub_ps(blk.load(7), ay);
+            const __m256 e2z = _mm256_sub_ps(blk.load(8), az);
+
+            __m256 px = _mm256_undefined_ps(), py = _mm256_undefined_ps(), pz = _mm256_undefined_ps();
+            cross(_mm256_permute_ps(d, 0b00000000), _mm256_permute_ps(d, 0b01010101), _mm256_permute_ps(d, 0b10101010),
+                e2x, e2y, e2z, px, py, pz);
+
+            __m256 det = dot(e1x, e1y, e1z, px, py, pz);
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_abs_ps(det), _mm256_set1_ps(EPS), _CMP_GT_OQ));
+            if (_mm256_testz_ps(mask, mask))
+                continue;
+
+            // Exact division, rcp_ps is too coarse to tell apart hits that are close along the ray.
+            __m256 inv_det = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+            __m256 sx = _mm256_sub_ps(_mm256_permute_ps(o, 0b00000000), ax);
+            __m256 sy = _mm256_sub_ps(_mm256_permute_ps(o, 0b01010101), ay);
+            __m256 sz = _mm256_sub_ps(_mm256_permute_ps(o, 0b10101010), az);
+
+            __m256 u = _mm256_mul_ps(dot(sx, sy, sz, px, py, pz), inv_det);
+            mask = _mm256_and_ps(mask, mask_bary_positive<TBlock>(u));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, _mm256_set1_ps(1 + TBlock::BaryEps), _CMP_LE_OQ));
+
+            __m256 qx = _mm256_undefined_ps(), qy = _mm256_undefined_ps(), qz = _mm256_undefined_ps();
+            cross(sx, sy, sz, e1x, e1y, e1z, qx, qy, qz);
+
+            __m256 v = dot(_mm256_permute_ps(d, 0b00000000), _mm256_permute_ps(d, 0b01010101), _mm256_permute_ps(d, 0b10101010), qx, qy, qz);
+            v = _mm256_mul_ps(v, inv_det);
+            mask = _mm256_and_ps(mask, mask_bary_positive<TBlock>(v));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), _mm256_set1_ps(1 + TBlock::BaryEps), _CMP_LE_OQ));
+            if (_mm256_testz_ps(mask, mask))
+                continue;
+
+            __m256 tt = _mm256_mul_ps(dot(e2x, e2y, e2z, qx, qy, qz), inv_det);
+            mask = _mm256_and_ps(mask, mask_positive(tt));
+
+            int bits = _mm256_movemask_ps(mask);
+            if (bits == 0)
+                continue;
+
+            alignas(32) float ts[8], us[8], vs[8];
+            _mm256_store_ps(ts, tt);
+            _mm256_store_ps(us, u);
+            _mm256_store_ps(vs, v);
+
+            while (bits) {
+                const int lane = _tzcnt_u32(bits);
+                bits &= bits - 1;
+
+                idx[nhit] = i + lane;
+                tuv[3 * nhit] = ts[lane];
+                tuv[3 * nhit + 1] = us[lane];
+                tuv[3 * nhit + 2] = vs[lane];
+                nhit++;
+            }
+        }
+
+        return nhit;
+    }
+
+    __declspec(noalias) int _raytri_all(p3f orig, p3f dir, const float* vert, int n, int vsize, int* idx, float* tuv) noexcept
+    {
+        return _raytri_all_impl<aosoa_block_f32>(orig, dir, vert, n, vsize, idx, tuv);
+    }
+
+    __declspec(noalias) int _raytri_all_q16(p3f orig, p3f dir, const float* vert, int n, int* idx, float* tuv) noexcept
+    {
+        return _raytri_all_impl<aosoa_block_q16>(orig, dir, vert, n, 8, idx, tuv);
+    }
+
     // For the layout of vert, see _raytri.
-    __declspec(noalias) int _pttri(p3f orig, const float* vert, int n, p3f& retBary, p3f& retPt, float& retDist)
+    template<typename TBlock>
+    __declspec(noalias) static int _pttri_impl(p3f orig, const float* vert, int n, p3f& retBary, p3f& retPt, float& retDist)
     {
         constexpr int VectorSize = 8;
 
@@ -102,25 +282,27 @@ namespace warpcore::impl
         // This loop is a vectorized form of what's in Embree: 
         // https://github.com/RenderKit/embree/blob/master/tutorials/common/math/closest_point.h
         for (int i = 0; i < n; i += VectorSize) {
-            const float* vert_base = vert + i * 9;
+            const TBlock blk(vert, i, VectorSize);
             __m256 mask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(n - i), rng));
 
             __m256 u = _mm256_setzero_ps(), v = _mm256_setzero_ps();
 
             // load a
-            const __m256 ax = _mm256_loadu_ps(vert_base);
-            const __m256 ay = _mm256_loadu_ps(vert_base + 1 * VectorSize);
-            const __m256 az = _mm256_loadu_ps(vert_base + 2 * VectorSize);
+            const __m256 ax = blk.load(0);
+            const __m256 ay = blk.load(1);
+            const __m256 az = blk.load(2);
 
             // ab = b - a
-            const __m256 abx = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 3 * VectorSize), ax);
-            const __m256 aby = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 4 * VectorSize), ay);
-            const __m256 abz = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 5 * VectorSize), az);
+            const __m256 bx = blk.load(3), by = blk.load(4), bz = blk.load(5);
+            const __m256 abx = _mm256_sub_ps(bx, ax);
+            const __m256 aby = _mm256_sub_ps(by, ay);
+            const __m256 abz = _mm256_sub_ps(bz, az);
 
             // ac = c - a
-            const __m256 acx = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 6 * VectorSize), ax);
-            const __m256 acy = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 7 * VectorSize), ay);
-            const __m256 acz = _mm256_sub_ps(_mm256_loadu_ps(vert_base + 8 * VectorSize), az);
+            const __m256 cx = blk.load(6), cy = blk.load(7), cz = blk.load(8);
+            const __m256 acx = _mm256_sub_ps(cx, ax);
+            const __m256 acy = _mm256_sub_ps(cy, ay);
+            const __m256 acz = _mm256_sub_ps(cz, az);
 
             // ap = p - a
             const __m256 apx = _mm256_sub_ps(_mm256_permute_ps(o, 0b00000000), ax);
@@ -138,9 +320,9 @@ namespace warpcore::impl
             //v = _mm256_blendv_ps(v, _mm256_setzero_ps(), m1);
 
             // bp = p - b
-            const __m256 bpx = _mm256_sub_ps(_mm256_permute_ps(o, 0b00000000), _mm256_loadu_ps(vert_base + 3 * VectorSize));
-            const __m256 bpy = _mm256_sub_ps(_mm256_permute_ps(o, 0b01010101), _mm256_loadu_ps(vert_base + 4 * VectorSize));
-            const __m256 bpz = _mm256_sub_ps(_mm256_permute_ps(o, 0b10101010), _mm256_loadu_ps(vert_base + 5 * VectorSize));
+            const __m256 bpx = _mm256_sub_ps(_mm256_permute_ps(o, 0b00000000), bx);
+            const __m256 bpy = _mm256_sub_ps(_mm256_permute_ps(o, 0b01010101), by);
+            const __m256 bpz = _mm256_sub_ps(_mm256_permute_ps(o, 0b10101010), bz);
             
             // d3 = dot(ab, bp); d4 = dot(ac, bp);
             __m256 d3 = dot(abx, aby, abz, bpx, bpy, bpz);
@@ -153,9 +335,9 @@ namespace warpcore::impl
             //v = _mm256_blendv_ps(v, _mm256_setzero_ps(), m2); // these lanes are already zero
 
             // cp = p - c
-            const __m256 cpx = _mm256_sub_ps(_mm256_permute_ps(o, 0b00000000), _mm256_loadu_ps(vert_base + 6 * VectorSize));
-            const __m256 cpy = _mm256_sub_ps(_mm256_permute_ps(o, 0b01010101), _mm256_loadu_ps(vert_base + 7 * VectorSize));
-            const __m256 cpz = _mm256_sub_ps(_mm256_permute_ps(o, 0b10101010), _mm256_loadu_ps(vert_base + 8 * VectorSize));
+            const __m256 cpx = _mm256_sub_ps(_mm256_permute_ps(o, 0b00000000), cx);
+            const __m256 cpy = _mm256_sub_ps(_mm256_permute_ps(o, 0b01010101), cy);
+            const __m256 cpz = _mm256_sub_ps(_mm256_permute_ps(o, 0b10101010), cz);
 
             // d5 = dot(ab, cp); d6 = dot(ac, cp);
             __m256 d5 = dot(abx, aby, abz, cpx, cpy, cpz);
@@ -250,7 +432,7 @@ namespace warpcore::impl
         retBary = p3f_set(extract(u_best, i), extract(v_best, i), 0);
         
         p3f a, b, c;
-        extract_aosoa_triangle<VectorSize>(vert, j, a, b, c);
+        TBlock::extract(vert, j, a, b, c);
 
         retPt = p3f_add(a, p3f_add(
                 p3f_mul(p3f_broadcast<0>(retBary), p3f_sub(b, a)),
@@ -259,4 +441,263 @@ namespace warpcore::impl
 
         return j;
     }
+
+    __declspec(noalias) int _pttri(p3f orig, const float* vert, int n, p3f& retBary, p3f& retPt, float& retDist)
+    {
+        return _pttri_impl<aosoa_block_f32>(orig, vert, n, retBary, retPt, retDist);
+    }
+
+    __declspec(noalias) int _pttri_q16(p3f orig, const float* vert, int n, p3f& retBary, p3f& retPt, float& retDist)
+    {
+        return _pttri_impl<aosoa_block_q16>(orig, vert, n, retBary, retPt, retDist);
+    }
+
+    static inline __mmask16 WCORE_VECCALL mask_positive16(__m512 x) noexcept
+    {
+        // Same as mask_positive, sign bit clear.
+        return _mm512_cmpge_epi32_mask(_mm512_castps_si512(x), _mm512_setzero_si512());
+    }
+
+    static inline __mmask16 WCORE_VECCALL mask_negative16(__m512 x) noexcept
+    {
+        return _mm512_cmplt_epi32_mask(_mm512_castps_si512(x), _mm512_setzero_si512());
+    }
+
+    static inline __m512 WCORE_VECCALL dot16(__m512 ax, __m512 ay, __m512 az, __m512 bx, __m512 by, __m512 bz) noexcept
+    {
+        return _mm512_fmadd_ps(ax, bx, _mm512_add_ps(_mm512_mul_ps(ay, by), _mm512_mul_ps(az, bz)));
+    }
+
+    static inline void WCORE_VECCALL cross16(__m512 ax, __m512 ay, __m512 az, __m512 bx, __m512 by, __m512 bz, __m512& cx, __m512& cy, __m512& cz) noexcept
+    {
+        cx = _mm512_fmsub_ps(ay, bz, _mm512_mul_ps(az, by));
+        cy = _mm512_fmsub_ps(az, bx, _mm512_mul_ps(ax, bz));
+        cz = _mm512_fmsub_ps(ax, by, _mm512_mul_ps(ay, bx));
+    }
+
+    static inline __m256 WCORE_VECCALL upper8(__m512 x) noexcept
+    {
+        return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1));
+    }
+
+    // Fold per-lane minima of t (with the associated u, v, idx) from 16 lanes to 8, so that the
+    // 8-wide reductions and traits can finish the job.
+    static inline void WCORE_VECCALL fold_min16(__m512 t, __m512 u, __m512 v, __m512i idx, __m256& t8, __m256& u8, __m256& v8, __m256i& idx8) noexcept
+    {
+        const __m256 tlo = _mm512_castps512_ps256(t), thi = upper8(t);
+        const __m256 m = _mm256_cmp_ps(thi, tlo, _CMP_LT_OQ);
+        t8 = _mm256_blendv_ps(tlo, thi, m);
+        u8 = _mm256_blendv_ps(_mm512_castps512_ps256(u), upper8(u), m);
+        v8 = _mm256_blendv_ps(_mm512_castps512_ps256(v), upper8(v), m);
+        idx8 = _mm256_blendv_epi8(_mm512_castsi512_si256(idx), _mm512_extracti64x4_epi64(idx, 1), _mm256_castps_si256(m));
+    }
+
+    // {x, x} without _mm512_insertf32x8, which needs AVX512DQ. Only AVX512F is checked for.
+    static inline __m512 dup256_ps(__m256 x) noexcept
+    {
+        const __m512d xd = _mm512_castps_pd(_mm512_castps256_ps512(x));
+        return _mm512_castpd_ps(_mm512_insertf64x4(xd, _mm256_castps_pd(x), 1));
+    }
+
+    // AVX-512 variant of _raytri for cells laid out in blocks of 16 triangles {16*x0, 16*y0, ... 16*z2}.
+    // The incoming and outgoing best* are 8 lanes wide, so that the result traits can be shared.
+    __declspec(noalias) void _raytri_avx512(p3f orig, p3f dir, const float* vert, int n, __m256& bestu8, __m256& bestv8, __m256& bestt8, __m256i& besti8) noexcept
+    {
+        constexpr int VectorSize = 16;
+        constexpr float EPS = 1e-30f;
+        const __m512i rng = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+        alignas(16) float of[4], df[4];
+        _mm_store_ps(of, orig);
+        _mm_store_ps(df, dir);
+        const __m512 ox = _mm512_set1_ps(of[0]), oy = _mm512_set1_ps(of[1]), oz = _mm512_set1_ps(of[2]);
+        const __m512 dx = _mm512_set1_ps(df[0]), dy = _mm512_set1_ps(df[1]), dz = _mm512_set1_ps(df[2]);
+
+        // Both halves start from the incoming 8-wide state, duplicates do not hurt the reduction.
+        __m512 bestt = dup256_ps(bestt8);
+        __m512 bestu = dup256_ps(bestu8);
+        __m512 bestv = dup256_ps(bestv8);
+        __m512i besti = _mm512_inserti64x4(_mm512_castsi256_si512(besti8), besti8, 1);
+
+        for (int i = 0; i < n; i += VectorSize) {
+            __mmask16 mask = _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(n - i), rng);
+            const float* vert_base = vert + 9 * i;
+
+            const __m512 ax = _mm512_loadu_ps(vert_base);
+            const __m512 ay = _mm512_loadu_ps(vert_base + 1 * VectorSize);
+            const __m512 az = _mm512_loadu_ps(vert_base + 2 * VectorSize);
+
+            const __m512 e1x = _mm512_sub_ps(_mm512_loadu_ps(vert_base + 3 * VectorSize), ax);
+            const __m512 e1y = _mm512_sub_ps(_mm512_loadu_ps(vert_base + 4 * VectorSize), ay);
+            const __m512 e1z = _mm512_sub_ps(_mm512_loadu_ps(vert_base + 5 * VectorSize), az);
+
+            const __m512 e2x = _mm512_sub_ps(_mm512_loadu_ps(vert_base + 6 * VectorSize), ax);
+            const __m512 e2y = _mm512_sub_ps(_mm512_loadu_ps(vert_base + 7 * VectorSize), ay);
+            const __m512 e2z = _mm512_sub_ps(_mm512_loadu_ps(vert_base + 8 * VectorSize), az);
+
+            __m512 px, py, pz;
+            cross16(dx, dy, dz, e2x, e2y, e2z, px, py, pz);
+
+            const __m512 det = dot16(e1x, e1y, e1z, px, py, pz);
+            mask = _mm512_mask_cmp_ps_mask(mask, _mm512_abs_ps(det), _mm512_set1_ps(EPS), _CMP_GT_OQ);
+            if (!mask)
+                continue;
+
+            const __m512 inv_det = _mm512_rcp14_ps(det);
+            const __m512 sx = _mm512_sub_ps(ox, ax);
+            const __m512 sy = _mm512_sub_ps(oy, ay);
+            const __m512 sz = _mm512_sub_ps(oz, az);
+
+            const __m512 u = _mm512_mul_ps(dot16(sx, sy, sz, px, py, pz), inv_det);
+            mask &= mask_positive16(u);
+            mask = _mm512_mask_cmp_ps_mask(mask, u, _mm512_set1_ps(1), _CMP_LE_OQ);
+
+            __m512 qx, qy, qz;
+            cross16(sx, sy, sz, e1x, e1y, e1z, qx, qy, qz);
+
+            const __m512 v = _mm512_mul_ps(dot16(dx, dy, dz, qx, qy, qz), inv_det);
+            mask &= mask_positive16(v);
+            mask = _mm512_mask_cmp_ps_mask(mask, _mm512_add_ps(u, v), _mm512_set1_ps(1), _CMP_LE_OQ);
+            if (!mask)
+                continue;
+
+            const __m512 tt = _mm512_mul_ps(dot16(e2x, e2y, e2z, qx, qy, qz), inv_det);
+            mask &= mask_positive16(tt);
+            mask = _mm512_mask_cmp_ps_mask(mask, tt, bestt, _CMP_LT_OQ);
+
+            bestt = _mm512_mask_mov_ps(bestt, mask, tt);
+            bestu = _mm512_mask_mov_ps(bestu, mask, u);
+            bestv = _mm512_mask_mov_ps(bestv, mask, v);
+            besti = _mm512_mask_mov_epi32(besti, mask, _mm512_add_epi32(rng, _mm512_set1_epi32(i)));
+        }
+
+        fold_min16(bestt, bestu, bestv, besti, bestt8, bestu8, bestv8, besti8);
+    }
+
+    // AVX-512 variant of _pttri for cells laid out in blocks of 16 triangles.
+    __declspec(noalias) int _pttri_avx512(p3f orig, const float* vert, int n, p3f& retBary, p3f& retPt, float& retDist)
+    {
+        constexpr int VectorSize = 16;
+
+        if (n == 0) return -1;
+
+        const __m512i rng = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        const __m512 one = _mm512_set1_ps(1.0f);
+        __m512 dist_best = _mm512_set1_ps(1e20f);
+        __m512 u_best = _mm512_setzero_ps(), v_best = _mm512_setzero_ps();
+        __m512i i_best = _mm512_setzero_si512();
+
+        alignas(16) float of[4];
+        _mm_store_ps(of, orig);
+        const __m512 ox = _mm512_set1_ps(of[0]), oy = _mm512_set1_ps(of[1]), oz = _mm512_set1_ps(of[2]);
+
+        // See _pttri for the scalar origin of this.
+        for (int i = 0; i < n; i += VectorSize) {
+            const float* vert_base = vert + i * 9;
+            const __mmask16 mask = _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(n - i), rng);
+
+            __m512 u = _mm512_setzero_ps(), v = _mm512_setzero_ps();
+
+            const __m512 ax = _mm512_loadu_ps(vert_base);
+            const __m512 ay = _mm512_loadu_ps(vert_base + 1 * VectorSize);
+            const __m512 az = _mm512_loadu_ps(vert_base + 2 * VectorSize);
+            const __m512 bx = _mm512_loadu_ps(vert_base + 3 * VectorSize);
+            const __m512 by = _mm512_loadu_ps(vert_base + 4 * VectorSize);
+            const __m512 bz = _mm512_loadu_ps(vert_base + 5 * VectorSize);
+            const __m512 cx = _mm512_loadu_ps(vert_base + 6 * VectorSize);
+            const __m512 cy = _mm512_loadu_ps(vert_base + 7 * VectorSize);
+            const __m512 cz = _mm512_loadu_ps(vert_base + 8 * VectorSize);
+
+            const __m512 abx = _mm512_sub_ps(bx, ax), aby = _mm512_sub_ps(by, ay), abz = _mm512_sub_ps(bz, az);
+            const __m512 acx = _mm512_sub_ps(cx, ax), acy = _mm512_sub_ps(cy, ay), acz = _mm512_sub_ps(cz, az);
+            const __m512 apx = _mm512_sub_ps(ox, ax), apy = _mm512_sub_ps(oy, ay), apz = _mm512_sub_ps(oz, az);
+
+            const __m512 d1 = dot16(abx, aby, abz, apx, apy, apz);
+            const __m512 d2 = dot16(acx, acy, acz, apx, apy, apz);
+
+            // closest to a
+            const __mmask16 m1 = mask_negative16(d1) & mask_negative16(d2);
+            __mmask16 m123456 = m1;
+
+            const __m512 bpx = _mm512_sub_ps(ox, bx), bpy = _mm512_sub_ps(oy, by), bpz = _mm512_sub_ps(oz, bz);
+            const __m512 d3 = dot16(abx, aby, abz, bpx, bpy, bpz);
+            const __m512 d4 = dot16(acx, acy, acz, bpx, bpy, bpz);
+
+            // closest to b
+            const __mmask16 m2 = _mm512_mask_cmp_ps_mask(mask_positive16(d3), d4, d3, _CMP_LE_OQ);
+            m123456 |= m2;
+            u = _mm512_mask_mov_ps(u, m2, one);
+
+            const __m512 cpx = _mm512_sub_ps(ox, cx), cpy = _mm512_sub_ps(oy, cy), cpz = _mm512_sub_ps(oz, cz);
+            const __m512 d5 = dot16(abx, aby, abz, cpx, cpy, cpz);
+            const __m512 d6 = dot16(acx, acy, acz, cpx, cpy, cpz);
+
+            // closest to c
+            const __mmask16 m3 = _mm512_mask_cmp_ps_mask(mask_positive16(d6), d5, d6, _CMP_LE_OQ);
+            m123456 |= m3;
+            v = _mm512_mask_mov_ps(v, m3, one);
+
+            // closest to ab
+            const __m512 vc = _mm512_fmsub_ps(d1, d4, _mm512_mul_ps(d3, d2));
+            const __mmask16 m4 = mask_negative16(vc) & mask_positive16(d1) & mask_negative16(d3);
+            m123456 |= m4;
+            if (m4 & mask)
+                u = _mm512_mask_div_ps(u, m4, d1, _mm512_sub_ps(d1, d3));
+
+            // closest to ac
+            const __m512 vb = _mm512_fmsub_ps(d5, d2, _mm512_mul_ps(d1, d6));
+            const __mmask16 m5 = mask_negative16(vb) & mask_positive16(d2) & mask_negative16(d6);
+            m123456 |= m5;
+            if (m5 & mask)
+                v = _mm512_mask_div_ps(v, m5, d2, _mm512_sub_ps(d2, d6));
+
+            // closest to bc
+            const __m512 va = _mm512_fmsub_ps(d3, d6, _mm512_mul_ps(d5, d4));
+            const __mmask16 m6 = mask_negative16(va) &
+                _mm512_cmp_ps_mask(d4, d3, _CMP_GE_OQ) &
+                _mm512_cmp_ps_mask(d5, d6, _CMP_GE_OQ);
+            m123456 |= m6;
+            if (m6 & mask) {
+                const __m512 d4d3 = _mm512_sub_ps(d4, d3);
+                const __m512 t = _mm512_div_ps(d4d3, _mm512_add_ps(d4d3, _mm512_sub_ps(d5, d6)));
+                u = _mm512_mask_mov_ps(u, m6, _mm512_sub_ps(one, t));
+                v = _mm512_mask_mov_ps(v, m6, t);
+            }
+
+            // inside the face
+            const __mmask16 m7 = ~m123456 & mask;
+            const __m512 denom = _mm512_rcp14_ps(_mm512_add_ps(_mm512_add_ps(va, vb), vc));
+            u = _mm512_mask_mul_ps(u, m7, vb, denom);
+            v = _mm512_mask_mul_ps(v, m7, vc, denom);
+
+            const __m512 prx = _mm512_sub_ps(_mm512_fmadd_ps(u, abx, _mm512_fmadd_ps(v, acx, ax)), ox);
+            const __m512 pry = _mm512_sub_ps(_mm512_fmadd_ps(u, aby, _mm512_fmadd_ps(v, acy, ay)), oy);
+            const __m512 prz = _mm512_sub_ps(_mm512_fmadd_ps(u, abz, _mm512_fmadd_ps(v, acz, az)), oz);
+            const __m512 dist2 = _mm512_fmadd_ps(prx, prx, _mm512_add_ps(_mm512_mul_ps(pry, pry), _mm512_mul_ps(prz, prz)));
+
+            const __mmask16 mm = _mm512_mask_cmp_ps_mask(mask, dist2, dist_best, _CMP_LT_OQ);
+            dist_best = _mm512_mask_mov_ps(dist_best, mm, dist2);
+            u_best = _mm512_mask_mov_ps(u_best, mm, u);
+            v_best = _mm512_mask_mov_ps(v_best, mm, v);
+            i_best = _mm512_mask_mov_epi32(i_best, mm, _mm512_add_epi32(rng, _mm512_set1_epi32(i)));
+        }
+
+        __m256 dist8, u8, v8;
+        __m256i i8;
+        fold_min16(dist_best, u_best, v_best, i_best, dist8, u8, v8, i8);
+
+        const int i = find_min_index(dist8);
+        const int j = extract(i8, i);
+        retDist = extract(dist8, i);
+        retBary = p3f_set(extract(u8, i), extract(v8, i), 0);
+
+        p3f a, b, c;
+        extract_aosoa_triangle<VectorSize>(vert, j, a, b, c);
+
+        retPt = p3f_add(a, p3f_add(
+                p3f_mul(p3f_broadcast<0>(retBary), p3f_sub(b, a)),
+                p3f_mul(p3f_broadcast<1>(retBary), p3f_sub(c, a))));
+
+        return j;
+    }
 };
\ No newline at end of file
@@ -7,6 +7,11 @@
 
 namespace warpcore::impl
 {
+    // Size in floats of an AoSoA block of 8 triangles with 16-bit quantized coordinates: a header
+    // {x0, y0, z0, 0, sx, sy, sz, 0} followed by the 9*8 coordinates {ax0..ax7,ay0..ay7,...cz7} as
+    // unsigned 16-bit integers q, each of which stands for x0 + q * sx (and so on for y, z).
+    constexpr int AOSOA_Q16_BLOCK = 8 + 9 * 8 / 2;
+
     // Traits for raytri that store the distance to hit for each query.
     struct RayTri_T
     {
@@ -44,17 +49,36 @@ namespace warpcore::impl
    
 
     void _raytri(p3f orig, p3f dir, const float* vert, int n, __m256& u, __m256& v, __m256& bestt, __m256i& besti) noexcept;
+    void _raytri_avx512(p3f orig, p3f dir, const float* vert, int n, __m256& u, __m256& v, __m256& bestt, __m256i& besti) noexcept;
+    void _raytri_q16(p3f orig, p3f dir, const float* vert, int n, __m256& u, __m256& v, __m256& bestt, __m256i& besti) noexcept;
+
+    // Intersect a ray with all n triangles in vert (AoSoA blocks of vsize triangles) and write every hit to 
+    // idx (triangle index in vert) and tuv ({t, u, v} per hit), unsorted. Both must hold n elements.
+    // Returns the number of hits.
+    int _raytri_all(p3f orig, p3f dir, const float* vert, int n, int vsize, int* idx, float* tuv) noexcept;
+    int _raytri_all_q16(p3f orig, p3f dir, const float* vert, int n, int* idx, float* tuv) noexcept;
 
     // Cast a ray from orig along dir and intersect triangles in the AoSoA-ordered array vert (containing n triangles).
     // For the closest hit (if any), return the index of hit triangle and write intersection data to result according
-    // to TTraits. If there is no hit, -1 is reutrned and result is left unmodified.
-    template<typename TTraits>
+    // to TTraits. If there is no hit, -1 is reutrned and result is left unmodified. NWidth is the number of triangles
+    // per AoSoA block, 16 requires AVX-512. With NQuant, vert holds quantized blocks (see AOSOA_Q16_BLOCK)
+    // and NWidth must be 8.
+    template<typename TTraits, int NWidth = 8, bool NQuant = false>
     int raytri(p3f orig, p3f dir, const float* vert, int n, float* result) noexcept
     {
+        static_assert(NWidth == 8 || NWidth == 16);
+        static_assert(!NQuant || NWidth == 8);
         __m256 bestt = _mm256_set1_ps(1e30f);
         __m256i besti = _mm256_set1_epi32(-1);
-        __m256 u, v;
-        _raytri(orig, dir, vert, n, u, v, bestt, besti);
+        __m256 u = _mm256_setzero_ps(), v = _mm256_setzero_ps();
+
+        if constexpr (NQuant)
+            _raytri_q16(orig, dir, vert, n, u, v, bestt, besti);
+        else if constexpr (NWidth == 16)
+            _raytri_avx512(orig, dir, vert, n, u, v, bestt, besti);
+        else
+            _raytri(orig, dir, vert, n, u, v, bestt, besti);
+
         return TTraits::store(bestt, besti, u, v, result);
     }
 
@@ -82,19 +106,30 @@ namespace warpcore::impl
   
 
     int _pttri(p3f orig, const float* vert, int n, p3f& retBary, p3f& retPt, float& retDist);
+    int _pttri_avx512(p3f orig, const float* vert, int n, p3f& retBary, p3f& retPt, float& retDist);
+    int _pttri_q16(p3f orig, const float* vert, int n, p3f& retBary, p3f& retPt, float& retDist);
 
     // Find the closest triangle to orig in the AoSoA-ordered array vert that contains n triangles. Store
     // the result according to TTraits into result and return the index of the hit. pdist is read to clamp
     // the maximum search distance and written to indicate the new hit distance. pdist is squared distance.
-    // If there is no hit closer than pdist, returns -1.
-    template<typename TTraits>
+    // If there is no hit closer than pdist, returns -1. NWidth is the number of triangles per AoSoA block,
+    // NQuant selects quantized blocks as in raytri.
+    template<typename TTraits, int NWidth = 8, bool NQuant = false>
     int pttri(p3f orig, const float* vert, int n, float* result, float* pdist) noexcept
     {
+        static_assert(NWidth == 8 || NWidth == 16);
+        static_assert(!NQuant || NWidth == 8);
         float dist = FLT_MAX;
         p3f bary = p3f_zero();
         p3f pt = p3f_zero();
 
-        int ret = _pttri(orig, vert, n, bary, pt, dist);
+        int ret;
+        if constexpr (NQuant)
+            ret = _pttri_q16(orig, vert, n, bary, pt, dist);
+        else 
+            ret = (NWidth == 16) ? 
+                _pttri_avx512(orig, vert, n, bary, pt, dist) :
+                _pttri(orig, vert, n, bary, pt, dist);
         TTraits::store(pt, bary, dist, result);
         *pdist = dist;
         return ret;
@@ -110,8 +145,8 @@ namespace warpcore::impl
         int jbase = (idx & ~(NRegSize - 1)) * 9;
         int joffs = idx & (NRegSize - 1);
 
-        const __m128i tidx = _mm_setr_epi32(jbase + joffs, jbase + joffs + 8,
-            jbase + joffs + 16, jbase + joffs);
+        const __m128i tidx = _mm_setr_epi32(jbase + joffs, jbase + joffs + NRegSize,
+            jbase + joffs + 2 * NRegSize, jbase + joffs);
 
         a = _mm_i32gather_ps(vert, tidx, 4);
         b = _mm_i32gather_ps(vert + 3 * NRegSize, tidx, 4);
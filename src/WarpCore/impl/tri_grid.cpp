@@ -3,6 +3,8 @@
 #include "vec_math.h"
 #include "search_impl.h"
 #include "utils.h"
+#include "file_io.h"
+#include "cpu_info.h"
 #include <immintrin.h>
 #include <cmath>
 
@@ -12,20 +14,35 @@ using namespace warpcore;
 
 namespace warpcore::impl
 {
+    // Block size of the per-triangle cell ranges, see make_cellidx_ranges_aosoa. The
+    // cells themselves use trigrid::vsize.
     constexpr int VectorSize = 8;
 
     void make_cellidx_ranges_aosoa(const trigrid* grid, const float* vert, const int* idx, int nv, int nt, int* range);
     void make_cell_histogram(const trigrid* grid, const int* idx_range, int nt, int* hist);
     void populate_index_arrays(trigrid* grid, const int* idx_range, int nt, int* counter);
-    void populate_grid_cell(float* dest, const float* vert, const int* idx, const int* face, int nvcell, int nv, int nt);
-
-    void trigrid_build(trigrid* grid, const float* vert, const int* idx, int nv, int nt, int k)
+    void populate_grid_cell(float* dest, const float* vert, const int* idx, const int* face, int nvcell, int nv, int nt, int vsize);
+    void populate_grid_cell_q16(float* dest, const float* vert, const int* idx, const int* face, int nvcell);
+    void populate_grid_cell_any(const trigrid* grid, const trigrid_cell* cell, const float* vert);
+    void trigrid_layout(trigrid* grid, const float* vert);
+    void trigrid_update_occupancy(trigrid* grid);
+    void get_cell_range(const int* idx_range, int i, int* r);
+    bool is_in_cell_range(const int* r, int x, int y, int z);
+    void cell_remove(trigrid_cell* cell, int t);
+    bool cell_append(trigrid_cell* cell, int t);
+
+    void trigrid_build(trigrid* grid, const float* vert, const int* idx, int nv, int nt, int k, bool quant)
     {
         grid->ncell[0] = k;
         grid->ncell[1] = k;
         grid->ncell[2] = k;
         grid->ncell[3] = k * k; // cache the product since we have the room
         grid->nt = nt;
+        grid->nv = nv;
+        grid->quant = quant ? 1 : 0;
+
+        // The quantized kernels are AVX2 only.
+        grid->vsize = (has_feature(WCORE_OPTPATH::AVX512) && !quant) ? 16 : 8;
 
         const int num_cells = grid->ncell[0] * grid->ncell[1] * grid->ncell[2];
         grid->cells = new trigrid_cell[num_cells];
@@ -45,52 +62,475 @@ namespace warpcore::impl
         }
 
         grid->x0[3] = grid->x1[3] = grid->dx[3] = 0;
+        grid->backing = nullptr;
+        grid->stats = nullptr;
+        grid->occupancy = nullptr;
+
+        grid->tri_idx = new int[3 * nt];
+        memcpy(grid->tri_idx, idx, sizeof(int) * 3 * nt);
+
+        grid->tri_range = new int[6 * nt + 6 * VectorSize];
+        memset(grid->tri_range, 0, sizeof(int) * (6 * nt + 6 * VectorSize));
+        make_cellidx_ranges_aosoa(grid, vert, idx, nv, nt, grid->tri_range);
+
+        trigrid_layout(grid, vert);
+    }
+
+    bool trigrid_refit(trigrid* grid, const float* vert)
+    {
+        const int nt = grid->nt;
+        const int nv = grid->nv;
+
+        float x0[4], x1[4];
+        pcl_aabb(vert, 3, nv, x0, x1);
+
+        // The cell dimensions are kept fixed, so if the deformed mesh does not fit into the
+        // grid anymore, there is no way around a full rebuild. Mapped grids are read-only 
+        // and get rebuilt into private memory as well.
+        bool fits = true;
+        for (int i = 0; i < 3; i++)
+            fits &= x0[i] >= grid->x0[i] && x1[i] <= grid->x1[i];
+
+        if (!fits || grid->backing) {
+            int* idx = new int[3 * nt];
+            memcpy(idx, grid->tri_idx, sizeof(int) * 3 * nt);
+
+            // Keep the statistics across the rebuild.
+            trigrid_stats* stats = grid->stats;
+            grid->stats = nullptr;
+
+            const int k = grid->ncell[0];
+            const bool quant = grid->quant != 0;
+            trigrid_destroy(grid);
+            trigrid_build(grid, vert, idx, nv, nt, k, quant);
+            grid->stats = stats;
+
+            delete[] idx;
+            return false;
+        }
+
+        int* range = new int[6 * nt + 6 * VectorSize];
+        memset(range, 0, sizeof(int) * (6 * nt + 6 * VectorSize));
+        make_cellidx_ranges_aosoa(grid, vert, grid->tri_idx, nv, nt, range);
+
+        // Move only the triangles whose cell range changed. Cells can take in new triangles
+        // until their capacity (nalign) is exhausted. Should that happen, the cell layout is
+        // made anew from the updated ranges.
+        bool overflow = false;
+        for (int i = 0; i < nt && !overflow; i++) {
+            int ro[6], rn[6];
+            get_cell_range(grid->tri_range, i, ro);
+            get_cell_range(range, i, rn);
+
+            if (memcmp(ro, rn, sizeof(ro)) == 0)
+                continue;
+
+            for (int z = ro[4]; z < ro[5]; z++)
+            for (int y = ro[2]; y < ro[3]; y++)
+            for (int x = ro[0]; x < ro[1]; x++) {
+                if (!is_in_cell_range(rn, x, y, z))
+                    cell_remove(grid->cells + get_trigrid_cell_idx(grid, x, y, z), i);
+            }
+
+            for (int z = rn[4]; z < rn[5] && !overflow; z++)
+            for (int y = rn[2]; y < rn[3] && !overflow; y++)
+            for (int x = rn[0]; x < rn[1] && !overflow; x++) {
+                if (!is_in_cell_range(ro, x, y, z))
+                    overflow = !cell_append(grid->cells + get_trigrid_cell_idx(grid, x, y, z), i);
+            }
+        }
+
+        std::swap(range, grid->tri_range);
+        delete[] range;
+
+        if (overflow) {
+            _aligned_free(grid->buff_vert);
+            _aligned_free(grid->buff_idx);
+            trigrid_layout(grid, vert);
+            return true;
+        }
+
+        trigrid_update_occupancy(grid);
+
+        const int num_cells = grid->ncell[0] * grid->ncell[1] * grid->ncell[2];
+
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int i = 0; i < num_cells; i++)
+            populate_grid_cell_any(grid, grid->cells + i, vert);
+
+        return true;
+    }
+
+    void trigrid_destroy(trigrid* grid)
+    {
+        if(grid->cells) {
+            delete[] grid->cells;
+            grid->cells = nullptr;
+        }
+
+        if (grid->backing) {
+            mapped_file_close(grid->backing);
+            delete grid->backing;
+            grid->backing = nullptr;
+        } else {
+            _aligned_free(grid->buff_vert);
+            _aligned_free(grid->buff_idx);
+            delete[] grid->tri_idx;
+            delete[] grid->tri_range;
+        }
+
+        grid->buff_vert = nullptr;
+        grid->buff_idx = nullptr;
+        grid->tri_idx = nullptr;
+        grid->tri_range = nullptr;
+
+        delete grid->stats;
+        grid->stats = nullptr;
+
+        delete[] grid->occupancy;
+        grid->occupancy = nullptr;
+    }
+
+    bool trigrid_save(const trigrid* grid, const char* path)
+    {
+        const int num_cells = grid->ncell[0] * grid->ncell[1] * grid->ncell[2];
+        const int64_t nr = 6 * grid->nt + 6 * VectorSize;
+
+        trigrid_file_cell* cells = new trigrid_file_cell[num_cells];
+        int64_t ng = 0;
+        for (int i = 0; i < num_cells; i++) {
+            cells[i].n = grid->cells[i].n;
+            cells[i].nalign = grid->cells[i].nalign;
+            cells[i].offs = grid->cells[i].idx - grid->buff_idx;
+            ng = std::max(ng, cells[i].offs + cells[i].nalign);
+        }
+
+        auto padded = [](int64_t size) -> int64_t { 
+            return (size + TRIGRID_FILE_ALIGN - 1) / TRIGRID_FILE_ALIGN * TRIGRID_FILE_ALIGN; 
+        };
+
+        trigrid_file_header hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = TRIGRID_FILE_MAGIC;
+        hdr.version = TRIGRID_FILE_VERSION;
+        hdr.nt = grid->nt;
+        hdr.nv = grid->nv;
+        memcpy(hdr.x0, grid->x0, sizeof(hdr.x0));
+        memcpy(hdr.x1, grid->x1, sizeof(hdr.x1));
+        memcpy(hdr.dx, grid->dx, sizeof(hdr.dx));
+        memcpy(hdr.ncell, grid->ncell, sizeof(hdr.ncell));
+        hdr.vsize = grid->vsize;
+        hdr.quant = grid->quant;
+        hdr.ng = ng;
+        hdr.offs_cells = padded(sizeof(trigrid_file_header));
+        hdr.offs_vert = hdr.offs_cells + padded(sizeof(trigrid_file_cell) * num_cells);
+        hdr.offs_idx = hdr.offs_vert + padded(sizeof(float) * trigrid_vert_size(ng, grid->quant));
+        hdr.offs_tri_idx = hdr.offs_idx + padded(sizeof(int) * ng);
+        hdr.offs_tri_range = hdr.offs_tri_idx + padded(sizeof(int) * 3 * grid->nt);
+        hdr.size = hdr.offs_tri_range + padded(sizeof(int) * nr);
+
+        FILE* f = file_open(path, "wb");
+        bool ret = f != nullptr;
+        if (ret) {
+            ret = file_write_padded(f, &hdr, sizeof(hdr), TRIGRID_FILE_ALIGN) &&
+                file_write_padded(f, cells, sizeof(trigrid_file_cell) * num_cells, TRIGRID_FILE_ALIGN) &&
+                file_write_padded(f, grid->buff_vert, sizeof(float) * trigrid_vert_size(ng, grid->quant), TRIGRID_FILE_ALIGN) &&
+                file_write_padded(f, grid->buff_idx, sizeof(int) * ng, TRIGRID_FILE_ALIGN) &&
+                file_write_padded(f, grid->tri_idx, sizeof(int) * 3 * grid->nt, TRIGRID_FILE_ALIGN) &&
+                file_write_padded(f, grid->tri_range, sizeof(int) * nr, TRIGRID_FILE_ALIGN);
+            ret &= fclose(f) == 0;
+        }
+
+        delete[] cells;
+        return ret;
+    }
+
+    bool trigrid_load(trigrid* grid, mapped_file* mf)
+    {
+        // Validate everything the queries could trip on, the file may come from anywhere.
+        if (mf->size < (int64_t)sizeof(trigrid_file_header))
+            return false;
+
+        const uint8_t* base = (const uint8_t*)mf->view;
+        const trigrid_file_header* hdr = (const trigrid_file_header*)base;
+        if (hdr->magic != TRIGRID_FILE_MAGIC || hdr->version != TRIGRID_FILE_VERSION || hdr->size > mf->size)
+            return false;
+
+        const int64_t k = hdr->ncell[0];
+        if (k <= 0 || k > 1024 || hdr->ncell[1] != k || hdr->ncell[2] != k || hdr->ncell[3] != k * k || 
+            hdr->nt < 0 || hdr->nv < 0 || hdr->ng < 0)
+            return false;
+
+        // 16-wide cells are only usable with AVX-512.
+        if (hdr->vsize != 8 && !(hdr->vsize == 16 && has_feature(WCORE_OPTPATH::AVX512)))
+            return false;
+
+        if ((hdr->quant != 0 && hdr->quant != 1) || (hdr->quant && hdr->vsize != 8))
+            return false;
+
+        for (int i = 0; i < 3; i++) {
+            if (!std::isfinite(hdr->x0[i]) || !std::isfinite(hdr->x1[i]) || !std::isfinite(hdr->dx[i]) ||
+                !(hdr->dx[i] > 0) || !(hdr->x1[i] >= hdr->x0[i]))
+                return false;
+        }
+
+        const int num_cells = (int)(k * k * k);
+        const int64_t nr = 6 * (int64_t)hdr->nt + 6 * VectorSize;
+        if (hdr->offs_cells < (int64_t)sizeof(trigrid_file_header) ||
+            hdr->offs_vert < hdr->offs_cells + (int64_t)sizeof(trigrid_file_cell) * num_cells ||
+            hdr->offs_idx < hdr->offs_vert + (int64_t)sizeof(float) * trigrid_vert_size(hdr->ng, hdr->quant) ||
+            hdr->offs_tri_idx < hdr->offs_idx + (int64_t)sizeof(int) * hdr->ng ||
+            hdr->offs_tri_range < hdr->offs_tri_idx + (int64_t)sizeof(int) * 3 * hdr->nt ||
+            hdr->size < hdr->offs_tri_range + (int64_t)sizeof(int) * nr ||
+            hdr->offs_vert % TRIGRID_FILE_ALIGN != 0 || hdr->offs_idx % TRIGRID_FILE_ALIGN != 0)
+            return false;
+
+        // The contents are checked, too, the queries index with triangles from the cells, the refit with 
+        // vertices from the triangles and the ranges address the cells.
+        const int* buff_idx = (const int*)(base + hdr->offs_idx);
+        const trigrid_file_cell* cells = (const trigrid_file_cell*)(base + hdr->offs_cells);
+        for (int i = 0; i < num_cells; i++) {
+            if (cells[i].n < 0 || cells[i].n > cells[i].nalign || cells[i].nalign % hdr->vsize != 0 ||
+                cells[i].offs < 0 || cells[i].offs % hdr->vsize != 0 || cells[i].offs + cells[i].nalign > hdr->ng)
+                return false;
+
+            for (int j = 0; j < cells[i].n; j++) {
+                const int t = buff_idx[cells[i].offs + j];
+                if (t < 0 || t >= hdr->nt)
+                    return false;
+            }
+        }
+
+        const int* tri_idx = (const int*)(base + hdr->offs_tri_idx);
+        for (int64_t i = 0; i < 3 * (int64_t)hdr->nt; i++) {
+            if (tri_idx[i] < 0 || tri_idx[i] >= hdr->nv)
+                return false;
+        }
+
+        const int* tri_range = (const int*)(base + hdr->offs_tri_range);
+        for (int i = 0; i < hdr->nt; i++) {
+            int r[6];
+            get_cell_range(tri_range, i, r);
+            for (int j = 0; j < 6; j += 2) {
+                if (r[j] < 0 || r[j] > r[j + 1] || r[j + 1] > k)
+                    return false;
+            }
+        }
+
+        grid->nt = hdr->nt;
+        grid->nv = hdr->nv;
+        grid->vsize = hdr->vsize;
+        grid->quant = hdr->quant;
+        memcpy(grid->x0, hdr->x0, sizeof(grid->x0));
+        memcpy(grid->x1, hdr->x1, sizeof(grid->x1));
+        memcpy(grid->dx, hdr->dx, sizeof(grid->dx));
+        memcpy(grid->ncell, hdr->ncell, sizeof(grid->ncell));
+
+        // The blocks are used in place. Only the cell table is made anew, since it holds pointers.
+        grid->buff_vert = (float*)(base + hdr->offs_vert);
+        grid->buff_idx = (int*)(base + hdr->offs_idx);
+        grid->tri_idx = (int*)(base + hdr->offs_tri_idx);
+        grid->tri_range = (int*)(base + hdr->offs_tri_range);
+        grid->backing = mf;
+        grid->stats = nullptr;
+
+        grid->cells = new trigrid_cell[num_cells];
+        for (int i = 0; i < num_cells; i++) {
+            grid->cells[i].n = cells[i].n;
+            grid->cells[i].nalign = cells[i].nalign;
+            grid->cells[i].vert = grid->buff_vert + trigrid_vert_size(cells[i].offs, grid->quant);
+            grid->cells[i].idx = grid->buff_idx + cells[i].offs;
+        }
+
+        // The occupancy masks are cheap to derive and not stored.
+        grid->occupancy = nullptr;
+        trigrid_update_occupancy(grid);
+
+        return true;
+    }
+
+    void trigrid_collect_stats(trigrid* grid, bool enable)
+    {
+        if (enable) {
+            // (Re)enabling starts counting from zero.
+            if (!grid->stats)
+                grid->stats = new trigrid_stats;
+
+            memset(grid->stats, 0, sizeof(trigrid_stats));
+        } else {
+            delete grid->stats;
+            grid->stats = nullptr;
+        }
+    }
+
+    void trigrid_stats_add(trigrid_stats* stats, int cells, int tris, int early, bool exhausted) noexcept
+    {
+        // Queries may run in parallel on one grid.
+        #pragma omp atomic
+        stats->queries++;
+
+        #pragma omp atomic
+        stats->cells_visited += cells;
+
+        #pragma omp atomic
+        stats->tris_tested += tris;
+
+        #pragma omp atomic
+        stats->early_outs += early;
+
+        if (exhausted) {
+            #pragma omp atomic
+            stats->max_dist_reached++;
+        }
+    }
+
+    void trigrid_cell_histogram(const trigrid* grid, int bin_width, int* hist, int nbins)
+    {
+        if (bin_width < 1)
+            bin_width = 1;
+
+        memset(hist, 0, sizeof(int) * nbins);
+
+        // The last bin takes all cells that would fall beyond it.
+        const int num_cells = grid->ncell[0] * grid->ncell[1] * grid->ncell[2];
+        for (int i = 0; i < num_cells; i++)
+            hist[std::min(grid->cells[i].n / bin_width, nbins - 1)]++;
+    }
+
+    // Number of floats in buff_vert taken by ng triangle slots, ng must be a multiple of trigrid::vsize.
+    int64_t trigrid_vert_size(int64_t ng, bool quant) noexcept
+    {
+        return quant ? (ng / 8) * AOSOA_Q16_BLOCK : 9 * ng;
+    }
+
+    // Bytes taken by the cell vertex data, the cell triangle indices and everything else.
+    void trigrid_memory(const trigrid* grid, int64_t& vert_bytes, int64_t& idx_bytes, int64_t& other_bytes) noexcept
+    {
+        const int num_cells = grid->ncell[0] * grid->ncell[1] * grid->ncell[2];
+        int64_t ng = 0;
+        for (int i = 0; i < num_cells; i++)
+            ng += grid->cells[i].nalign;
+
+        const int64_t num_macro = (int64_t)((grid->ncell[0] + 3) >> 2) * ((grid->ncell[1] + 3) >> 2) * ((grid->ncell[2] + 3) >> 2);
+
+        vert_bytes = sizeof(float) * trigrid_vert_size(ng, grid->quant);
+        idx_bytes = sizeof(int) * ng;
+        other_bytes = sizeof(trigrid_cell) * (int64_t)num_cells +
+            sizeof(int) * (3 * (int64_t)grid->nt + 6 * (int64_t)grid->nt + 6 * VectorSize) +
+            sizeof(uint64_t) * num_macro;
+    }
+
+    void trigrid_layout(trigrid* grid, const float* vert)
+    {
+        const int nt = grid->nt;
+        const int num_cells = grid->ncell[0] * grid->ncell[1] * grid->ncell[2];
 
-        int* idx_range = new int[6 * nt + 6 * VectorSize];
-        memset(idx_range, 0, sizeof(int) * (6 * nt + 6 * VectorSize));
-        make_cellidx_ranges_aosoa(grid, vert, idx, nv, nt, idx_range);
-             
         int* hist = new int[num_cells];
-        make_cell_histogram(grid, idx_range, nt, hist);
-        const int ng = reduce_roundup_add_i32(hist, num_cells, 8);
+        make_cell_histogram(grid, grid->tri_range, nt, hist);
+        const int vsize = grid->vsize;
+        const int ng = reduce_roundup_add_i32(hist, num_cells, vsize);
+
+        grid->buff_vert = (float*)_aligned_malloc(trigrid_vert_size(ng, grid->quant) * sizeof(float), vsize * sizeof(float));
+        grid->buff_idx = (int*)_aligned_malloc(ng * sizeof(int), vsize * sizeof(float));
 
-        grid->buff_vert = (float*)_aligned_malloc(ng * 9 * sizeof(float), VectorSize * sizeof(float));
-        grid->buff_idx = (int*)_aligned_malloc(ng * sizeof(int), VectorSize * sizeof(float));
- 
         float* vert_base = grid->buff_vert;
         int* idx_base = grid->buff_idx;
         int offs = 0;
         for(int i = 0; i < num_cells; i++) {
-            int na = round_up(hist[i], VectorSize);
+            int na = round_up(hist[i], vsize);
             grid->cells[i].n = hist[i];
             grid->cells[i].nalign = na;
-            grid->cells[i].vert = vert_base + 9 * offs;
+            grid->cells[i].vert = vert_base + trigrid_vert_size(offs, grid->quant);
             grid->cells[i].idx = idx_base + offs;
             offs += na;
         }
 
         memset(hist, 0, sizeof(int) * num_cells);
-        populate_index_arrays(grid, idx_range, nt, hist);
+        populate_index_arrays(grid, grid->tri_range, nt, hist);
 
         for(int i = 0; i < num_cells; i++)
-            populate_grid_cell(grid->cells[i].vert, vert, idx, grid->cells[i].idx, grid->cells[i].n, nv, nt);
+            populate_grid_cell_any(grid, grid->cells + i, vert);
 
         delete[] hist;
-        delete[] idx_range;
+
+        trigrid_update_occupancy(grid);
     }
 
-    void trigrid_destroy(trigrid* grid)
+    void trigrid_update_occupancy(trigrid* grid)
     {
-        if(grid->cells) {
-            delete[] grid->cells;
-            grid->cells = nullptr;
+        const int mdim[3] = { (grid->ncell[0] + 3) >> 2, (grid->ncell[1] + 3) >> 2, (grid->ncell[2] + 3) >> 2 };
+        const int num_macro = mdim[0] * mdim[1] * mdim[2];
+
+        if (!grid->occupancy)
+            grid->occupancy = new uint64_t[num_macro];
+
+        memset(grid->occupancy, 0, sizeof(uint64_t) * num_macro);
+
+        for (int z = 0; z < grid->ncell[2]; z++)
+        for (int y = 0; y < grid->ncell[1]; y++)
+        for (int x = 0; x < grid->ncell[0]; x++) {
+            if (get_trigrid_cell(grid, x, y, z)->n > 0)
+                grid->occupancy[get_macro_cell_idx(mdim, x, y, z)] |= (uint64_t)1 << get_macro_cell_bit(x, y, z);
         }
+    }
 
-        _aligned_free(grid->buff_vert);
-        _aligned_free(grid->buff_idx);
+    const trigrid_cell* find_trigrid_triangle(const trigrid* g, int tri, int& slot) noexcept
+    {
+        if (tri < 0 || tri >= g->nt)
+            return nullptr;
+
+        // Any cell in the range of tri lists it, take the first one.
+        int r[6];
+        get_cell_range(g->tri_range, tri, r);
+        if (r[0] >= r[1] || r[2] >= r[3] || r[4] >= r[5])
+            return nullptr;
+
+        const trigrid_cell* cell = get_trigrid_cell(g, r[0], r[2], r[4]);
+        for (int i = 0; i < cell->n; i++) {
+            if (cell->idx[i] == tri) {
+                slot = i;
+                return cell;
+            }
+        }
 
-        grid->buff_vert = nullptr;
-        grid->buff_idx = nullptr;
+        return nullptr;
+    }
+
+    void get_cell_range(const int* idx_range, int i, int* r)
+    {
+        const int* idx_range_chunk = idx_range + 6 * (i & ~(VectorSize - 1));
+        const int j = i & (VectorSize - 1);
+
+        for (int k = 0; k < 6; k++)
+            r[k] = idx_range_chunk[k * VectorSize + j];
+    }
+
+    bool is_in_cell_range(const int* r, int x, int y, int z)
+    {
+        return x >= r[0] && x < r[1] &&
+            y >= r[2] && y < r[3] &&
+            z >= r[4] && z < r[5];
+    }
+
+    void cell_remove(trigrid_cell* cell, int t)
+    {
+        for (int i = 0; i < cell->n; i++) {
+            if (cell->idx[i] == t) {
+                cell->idx[i] = cell->idx[cell->n - 1];
+                cell->n--;
+                return;
+            }
+        }
+    }
+
+    bool cell_append(trigrid_cell* cell, int t)
+    {
+        if (cell->n >= cell->nalign)
+            return false;
+
+        cell->idx[cell->n] = t;
+        cell->n++;
+        return true;
     }
 
     void populate_index_arrays(trigrid* grid, const int* idx_range, int nt, int* counter)
@@ -147,34 +587,85 @@ namespace warpcore::impl
         } 
     }
 
-    void populate_grid_cell(float* dest, const float* vert, const int* idx, const int* face, int nvcell, int nv, int nt)
+    void populate_grid_cell(float* dest, const float* vert, const int* idx, const int* face, int nvcell, int nv, int nt, int vsize)
     {
         for(int i = 0; i < nvcell; i++) {
             const int fidx = 3 * face[i];
 
-            int i8 = i / VectorSize;
-            int ii = i & (VectorSize - 1);
+            int i8 = i / vsize;
+            int ii = i & (vsize - 1);
 
             // We are loading and storing as ints of equal size.
-            int* dest_blk = (int*)(dest + i8 * 9 * VectorSize + ii);
+            int* dest_blk = (int*)(dest + i8 * 9 * vsize + ii);
 
             const int* vidx0 = (const int*)(vert + idx[fidx] * 3);
-            dest_blk[0 * VectorSize] = vidx0[0];
-            dest_blk[1 * VectorSize] = vidx0[1];
-            dest_blk[2 * VectorSize] = vidx0[2];
+            dest_blk[0 * vsize] = vidx0[0];
+            dest_blk[1 * vsize] = vidx0[1];
+            dest_blk[2 * vsize] = vidx0[2];
 
             const int* vidx1 = (const int*)(vert + idx[fidx + 1] * 3);
-            dest_blk[3 * VectorSize] = vidx1[0];
-            dest_blk[4 * VectorSize] = vidx1[1];
-            dest_blk[5 * VectorSize] = vidx1[2];
+            dest_blk[3 * vsize] = vidx1[0];
+            dest_blk[4 * vsize] = vidx1[1];
+            dest_blk[5 * vsize] = vidx1[2];
 
             const int* vidx2 = (const int*)(vert + idx[fidx + 2] * 3);
-            dest_blk[6 * VectorSize] = vidx2[0];
-            dest_blk[7 * VectorSize] = vidx2[1];
-            dest_blk[8 * VectorSize] = vidx2[2];
+            dest_blk[6 * vsize] = vidx2[0];
+            dest_blk[7 * vsize] = vidx2[1];
+            dest_blk[8 * vsize] = vidx2[2];
         }
     }
 
+    // Quantize blocks of 8 triangles relative to their AABB, see AOSOA_Q16_BLOCK. The unused lanes
+    // of the last block repeat the first triangle.
+    void populate_grid_cell_q16(float* dest, const float* vert, const int* idx, const int* face, int nvcell)
+    {
+        for (int i = 0; i < nvcell; i += 8) {
+            const int nb = std::min(8, nvcell - i);
+            float* blk = dest + (i / 8) * AOSOA_Q16_BLOCK;
+            uint16_t* q = (uint16_t*)(blk + 8);
+
+            float x0[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+            float x1[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            for (int j = 0; j < nb; j++) {
+                for (int k = 0; k < 3; k++) {
+                    const float* v = vert + 3 * idx[3 * face[i + j] + k];
+                    for (int c = 0; c < 3; c++) {
+                        x0[c] = std::min(x0[c], v[c]);
+                        x1[c] = std::max(x1[c], v[c]);
+                    }
+                }
+            }
+
+            float rs[3];
+            for (int c = 0; c < 3; c++) {
+                const float s = (x1[c] - x0[c]) / 65535.0f;
+                blk[c] = x0[c];
+                blk[4 + c] = s;
+                rs[c] = (s > 0) ? (1.0f / s) : 0.0f;
+            }
+            blk[3] = blk[7] = 0;
+
+            for (int j = 0; j < 8; j++) {
+                const int jj = (j < nb) ? j : 0;
+                for (int k = 0; k < 3; k++) {
+                    const float* v = vert + 3 * idx[3 * face[i + jj] + k];
+                    for (int c = 0; c < 3; c++) {
+                        const float qf = std::round((v[c] - x0[c]) * rs[c]);
+                        q[8 * (3 * k + c) + j] = (uint16_t)std::clamp(qf, 0.0f, 65535.0f);
+                    }
+                }
+            }
+        }
+    }
+
+    void populate_grid_cell_any(const trigrid* grid, const trigrid_cell* cell, const float* vert)
+    {
+        if (grid->quant)
+            populate_grid_cell_q16(cell->vert, vert, grid->tri_idx, cell->idx, cell->n);
+        else
+            populate_grid_cell(cell->vert, vert, grid->tri_idx, cell->idx, cell->n, grid->nv, grid->nt, grid->vsize);
+    }
+
     inline static void load_safe(const int* idx, int n, __m256i& a, __m256i& b, __m256i& c)
     {
         if (n >= 3 * VectorSize) {
@@ -1,23 +1,51 @@
 #pragma once
 
+#include <stdint.h>
+
 namespace warpcore::impl
 {
+    struct mapped_file;
+
     // Cells contain unshared vertex data in AoSoA ordering. The stride is set to 
-    // one AVX register worth: ceil(N/8) * {8*x0, 8*y0,...8*z2}. Primitive indices
+    // one vector register worth: ceil(N/W) * {W*x0, W*y0,...W*z2}, where W is
+    // trigrid::vsize, 8 for AVX2 or 16 for AVX-512. Primitive indices
     // map to the AoSoA blocks. The pointers vert, idx point to locations in
-    // trigrid::buff_vert, buff_idx and are aligned to AVX register size (32B). If
-    // the number of vertices in a cell (trigrid_cell::n) is not divisible by 8, the
+    // trigrid::buff_vert, buff_idx and are aligned to the register size. If the
+    // number of vertices in a cell (trigrid_cell::n) is not divisible by W, the
     // upper parts of each register in an AoSoA block must be masked away when read.
-    // trigrid_cell::nalign is merely trigrid_cell::n rounded up to multiples of 8.
+    // trigrid_cell::nalign is the capacity of the cell, trigrid_cell::n rounded up to
+    // multiples of W at build time. A refit may move triangles in or out of a cell 
+    // as long as n does not exceed nalign. Quantized grids (trigrid::quant) store blocks
+    // of 8 triangles with 16-bit coordinates instead, see AOSOA_Q16_BLOCK, W is 8 then.
     struct trigrid_cell {
         int n, nalign;
         float* vert;
         int* idx; 
     };
 
+    // Traversal counters, collected while trigrid::stats is set. Every raycast and nearest point
+    // descent counts as one query. Early-outs are rays that miss the grid (or start beyond the
+    // maximum distance) and subdivisions of the NN descent culled by the current best distance.
+    // Queries that end without a hit within the maximum distance are counted in max_dist_reached.
+    struct trigrid_stats {
+        int64_t queries;
+        int64_t cells_visited;
+        int64_t tris_tested;
+        int64_t early_outs;
+        int64_t max_dist_reached;
+    };
+
+    // The triangle index buffer and the per-triangle cell ranges (AoSoA chunks of
+    // {8*x0, 8*x1, 8*y0, 8*y1, 8*z0, 8*z1}, see make_cellidx_ranges_aosoa) are retained
+    // after the build so that the grid can be refitted to a deformed copy of the mesh.
+    // If the grid was loaded from a file, backing holds the mapped view and all buffers
+    // but the cell table point into it.
     struct trigrid {
         int __magic;
         int nt;
+        int nv;
+        int vsize;
+        int quant;
         
         float x0[4];
         float x1[4];
@@ -28,11 +56,66 @@ namespace warpcore::impl
 
         float* buff_vert;
         int* buff_idx;
+
+        int* tri_idx;
+        int* tri_range;
+
+        mapped_file* backing;
+        trigrid_stats* stats;
+
+        // Cell occupancy in 4x4x4 macro cells, see get_macro_cell_idx.
+        uint64_t* occupancy;
     };
 
-    void trigrid_build(trigrid* grid, const float* vert, const int* idx, int nv, int nt, int k);
+    // Serialized trigrid. Offsets are in bytes from the start of the file and aligned to
+    // TRIGRID_FILE_ALIGN, so that the blocks can be used in place from a mapped view. Cells
+    // refer to buff_vert, buff_idx with element offsets instead of pointers.
+    constexpr int TRIGRID_FILE_MAGIC = 0x47543957; // "W9TG"
+    constexpr int TRIGRID_FILE_VERSION = 2;
+    constexpr int TRIGRID_FILE_ALIGN = 64;
+
+    struct trigrid_file_header {
+        int magic, version;
+        int nt, nv;
+        float x0[4];
+        float x1[4];
+        float dx[4];
+        int ncell[4];
+        int vsize, quant;
+        int64_t ng;
+        int64_t offs_cells, offs_vert, offs_idx, offs_tri_idx, offs_tri_range;
+        int64_t size;
+    };
+
+    struct trigrid_file_cell {
+        int n, nalign;
+        int64_t offs;
+    };
+
+    // Cells are grouped into blocks of 4x4x4 (macro cells) for empty space skipping. Each macro
+    // cell has a 64-bit mask with one bit per cell, which is set if the cell holds any triangles.
+    inline int get_macro_cell_idx(const int* mdim, int x, int y, int z) noexcept
+    {
+        return (x >> 2) + mdim[0] * ((y >> 2) + mdim[1] * (z >> 2));
+    }
+
+    inline int get_macro_cell_bit(int x, int y, int z) noexcept
+    {
+        return (x & 3) | ((y & 3) << 2) | ((z & 3) << 4);
+    }
+
+    void trigrid_build(trigrid* grid, const float* vert, const int* idx, int nv, int nt, int k, bool quant = false);
+    bool trigrid_refit(trigrid* grid, const float* vert);
     void trigrid_destroy(trigrid* grid);
+    bool trigrid_save(const trigrid* grid, const char* path);
+    bool trigrid_load(trigrid* grid, mapped_file* mf);
+    void trigrid_collect_stats(trigrid* grid, bool enable);
+    void trigrid_stats_add(trigrid_stats* stats, int cells, int tris, int early, bool exhausted) noexcept;
+    void trigrid_cell_histogram(const trigrid* grid, int bin_width, int* hist, int nbins);
+    int64_t trigrid_vert_size(int64_t ng, bool quant) noexcept;
+    void trigrid_memory(const trigrid* grid, int64_t& vert_bytes, int64_t& idx_bytes, int64_t& other_bytes) noexcept;
     const trigrid_cell* get_trigrid_cell(const trigrid* g, int x, int y, int z) noexcept;
     int get_trigrid_cell_idx(const trigrid* g, int x, int y, int z) noexcept;
+    const trigrid_cell* find_trigrid_triangle(const trigrid* g, int tri, int& slot) noexcept;
     bool is_cell_in_grid(const trigrid* g, int x, int y, int z) noexcept;
 };
\ No newline at end of file
@@ -82,7 +82,8 @@ namespace warpcore::impl
         constexpr static size_t MaxScratchpad = 16;
 
         _nntask(const trigrid* g, const float* p, float clamp, float* proj) :
-            grid(g), bestDist(clamp * clamp), result(proj), bestIdx(-1)
+            grid(g), bestDist(clamp * clamp), result(proj), bestIdx(-1), 
+            ncells(0), ntested(0), nculled(0)
         {
             pt = p3f_set(p);
             g0 = p3f_set(g->x0);
@@ -93,6 +94,7 @@ namespace warpcore::impl
         float buff[MaxScratchpad];
         float bestDist;
         int bestIdx;
+        int ncells, ntested, nculled;
         p3f pt, g0, gd;        
     };
 
@@ -106,8 +108,10 @@ namespace warpcore::impl
         p3f box1 = p3f_fma(task.gd, ctx.c1(), task.g0);
         p3f closest_aabb = p3f_proj_to_aabb(task.pt, box0, box1);
 
-        if (p3f_distsq(task.pt, closest_aabb) > task.bestDist)
+        if (p3f_distsq(task.pt, closest_aabb) > task.bestDist) {
+            task.nculled++;
             return;
+        }
 
         float* t = task.buff;
 
@@ -115,13 +119,21 @@ namespace warpcore::impl
             const trigrid_cell* cell = get_trigrid_cell(task.grid, ctx.cx0, ctx.cy0, ctx.cz0);           
             _mm_prefetch((const char*)cell->vert, _MM_HINT_T0);
 
+            task.ncells++;
             if (cell->n > 0) {
+                task.ntested += cell->n;
                 float hitDist = FLT_MAX;
-                const int hitIdx = pttri<TPtTriTraits>(task.pt, cell->vert, cell->n, t, &hitDist);
+                int hitIdx;
+                if (task.grid->quant)
+                    hitIdx = pttri<TPtTriTraits, 8, true>(task.pt, cell->vert, cell->n, t, &hitDist);
+                else if (task.grid->vsize == 16)
+                    hitIdx = pttri<TPtTriTraits, 16>(task.pt, cell->vert, cell->n, t, &hitDist);
+                else
+                    hitIdx = pttri<TPtTriTraits, 8>(task.pt, cell->vert, cell->n, t, &hitDist);
 
                 if (hitDist < task.bestDist) {
                     task.bestDist = hitDist;
-                    task.bestIdx = hitIdx;
+                    task.bestIdx = cell->idx[hitIdx];
                     memcpy(task.result, t, sizeof(float) * TPtTriTraits::ResultSize);
                 }
             }
@@ -152,14 +164,56 @@ namespace warpcore::impl
         }
     }
 
+    // Test the AoSoA block that holds triangle tri (and its neighbours in the block, which come
+    // for free). A good hit bounds the descent from the start and prunes most of the grid.
     template<typename TPtTriTraits>
-    __declspec(noalias) int trigrid_nn(const trigrid* grid, const float* pt, float clamp, float* proj)
+    void nn_seed(_nntask& task, int tri)
+    {
+        const int vsize = task.grid->vsize;
+
+        int slot = 0;
+        const trigrid_cell* cell = find_trigrid_triangle(task.grid, tri, slot);
+        if (cell == nullptr)
+            return;
+
+        const int base = slot & ~(vsize - 1);
+        const int n = std::min(vsize, cell->n - base);
+        task.ntested += n;
+        float hitDist = FLT_MAX;
+        float* t = task.buff;
+        int hitIdx;
+        if (task.grid->quant)
+            hitIdx = pttri<TPtTriTraits, 8, true>(task.pt, cell->vert + AOSOA_Q16_BLOCK * (base / 8), n, t, &hitDist);
+        else if (vsize == 16)
+            hitIdx = pttri<TPtTriTraits, 16>(task.pt, cell->vert + 9 * base, n, t, &hitDist);
+        else
+            hitIdx = pttri<TPtTriTraits, 8>(task.pt, cell->vert + 9 * base, n, t, &hitDist);
+
+        if (hitIdx >= 0 && hitDist < task.bestDist) {
+            task.bestDist = hitDist;
+            task.bestIdx = cell->idx[base + hitIdx];
+            memcpy(task.result, t, sizeof(float) * TPtTriTraits::ResultSize);
+        }
+    }
+
+    // Find the closest point to pt on the mesh, no further than clamp. If seed is a valid triangle
+    // index, the search is bounded by the distance to it (and its neighbours in storage) from the
+    // start. Queries ordered along the surface can pass the previous hit as the seed.
+    template<typename TPtTriTraits>
+    __declspec(noalias) int trigrid_nn(const trigrid* grid, const float* pt, float clamp, float* proj, int seed = -1)
     {
         static_assert(TPtTriTraits::ResultSize <= _nntask::MaxScratchpad);
         alignas(32) _nntask task{ grid, pt, clamp, proj };
         _nncell cell{ grid };
 
+        if (seed >= 0)
+            nn_seed<TPtTriTraits>(task, seed);
+
         nn_inner<TPtTriTraits>(task, cell);
+
+        if (grid->stats)
+            trigrid_stats_add(grid->stats, task.ncells, task.ntested, task.nculled, task.bestIdx < 0);
+
         return task.bestIdx;
     }
 };
\ No newline at end of file
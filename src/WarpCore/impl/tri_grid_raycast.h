@@ -2,15 +2,72 @@
 #include "../p3f.h"
 #include "search_impl.h"
 #include "tri_grid.h"
+#include <algorithm>
+#include <vector>
 
 namespace warpcore::impl
 {
+    struct trigrid_ray_hit {
+        float t, u, v;
+        int idx;
+    };
+
+    // Move the 3D-DDA state (cur, tmax) past the macro cell that contains cur. The ray is p0 + t*d. 
+    // Returns false if the ray cannot leave the macro cell.
+    inline bool WCORE_VECCALL leap_macro_cell(p3f p0, p3f d, p3i step, p3i& cur, p3f& tmax) noexcept
+    {
+        alignas(16) float p0s[4], ds[4], tm[4], te[3];
+        alignas(16) int ci[4], si[4];
+        _mm_store_ps(p0s, p0);
+        _mm_store_ps(ds, d);
+        _mm_store_si128((__m128i*)ci, cur);
+        _mm_store_si128((__m128i*)si, step);
+
+        // Parameter at which the ray exits the macro cell.
+        float texit = FLT_MAX;
+        for (int i = 0; i < 3; i++) {
+            te[i] = FLT_MAX;
+            if (fabsf(ds[i]) >= 1e-10f) {
+                const int b = (si[i] > 0) ? ((ci[i] | 3) + 1) : (ci[i] & ~3);
+                te[i] = ((float)b - p0s[i]) / ds[i];
+                texit = std::min(texit, te[i]);
+            }
+        }
+
+        if (texit == FLT_MAX)
+            return false;
+
+        // Step out of the macro cell along the exit axes. Along the others, the ray stays within
+        // the macro cell's extent, which is enforced in case of rounding trouble.
+        for (int i = 0; i < 3; i++) {
+            if (te[i] == texit) {
+                ci[i] = (si[i] > 0) ? ((ci[i] | 3) + 1) : ((ci[i] & ~3) - 1);
+            } else {
+                const int c = (int)floorf(p0s[i] + texit * ds[i]);
+                ci[i] = std::clamp(c, ci[i] & ~3, ci[i] | 3);
+            }
+
+            if (fabsf(ds[i]) >= 1e-10f)
+                tm[i] = ((float)((si[i] > 0) ? (ci[i] + 1) : ci[i]) - p0s[i]) / ds[i];
+            else
+                tm[i] = FLT_MAX;
+        }
+
+        ci[3] = 0;
+        tm[3] = FLT_MAX;
+        cur = _mm_load_si128((const __m128i*)ci);
+        tmax = _mm_load_ps(tm);
+        return true;
+    }
+
     // Traverse a regular grid of dimensions dim along the ray p0,p1. These coordinates are
     // in grid index dimensions. 3D-DDA algorithm is used. For each visited cell, fun is called.
     // If fun returns false at any cell, the traversal is stopped and this call returns true.
-    // If fun never signals termination by returning false, false is returned here.
+    // If fun never signals termination by returning false, false is returned here. If occ is
+    // given (macro cell masks, see get_macro_cell_idx), fun is called for occupied cells only
+    // and empty macro cells are crossed in one step.
     template<typename TCtx>
-    __declspec(noalias) bool WCORE_VECCALL traverse_3ddda(p3f p0, p3f p1, p3i dim, TCtx ctx, bool (*fun)(p3i pt, TCtx ctx))
+    __declspec(noalias) bool WCORE_VECCALL traverse_3ddda(p3f p0, p3f p1, p3i dim, TCtx ctx, bool (*fun)(p3i pt, TCtx ctx), const uint64_t* occ = nullptr)
     {
         p3i dimm1 = _mm_sub_epi32(dim, p3i_set(1));
         p3f d = p3f_sub(p1, p0);
@@ -26,11 +83,43 @@ namespace warpcore::impl
         p3f tmax = p3f_switch(frac1, frac0, _mm_castsi128_ps(step)); // step == -1 => frac0, else => frac0
         tmax = p3f_mul(tmax, delta);
 
+        alignas(16) int mdim[4];
+        _mm_store_si128((__m128i*)mdim, _mm_srai_epi32(_mm_add_epi32(dim, p3i_set(3)), 2));
+
         p3i cur = p3f_to_p3i(p0);
-        if (!fun(p3i_clamp(cur, _mm_setzero_si128(), dimm1), ctx))
-            return true;
+        p3i c = p3i_clamp(cur, _mm_setzero_si128(), dimm1);
+
+        // A start on the far face of the grid (or, after rounding, just outside the near one) is clamped
+        // into the adjacent cell, which the first step would then enter (and visit) again. Take that
+        // step right away along such axes.
+        const p3i enter = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(cur, c), _mm_castps_si128(dzero)),
+            _mm_and_si128(_mm_cmpeq_epi32(_mm_add_epi32(cur, step), c), p3i_set(-1)));
+        tmax = p3f_add(tmax, _mm_and_ps(delta, _mm_castsi128_ps(enter)));
+        cur = _mm_blendv_epi8(cur, c, enter);
 
         for (;;) {
+            bool visit = true;
+            if (occ) {
+                const int cx = _mm_extract_epi32(c, 0);
+                const int cy = _mm_extract_epi32(c, 1);
+                const int cz = _mm_extract_epi32(c, 2);
+                const uint64_t mask = occ[get_macro_cell_idx(mdim, cx, cy, cz)];
+
+                if (mask == 0) {
+                    cur = c;
+                    if (!leap_macro_cell(p0, d, step, cur, tmax) || !p3i_in_aabb(cur, _mm_setzero_si128(), dim))
+                        break;
+
+                    c = cur;
+                    continue;
+                }
+
+                visit = (mask >> get_macro_cell_bit(cx, cy, cz)) & 1;
+            }
+
+            if (visit && !fun(c, ctx))
+                return true;
+
             p3f min_mask = p3f_min_mask_full(tmax);
             if (p3i_is_zero(_mm_castps_si128(min_mask)))
                 break;
@@ -41,16 +130,17 @@ namespace warpcore::impl
             if (!p3i_in_aabb(cur, _mm_setzero_si128(), dim))
                 break;
 
-            if (!fun(cur, ctx))
-                return true;
+            c = cur;
         }
 
         return false;
-
     }
 
+    // Cast a ray from orig along dir and return the index of the first triangle hit, or -1 if 
+    // there is none. Hits with ray parameter greater than max_t are rejected, although t may be
+    // overwritten in that case.
     template<typename TRayTriTraits>
-    __declspec(noalias) int trigrid_raycast(const trigrid* grid, const float* orig, const float* dir, float* t)
+    __declspec(noalias) int trigrid_raycast(const trigrid* grid, const float* orig, const float* dir, float* t, float max_t = FLT_MAX)
     {
         using namespace warpcore;
 
@@ -60,6 +150,7 @@ namespace warpcore::impl
             p3f o, d;
             int idx;
             float* t;
+            int ncells;
             int ntested;
             float toffs;
         };
@@ -71,14 +162,25 @@ namespace warpcore::impl
         const p3f gridd = p3f_set(grid->dx);
 
         float aabbt0 = 0.0f, aabbt1 = 0.0f;
-        if (!intersect_ray_aabb(o, d, grid0, grid1, aabbt0, aabbt1))
+        if (!intersect_ray_aabb(o, d, grid0, grid1, aabbt0, aabbt1) || aabbt0 > max_t) {
+            if (grid->stats)
+                trigrid_stats_add(grid->stats, 0, 0, 1, false);
+
             return -1; // no intersection
+        }
+
+        // Stop the traversal at max_t, cells further away cannot contain an acceptable hit.
+        if (aabbt1 > max_t)
+            aabbt1 = max_t;
 
         p3f e = p3f_fma(aabbt1, d, o);
         if (aabbt0 > 0)
             o = p3f_fma(aabbt0, d, o);
 
-        raycast_ctx ctx{ .g = grid, .o = o, .d = d, .idx = -1, .t = t, .ntested = 0, .toffs = aabbt0 };
+        raycast_ctx ctx{ .g = grid, .o = o, .d = d, .idx = -1, .t = t, .ncells = 0, .ntested = 0, .toffs = aabbt0 };
+
+        // On coarse grids, there is too little empty space to skip to pay for the bookkeeping.
+        const uint64_t* occ = (grid->ncell[0] >= 32) ? grid->occupancy : nullptr;
 
         traverse_3ddda<raycast_ctx&>(
             p3f_mul(p3f_sub(o, grid0), gridd),
@@ -92,13 +194,20 @@ namespace warpcore::impl
                                 
                 _mm_prefetch((const char*)cell->vert, _MM_HINT_T0);
 
+                ctx.ncells++;
                 int ne = cell->n;
                 if (ne == 0)
                     return true; // continue along the ray, this cell is just empty
 
-                //ctx.ntested += ne;
+                ctx.ntested += ne;
 
-                int collision = raytri<TRayTriTraits>(ctx.o, ctx.d, cell->vert, ne, ctx.t);
+                int collision;
+                if (ctx.g->quant)
+                    collision = raytri<TRayTriTraits, 8, true>(ctx.o, ctx.d, cell->vert, ne, ctx.t);
+                else if (ctx.g->vsize == 16)
+                    collision = raytri<TRayTriTraits, 16>(ctx.o, ctx.d, cell->vert, ne, ctx.t);
+                else
+                    collision = raytri<TRayTriTraits, 8>(ctx.o, ctx.d, cell->vert, ne, ctx.t);
                 if (collision >= 0) {
                     ctx.idx = cell->idx[collision];
                     ctx.t[0] += ctx.toffs;
@@ -106,8 +215,125 @@ namespace warpcore::impl
                 }
 
                 return true;
-            });
+            }, occ);
+
+        if (ctx.idx >= 0 && t[0] > max_t)
+            ctx.idx = -1;
+
+        if (grid->stats)
+            trigrid_stats_add(grid->stats, ctx.ncells, ctx.ntested, 0, ctx.idx < 0);
 
         return ctx.idx;
     }
+
+    // Cast a ray from orig along dir and collect the hits no further than max_t in hits, sorted by 
+    // increasing t. If k is positive, only the first k hits are kept and the traversal stops as soon
+    // as no closer hits can follow. Returns the number of hits.
+    inline int trigrid_raycast_all(const trigrid* grid, const float* orig, const float* dir, float max_t, int k, std::vector<trigrid_ray_hit>& hits)
+    {
+        using namespace warpcore;
+
+        struct raycast_all_ctx
+        {
+            const trigrid* g;
+            p3f o, d;
+            p3f g0, cs;
+            float toffs, max_t;
+            int k;
+            int ncells, ntested;
+            std::vector<trigrid_ray_hit>* hits;
+            std::vector<int> idx;
+            std::vector<float> tuv;
+        };
+
+        hits.clear();
+
+        p3f o = p3f_set(orig);
+        const p3f d = p3f_set(dir);
+        const p3f grid0 = p3f_set(grid->x0);
+        const p3f grid1 = p3f_set(grid->x1);
+        const p3f gridd = p3f_set(grid->dx);
+
+        float aabbt0 = 0.0f, aabbt1 = 0.0f;
+        if (!intersect_ray_aabb(o, d, grid0, grid1, aabbt0, aabbt1) || aabbt0 > max_t) {
+            if (grid->stats)
+                trigrid_stats_add(grid->stats, 0, 0, 1, false);
+
+            return 0;
+        }
+
+        if (aabbt1 > max_t)
+            aabbt1 = max_t;
+
+        p3f e = p3f_fma(aabbt1, d, o);
+        if (aabbt0 > 0)
+            o = p3f_fma(aabbt0, d, o);
+
+        raycast_all_ctx ctx{ .g = grid, .o = o, .d = d, .g0 = grid0, .cs = p3f_set(p3f_recip(gridd)),
+            .toffs = aabbt0, .max_t = max_t, .k = k, .ncells = 0, .ntested = 0, .hits = &hits };
+
+        const uint64_t* occ = (grid->ncell[0] >= 32) ? grid->occupancy : nullptr;
+
+        traverse_3ddda<raycast_all_ctx&>(
+            p3f_mul(p3f_sub(o, grid0), gridd),
+            p3f_mul(p3f_sub(e, grid0), gridd),
+            p3i_set(grid->ncell),
+            ctx,
+            [](p3i c, raycast_all_ctx& ctx) -> bool {
+                std::vector<trigrid_ray_hit>& hits = *ctx.hits;
+
+                // Cells are visited in the order of their entry along the ray. Once the entry is
+                // beyond the k-th hit, nothing closer can follow.
+                if (ctx.k > 0 && (int)hits.size() >= ctx.k) {
+                    const p3f fc = p3i_to_p3f(c);
+                    const p3f box0 = p3f_fma(ctx.cs, fc, ctx.g0);
+                    const p3f box1 = p3f_add(box0, ctx.cs);
+                    float t0 = 0.0f, t1 = 0.0f;
+                    if (intersect_ray_aabb(ctx.o, ctx.d, box0, box1, t0, t1) && t0 + ctx.toffs > hits[ctx.k - 1].t)
+                        return false;
+                }
+
+                alignas(16) int ci[4];
+                _mm_store_si128((__m128i*)ci, c);
+                const trigrid_cell* cell = get_trigrid_cell(ctx.g, ci[0], ci[1], ci[2]);
+
+                ctx.ncells++;
+                const int ne = cell->n;
+                if (ne == 0)
+                    return true;
+
+                ctx.ntested += ne;
+                if ((int)ctx.idx.size() < ne) {
+                    ctx.idx.resize(ne);
+                    ctx.tuv.resize(3 * ne);
+                }
+
+                const int nh = ctx.g->quant ?
+                    _raytri_all_q16(ctx.o, ctx.d, cell->vert, ne, ctx.idx.data(), ctx.tuv.data()) :
+                    _raytri_all(ctx.o, ctx.d, cell->vert, ne, ctx.g->vsize, ctx.idx.data(), ctx.tuv.data());
+                for (int i = 0; i < nh; i++) {
+                    const trigrid_ray_hit h{ ctx.tuv[3 * i] + ctx.toffs, ctx.tuv[3 * i + 1], ctx.tuv[3 * i + 2], cell->idx[ctx.idx[i]] };
+                    if (h.t > ctx.max_t)
+                        continue;
+
+                    // Triangles that span several cells are found in each of them.
+                    if (std::any_of(hits.begin(), hits.end(), [&h](const trigrid_ray_hit& x) { return x.idx == h.idx; }))
+                        continue;
+
+                    auto pos = std::upper_bound(hits.begin(), hits.end(), h, 
+                        [](const trigrid_ray_hit& a, const trigrid_ray_hit& b) { return a.t < b.t; });
+                    hits.insert(pos, h);
+
+                    if (ctx.k > 0 && (int)hits.size() > ctx.k)
+                        hits.pop_back();
+                }
+
+                return true;
+            }, occ);
+
+        if (grid->stats)
+            trigrid_stats_add(grid->stats, ctx.ncells, ctx.ntested, 0, hits.empty());
+
+        return (int)hits.size();
+    }
 };
\ No newline at end of file
@@ -36,6 +36,19 @@ namespace warpcore::impl
 	bool is_power_of_two(size_t x);
     float cumsum(const float* x, int n, float* sums);
 
+    // Bits of an allow mask (as in FOR_MASKED) for the count < 32 points starting at i, which must not
+    // cross a 32-bit word boundary. All bits are set if allow is null.
+    inline uint32_t allow_bits(const void* allow, int i, int count) noexcept
+    {
+        const uint32_t sel = (1u << count) - 1;
+        return allow ? ((((const uint32_t*)allow)[i >> 5] >> (i & 31)) & sel) : sel;
+    }
+
+    inline bool is_allowed(const void* allow, int i) noexcept
+    {
+        return allow_bits(allow, i, 1) != 0;
+    }
+
     // Find the first lane i in d that contains min(d). Then bestDist=d[i], bestIdx=idx[i], return i.
     int WCORE_VECCALL reduce_idxmin(const __m256 d, const __m256i idx, float& bestDist, int& bestIdx);   
  
@@ -277,6 +277,46 @@ namespace warpcore::impl
         c = cx;
     }
 
+    void WCORE_VECCALL demux(__m512& a, __m512& b, __m512& c)
+    {
+        // Lanes that come from the first 32 elements are permuted from (a, b), the rest from c.
+        __m512 ax = _mm512_permutex2var_ps(a, _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 0, 0, 0, 0, 0), b);
+        __m512 bx = _mm512_permutex2var_ps(a, _mm512_setr_epi32(1, 4, 7, 10, 13, 16, 19, 22, 25, 28, 31, 0, 0, 0, 0, 0), b);
+        __m512 cx = _mm512_permutex2var_ps(a, _mm512_setr_epi32(2, 5, 8, 11, 14, 17, 20, 23, 26, 29, 0, 0, 0, 0, 0, 0), b);
+        ax = _mm512_mask_permutexvar_ps(ax, 0xf800, _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 4, 7, 10, 13), c);
+        bx = _mm512_mask_permutexvar_ps(bx, 0xf800, _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 5, 8, 11, 14), c);
+        cx = _mm512_mask_permutexvar_ps(cx, 0xfc00, _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 6, 9, 12, 15), c);
+        a = ax;
+        b = bx;
+        c = cx;
+    }
+
+    void WCORE_VECCALL mux(__m256& a, __m256& b, __m256& c)
+    {
+        // Each permutation puts every element where one of the outputs needs it, the outputs then
+        // only blend.
+        __m256 xp = _mm256_permutevar8x32_ps(a, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+        __m256 yp = _mm256_permutevar8x32_ps(b, _mm256_setr_epi32(5, 0, 3, 6, 1, 4, 7, 2));
+        __m256 zp = _mm256_permutevar8x32_ps(c, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+        a = _mm256_blend_ps(_mm256_blend_ps(xp, yp, 0b10010010), zp, 0b00100100);
+        b = _mm256_blend_ps(_mm256_blend_ps(xp, yp, 0b00100100), zp, 0b01001001);
+        c = _mm256_blend_ps(_mm256_blend_ps(xp, yp, 0b01001001), zp, 0b10010010);
+    }
+
+    void WCORE_VECCALL mux(__m512& a, __m512& b, __m512& c)
+    {
+        // x and y lanes are permuted from (a, b), z lanes from c.
+        __m512 ax = _mm512_permutex2var_ps(a, _mm512_setr_epi32(0, 16, 0, 1, 17, 0, 2, 18, 0, 3, 19, 0, 4, 20, 0, 5), b);
+        __m512 bx = _mm512_permutex2var_ps(a, _mm512_setr_epi32(21, 0, 6, 22, 0, 7, 23, 0, 8, 24, 0, 9, 25, 0, 10, 26), b);
+        __m512 cx = _mm512_permutex2var_ps(a, _mm512_setr_epi32(0, 11, 27, 0, 12, 28, 0, 13, 29, 0, 14, 30, 0, 15, 31, 0), b);
+        ax = _mm512_mask_permutexvar_ps(ax, 0x4924, _mm512_setr_epi32(0, 0, 0, 0, 0, 1, 0, 0, 2, 0, 0, 3, 0, 0, 4, 0), c);
+        bx = _mm512_mask_permutexvar_ps(bx, 0x2492, _mm512_setr_epi32(0, 5, 0, 0, 6, 0, 0, 7, 0, 0, 8, 0, 0, 9, 0, 0), c);
+        cx = _mm512_mask_permutexvar_ps(cx, 0x9249, _mm512_setr_epi32(10, 0, 0, 11, 0, 0, 12, 0, 0, 13, 0, 0, 14, 0, 0, 15), c);
+        a = ax;
+        b = bx;
+        c = cx;
+    }
+
     void WCORE_VECCALL cross(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz, __m256& cx, __m256& cy, __m256& cz) noexcept
     {
         cx = _mm256_fmsub_ps(ay, bz, _mm256_mul_ps(az, by));
@@ -294,6 +334,12 @@ namespace warpcore::impl
                 _mm256_mul_ps(az, bz)));
     }
 
+    __m256 WCORE_VECCALL mask_from_bits(uint32_t bits) noexcept
+    {
+        const __m256i sel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)bits), sel), sel));
+    }
+
     __m256 WCORE_VECCALL mask_positive(__m256 x) noexcept
     {
         // Extend sign bit across the lane.
@@ -27,6 +27,11 @@ namespace warpcore::impl
     // of AoSoA data a=(x0..x7), b=(y0..y7), c=(z0..z7).
     void WCORE_VECCALL demux(__m256& a, __m256& b, __m256& c);
     void WCORE_VECCALL demux(__m256i& a, __m256i& b, __m256i& c);
+    void WCORE_VECCALL demux(__m512& a, __m512& b, __m512& c);
+
+    // Inverse of demux, (a,b,c)=(x0..x7),(y0..y7),(z0..z7) becomes (x0,y0,z0,x1,y1...z7).
+    void WCORE_VECCALL mux(__m256& a, __m256& b, __m256& c);
+    void WCORE_VECCALL mux(__m512& a, __m512& b, __m512& c);
 
     // Calculate vertical cross products a x b -> c.
     void WCORE_VECCALL cross(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz, __m256& cx, __m256& cy, __m256& cz) noexcept;
@@ -90,6 +95,9 @@ namespace warpcore::impl
     // precision accumulator.
     double dot2(const float* x, const float* y, int n);
 
+    // Create a mask vector where 0xffffffff marks the lanes whose bits are set in the low byte of bits.
+    __m256 WCORE_VECCALL mask_from_bits(uint32_t bits) noexcept;
+
     // Create a mask vector where 0xffffffff marks positive lanes of x and 0x0 the remaining ones.
     __m256 WCORE_VECCALL mask_positive(__m256 x) noexcept;
 
@@ -1,12 +1,16 @@
 #include "pca.h"
 #include "impl/pca_impl.h"
+#include "impl/file_io.h"
+#include <algorithm>
+#include <cstring>
 
 
 using namespace warpcore::impl;
 
 extern "C" WCEXPORT int pca_fit(pcainfo* pca, const void** data, const void* allow, void* mean_pcs, void* var)
 {
-	// mean_pcs holds the mean and the principal components - dimension is (1 + n) * m, no padding
+	// mean_pcs holds the mean and the principal components - dimension is (1 + npcs) * m, no padding.
+	// Only the eigenpairs for the npcs largest eigenvalues are computed, so npcs < n is cheaper.
 	// allow is a bitfield - **bits** predicate rows of data. This can be nullpts, in which case it is assumed that all rows are enabled.
 	// var holds the proportion of explained variance and can be nullptr to forgo calculating it.
 	if (pca == NULL || data == NULL || mean_pcs == NULL)
@@ -37,26 +41,123 @@ extern "C" WCEXPORT int pca_fit(pcainfo* pca, const void** data, const void* all
 	return WCORE_OK;
 }
 
+extern "C" WCEXPORT int pca_fit_stream(pcainfo* pca, pca_read_rows read, void* user, const void* allow, int64_t max_memory, void* mean_pcs, void* var)
+{
+	// As pca_fit, but the specimens are never held in memory at once. read is called for panels of rows 
+	// of all specimens: once over all rows for the mean, once over the allowed rows for the Gram matrix and 
+	// once more over all rows for the principal components. The panels take at most max_memory bytes 
+	// (256MB if it is not positive) but never less than one row, the n x n Gram matrix comes on top of that.
+	// allow can be null, in which case all rows are enabled. Returns WCORE_INVALID_DATA if read fails.
+	if (pca == NULL || read == NULL || mean_pcs == NULL || pca->n < 2 || pca->m < 1)
+		return WCORE_INVALID_ARGUMENT;
+
+	const int n = pca->n;
+	const int m = pca->m;
+	const int64_t budget = (max_memory > 0) ? max_memory : (int64_t)sizeof(float) << 26;
+	const int chunk = (int)std::clamp<int64_t>(budget / ((int64_t)sizeof(float) * n), 1, m);
+
+	float* panel = new float[(size_t)chunk * n];
+	float* cov = new float[(size_t)n * n];
+	float* mean = (float*)mean_pcs;
+	float* pcs = mean + m;
+
+	int ret = WCORE_INVALID_DATA;
+	if (pca_mean_stream(read, user, n, m, chunk, panel, mean) &&
+		pca_covmat_stream(read, user, mean, allow, n, m, chunk, panel, cov)) {
+
+		if (pca->flags & PCA_SCALE_TO_UNITY) {
+			pca_cov_to_cor(cov, n);
+		}
+
+		// cov is destroyed after this call
+		if (pca_make_pcs_stream(read, user, mean, cov, n, m, pca->npcs, chunk, panel, (float*)var, pcs))
+			ret = WCORE_OK;
+	}
+
+	delete[] cov;
+	delete[] panel;
+
+	return ret;
+}
+
+struct pca_file_source {
+	const float* data;
+	int n, m;
+};
+
+static int pca_read_file_rows(void* user, int r0, int r1, float* dest)
+{
+	const pca_file_source* src = (const pca_file_source*)user;
+	const int mc = r1 - r0;
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (int i = 0; i < src->n; i++)
+		memcpy(dest + (size_t)i * mc, src->data + (size_t)i * src->m + r0, sizeof(float) * mc);
+
+	return 0;
+}
+
+extern "C" WCEXPORT int pca_fit_file(pcainfo* pca, const char* path, int64_t offset, const void* allow, int64_t max_memory, void* mean_pcs, void* var)
+{
+	// pca_fit_stream over a file that holds the n specimens of m floats each one after another, starting 
+	// offset bytes into the file. The file is mapped read-only, so the pages it occupies can be evicted as 
+	// the panels move on. offset must be a multiple of 4 and path is UTF-8.
+	if (pca == NULL || path == NULL || offset < 0 || (offset & 3) != 0)
+		return WCORE_INVALID_ARGUMENT;
+
+	mapped_file mf;
+	if (!mapped_file_open(&mf, path))
+		return WCORE_IO_ERROR;
+
+	int ret = WCORE_INVALID_DATA;
+	if (mf.size - offset >= (int64_t)sizeof(float) * pca->n * pca->m) {
+		pca_file_source src{ (const float*)((const char*)mf.view + offset), pca->n, pca->m };
+		ret = pca_fit_stream(pca, pca_read_file_rows, &src, allow, max_memory, mean_pcs, var);
+	}
+
+	mapped_file_close(&mf);
+	return ret;
+}
+
 extern "C" WCEXPORT int pca_data_to_scores(pcainfo* pca, const void* data, const void* pcs, const void* allow, void* scores)
 {
-	if (pca == NULL || data == NULL || pcs == NULL || scores == NULL)
+	return pca_data_to_scores_batch(pca, &data, 1, pcs, allow, scores);
+}
+
+extern "C" WCEXPORT int pca_data_to_scores_batch(pcainfo* pca, const void** data, int count, const void* pcs, const void* allow, void* scores)
+{
+	// scores holds npcs scores for each of the count specimens in data, one specimen after another.
+	// allow can be null, in which case all rows are enabled.
+	if (pca == NULL || data == NULL || pcs == NULL || scores == NULL || count < 0)
 		return WCORE_INVALID_ARGUMENT;
 
+	if (count == 0)
+		return WCORE_OK;
+
 	int m = pca->m;
-	int n = pca->n;
-	pca_make_scores((const float*)data, (const float*)pcs, (const float*)pcs + m, allow, n, m, (float*)scores);
+	int npcs = std::min(pca->npcs, pca->n);
+	pca_make_scores((const float**)data, (const float*)pcs, (const float*)pcs + m, allow, count, npcs, m, (float*)scores);
 
 	return WCORE_OK;
 }
 
 extern "C" WCEXPORT int pca_scores_to_data(pcainfo* pca, const void* scores, const void* pcs, void* data)
 {
-	if (pca == NULL || data == NULL || pcs == NULL || scores == NULL)
+	return pca_scores_to_data_batch(pca, scores, 1, pcs, data);
+}
+
+extern "C" WCEXPORT int pca_scores_to_data_batch(pcainfo* pca, const void* scores, int count, const void* pcs, void* data)
+{
+	// scores holds npcs scores for each specimen, data receives count specimens of m floats one after another.
+	if (pca == NULL || data == NULL || pcs == NULL || scores == NULL || count < 0)
 		return WCORE_INVALID_ARGUMENT;
 
+	if (count == 0)
+		return WCORE_OK;
+
 	int m = pca->m;
-	int n = pca->n;
-	pca_predict((const float*)scores, (const float*)pcs, (const float*)pcs + m, n, m, (float*)data);
+	int npcs = std::min(pca->npcs, pca->n);
+	pca_predict((const float*)scores, (const float*)pcs, (const float*)pcs + m, count, npcs, m, (float*)data);
 
 	return WCORE_OK;
 }
\ No newline at end of file
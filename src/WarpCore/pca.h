@@ -11,6 +11,13 @@ struct pcainfo {
 	int32_t n, m, npcs, flags;
 };
 
+// Supplies rows r0..r1-1 of all n specimens, dest[i * (r1 - r0) + r - r0] = x_i[r]. Anything but zero aborts.
+typedef int (*pca_read_rows)(void* user, int r0, int r1, float* dest);
+
 extern "C" WCEXPORT int pca_fit(pcainfo* pca, const void** data, const void* allow, void* pcs, void* var);
+extern "C" WCEXPORT int pca_fit_stream(pcainfo* pca, pca_read_rows read, void* user, const void* allow, int64_t max_memory, void* pcs, void* var);
+extern "C" WCEXPORT int pca_fit_file(pcainfo* pca, const char* path, int64_t offset, const void* allow, int64_t max_memory, void* pcs, void* var);
 extern "C" WCEXPORT int pca_data_to_scores(pcainfo* pca, const void* data, const void* pcs, const void* allow, void* scores);
-extern "C" WCEXPORT int pca_scores_to_data(pcainfo* pca, const void* scores, const void* pcs, void* data);
\ No newline at end of file
+extern "C" WCEXPORT int pca_scores_to_data(pcainfo* pca, const void* scores, const void* pcs, void* data);
+extern "C" WCEXPORT int pca_data_to_scores_batch(pcainfo* pca, const void** data, int count, const void* pcs, const void* allow, void* scores);
+extern "C" WCEXPORT int pca_scores_to_data_batch(pcainfo* pca, const void* scores, int count, const void* pcs, void* data);
\ No newline at end of file
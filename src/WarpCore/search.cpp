@@ -1,9 +1,12 @@
 #include "search.h"
 #include "impl/tri_grid_nn.h"
 #include "impl/tri_grid_raycast.h"
+#include "impl/kd_tree.h"
+#include "impl/dist_field.h"
 #include "impl/vec_math.h"
 #include "impl/utils.h"
 #include "impl/search_impl.h"
+#include "impl/file_io.h"
 #include "p3f.h"
 #include <float.h>
 #include <math.h>
@@ -18,23 +21,220 @@ struct query_info {
     int* hit;
     void* info;
     bool invert_dir;
+    bool bidir;
 };
 
+// Cast a ray from orig along dir (and also against dir if bidir is set) and take the closest hit
+// no further than cfg->max_ray_dist. Without such a hit, find the nearest point on the mesh instead.
+// The result is laid out as for PtTri_DPtBary: {d, x, y, z, u, v, w, src}, where w = 1 - u - v and src
+// is 1 for ray hits and 0 for nearest point fallbacks. Without any hit, res is left unmodified.
+static int raycast_nn_fallback(const trigrid* g, const float* orig, const float* dir, bool bidir, const search_query_config* cfg, float* res)
+{
+    const float len = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+    const float max_t = (cfg->max_ray_dist > 0 && len > 0) ? cfg->max_ray_dist / len : FLT_MAX;
+
+    float tb[4];
+    float s = 1.0f;
+    int hit = trigrid_raycast<RayTri_TBary>(g, orig, dir, tb, max_t);
+
+    if (bidir) {
+        // The opposite direction only needs to be traversed up to the hit we already have.
+        float tbb[4];
+        float dd[3]{ -dir[0], -dir[1], -dir[2] };
+        int hitb = trigrid_raycast<RayTri_TBary>(g, orig, dd, tbb, hit >= 0 ? tb[0] : max_t);
+        if (hitb >= 0 && (hit < 0 || tbb[0] < tb[0])) {
+            hit = hitb;
+            s = -1.0f;
+            memcpy(tb, tbb, sizeof(tb));
+        }
+    }
+
+    if (hit >= 0) {
+        const float st = s * tb[0];
+        res[0] = tb[0] * len;
+        res[1] = orig[0] + st * dir[0];
+        res[2] = orig[1] + st * dir[1];
+        res[3] = orig[2] + st * dir[2];
+        res[4] = tb[1];
+        res[5] = tb[2];
+        res[6] = tb[3];
+        res[7] = 1.0f;
+        return hit;
+    }
+
+    // PtTri_DPtBary leaves the last two elements undefined.
+    hit = trigrid_nn<PtTri_DPtBary>(g, orig, cfg->max_dist, res);
+    if (hit >= 0) {
+        res[6] = 1.0f - res[4] - res[5];
+        res[7] = 0.0f;
+    }
+
+    return hit;
+}
+
+// Find the k nearest points for each query. Missing neighbours (fewer than k points within
+// cfg->max_dist) are marked with -1.
+static int kdtree_query_knn(const kdtree* t, const search_query_config* cfg, const float* orig, int n, int* hit, float* dist)
+{
+    const int k = cfg->k;
+    if (k <= 0)
+        return WCORE_INVALID_ARGUMENT;
+
+    #pragma omp parallel
+    {
+        kdtree_hit* hits = new kdtree_hit[k];
+
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < n; i++) {
+            const int nh = kdtree_knn(t, orig + 3 * i, k, cfg->max_dist, hits);
+            for (int j = 0; j < k; j++) {
+                hit[(int64_t)k * i + j] = (j < nh) ? hits[j].idx : -1;
+                if (dist)
+                    dist[(int64_t)k * i + j] = (j < nh) ? sqrtf(hits[j].d2) : FLT_MAX;
+            }
+        }
+
+        delete[] hits;
+    }
+
+    return WCORE_OK;
+}
+
+// Find all points within cfg->max_dist of each query and pack them as CSR. Without nbr, only
+// the row offsets are made in offs[0..n]. The caller then allocates nbr to offs[n] elements and
+// calls again with the same offsets to get the neighbour indices, sorted by distance.
+static int kdtree_query_radius(const kdtree* t, const search_query_config* cfg, const float* orig, int n, int* offs, int* nbr)
+{
+    const float r = cfg->max_dist;
+
+    if (!nbr) {
+        offs[0] = 0;
+
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int i = 0; i < n; i++)
+            offs[i + 1] = kdtree_radius_count(t, orig + 3 * i, r);
+
+        for (int i = 0; i < n; i++)
+            offs[i + 1] += offs[i];
+
+        return WCORE_OK;
+    }
+
+    #pragma omp parallel
+    {
+        std::vector<kdtree_hit> hits;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (int i = 0; i < n; i++) {
+            const int nh = kdtree_radius(t, orig + 3 * i, r, hits);
+            const int nr = std::min(nh, offs[i + 1] - offs[i]);
+            for (int j = 0; j < nr; j++)
+                nbr[offs[i] + j] = hits[j].idx;
+        }
+    }
+
+    return WCORE_OK;
+}
+
+// Cast rays and pack up to cfg->k hits per ray no further than cfg->max_ray_dist as CSR, sorted by
+// distance. The two-call protocol is the same as in kdtree_query_radius. Hit distances are in
+// multiples of dir, as in the other raycasts.
+static int trigrid_query_raycast_multi(const trigrid* g, const search_query_config* cfg, const float* orig, const float* dir, bool invert_dir, int n, int* offs, search_ray_hit* res)
+{
+    #pragma omp parallel
+    {
+        std::vector<trigrid_ray_hit> hits;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < n; i++) {
+            const float s = invert_dir ? -1.0f : 1.0f;
+            const float dd[3]{ s * dir[3 * i], s * dir[3 * i + 1], s * dir[3 * i + 2] };
+            const float len = sqrtf(dd[0] * dd[0] + dd[1] * dd[1] + dd[2] * dd[2]);
+            const float max_t = (cfg->max_ray_dist > 0 && len > 0) ? cfg->max_ray_dist / len : FLT_MAX;
+            const int nh = trigrid_raycast_all(g, orig + 3 * i, dd, max_t, cfg->k, hits);
+
+            if (!res) {
+                offs[i + 1] = nh;
+            } else {
+                const int nr = std::min(nh, offs[i + 1] - offs[i]);
+                for (int j = 0; j < nr; j++)
+                    res[offs[i] + j] = { hits[j].idx, hits[j].t, hits[j].u, hits[j].v };
+            }
+        }
+    }
+
+    if (!res) {
+        offs[0] = 0;
+        for (int i = 0; i < n; i++)
+            offs[i + 1] += offs[i];
+    }
+
+    return WCORE_OK;
+}
+
 extern "C" int search_build(int structure, const float* vert, const int* idx, int nv, int nt, const void* config, void** ctx)
 {
     if(structure == SEARCH_TRIGRID3) {
+        if (!idx)
+            return WCORE_INVALID_ARGUMENT;
+
         const trigrid_config* cfg = (const trigrid_config*)config;
         int num_cells = (cfg && cfg->num_cells > 0) ? cfg->num_cells : 16;
         trigrid* g = new trigrid;
         g->__magic = SEARCH_TRIGRID3;
         *ctx = g;
-        trigrid_build(g, vert, idx, nv, nt, num_cells);
+        trigrid_build(g, vert, idx, nv, nt, num_cells, cfg && (cfg->flags & TRIGRID_QUANTIZED));
+        return WCORE_OK;
+    } else if (structure == SEARCH_PCL_KDTREE) {
+        if (!vert || nv < 1)
+            return WCORE_INVALID_ARGUMENT;
+
+        const kdtree_config* cfg = (const kdtree_config*)config;
+        int leaf_size = (cfg && cfg->leaf_size > 0) ? cfg->leaf_size : 16;
+        kdtree* t = new kdtree;
+        t->__magic = SEARCH_PCL_KDTREE;
+        *ctx = t;
+        kdtree_build(t, vert, nv, leaf_size);
+        return WCORE_OK;
+    } else if (structure == SEARCH_TRIGRID3_DISTFIELD) {
+        if (!idx || nv < 1)
+            return WCORE_INVALID_ARGUMENT;
+
+        const distfield_config* cfg = (const distfield_config*)config;
+        distfield* df = new distfield;
+        df->__magic = SEARCH_TRIGRID3_DISTFIELD;
+        if (!distfield_build(df, vert, idx, nv, nt,
+            cfg ? cfg->voxel_size : 0,
+            cfg ? cfg->band : 0,
+            cfg && (cfg->flags & DISTFIELD_STORE_TRIANGLES),
+            cfg ? cfg->max_memory : 0)) {
+            distfield_destroy(df);
+            delete df;
+            return WCORE_INVALID_ARGUMENT;
+        }
+
+        *ctx = df;
         return WCORE_OK;
     }
      
     return WCORE_INVALID_ARGUMENT;
 }
 
+extern "C" int search_refit(void* ctx, const float* vert)
+{
+    if (!ctx || !vert)
+        return WCORE_INVALID_ARGUMENT;
+
+    int structure = *(const int*)ctx;
+    if (structure == SEARCH_TRIGRID3) {
+        // Falls back to a full rebuild if the mesh has left the grid's AABB.
+        trigrid_refit((trigrid*)ctx, vert);
+        return WCORE_OK;
+    }
+
+    return WCORE_INVALID_ARGUMENT;
+}
+
 extern "C" int search_free(void* ctx)
 {
     int structure = *(const int*)ctx;
@@ -42,6 +242,69 @@ extern "C" int search_free(void* ctx)
         trigrid_destroy((trigrid*)ctx);
         delete (trigrid*)ctx;
         return WCORE_OK;
+    } else if (structure == SEARCH_PCL_KDTREE) {
+        kdtree_destroy((kdtree*)ctx);
+        delete (kdtree*)ctx;
+        return WCORE_OK;
+    } else if (structure == SEARCH_TRIGRID3_DISTFIELD) {
+        distfield_destroy((distfield*)ctx);
+        delete (distfield*)ctx;
+        return WCORE_OK;
+    }
+
+    return WCORE_INVALID_ARGUMENT;
+}
+
+extern "C" int search_save(const void* ctx, const char* path)
+{
+    if (!ctx || !path)
+        return WCORE_INVALID_ARGUMENT;
+
+    int structure = *(const int*)ctx;
+    if (structure == SEARCH_TRIGRID3) {
+        if (!trigrid_save((const trigrid*)ctx, path))
+            return WCORE_IO_ERROR;
+
+        return WCORE_OK;
+    }
+
+    return WCORE_INVALID_ARGUMENT;
+}
+
+extern "C" int search_load(const char* path, void** ctx)
+{
+    if (!path || !ctx)
+        return WCORE_INVALID_ARGUMENT;
+
+    mapped_file* mf = new mapped_file;
+    if (!mapped_file_open(mf, path)) {
+        delete mf;
+        return WCORE_IO_ERROR;
+    }
+
+    // The loaded structure shares the mapped view. Closing the context unmaps it.
+    trigrid* g = new trigrid;
+    g->__magic = SEARCH_TRIGRID3;
+    if (!trigrid_load(g, mf)) {
+        mapped_file_close(mf);
+        delete mf;
+        delete g;
+        return WCORE_INVALID_DATA;
+    }
+
+    *ctx = g;
+    return WCORE_OK;
+}
+
+extern "C" int search_collect_stats(void* ctx, int enable)
+{
+    if (!ctx)
+        return WCORE_INVALID_ARGUMENT;
+
+    int structure = *(const int*)ctx;
+    if (structure == SEARCH_TRIGRID3) {
+        trigrid_collect_stats((trigrid*)ctx, enable != 0);
+        return WCORE_OK;
     }
 
     return WCORE_INVALID_ARGUMENT;
@@ -66,6 +329,89 @@ extern "C" int search_info(const void* ctx, int kind, int param, void* res, int
                 memcpy((uint8_t*)res + 12, grid->x1, sizeof(float) * 3);
             }
             break;
+
+        case SEARCHINFO_STATS:
+            if (!grid->stats)
+                break;
+
+            ret = sizeof(search_stats);
+            if (ressize >= ret) {
+                search_stats* st = (search_stats*)res;
+                st->queries = grid->stats->queries;
+                st->cells_visited = grid->stats->cells_visited;
+                st->tris_tested = grid->stats->tris_tested;
+                st->early_outs = grid->stats->early_outs;
+                st->max_dist_reached = grid->stats->max_dist_reached;
+            }
+            break;
+
+        case SEARCHINFO_CELL_HISTOGRAM:
+            // Bin i counts cells holding [i*param, (i+1)*param) triangles, the last bin is open-ended.
+            if (ressize >= (int)sizeof(int)) {
+                ret = ressize - ressize % (int)sizeof(int);
+                trigrid_cell_histogram(grid, param, (int*)res, ressize / (int)sizeof(int));
+            }
+            break;
+
+        case SEARCHINFO_MEMORY:
+            ret = sizeof(search_memory);
+            if (ressize >= ret) {
+                search_memory* mem = (search_memory*)res;
+                trigrid_memory(grid, mem->vertex_bytes, mem->index_bytes, mem->other_bytes);
+                mem->total_bytes = mem->vertex_bytes + mem->index_bytes + mem->other_bytes;
+            }
+            break;
+        }
+    } else if (structure == SEARCH_PCL_KDTREE) {
+        const kdtree* tree = (const kdtree*)ctx;
+
+        switch (kind) {
+        case SEARCHINFO_AABB:
+            ret = 24;
+            if (ressize >= ret) {
+                memcpy(res, tree->x0, sizeof(float) * 3);
+                memcpy((uint8_t*)res + 12, tree->x1, sizeof(float) * 3);
+            }
+            break;
+
+        case SEARCHINFO_MEMORY:
+            ret = sizeof(search_memory);
+            if (ressize >= ret) {
+                search_memory* mem = (search_memory*)res;
+                mem->vertex_bytes = sizeof(float) * 3 * (int64_t)tree->n;
+                mem->index_bytes = sizeof(int) * (int64_t)tree->n;
+                mem->other_bytes = sizeof(kdtree_node) * ((2ll << tree->depth) - 1);
+                mem->total_bytes = mem->vertex_bytes + mem->index_bytes + mem->other_bytes;
+            }
+            break;
+        }
+    } else if (structure == SEARCH_TRIGRID3_DISTFIELD) {
+        const distfield* df = (const distfield*)ctx;
+
+        switch (kind) {
+        case SEARCHINFO_AABB:
+            ret = 24;
+            if (ressize >= ret) {
+                memcpy(res, df->grid.x0, sizeof(float) * 3);
+                memcpy((uint8_t*)res + 12, df->grid.x1, sizeof(float) * 3);
+            }
+            break;
+
+        case SEARCHINFO_MEMORY:
+            ret = sizeof(search_memory);
+            if (ressize >= ret) {
+                search_memory* mem = (search_memory*)res;
+                int64_t gv = 0, gi = 0, go = 0;
+                trigrid_memory(&df->grid, gv, gi, go);
+
+                const int64_t ns = (int64_t)df->num_bricks * DISTFIELD_BRICK_SIZE;
+                mem->vertex_bytes = sizeof(float) * ns;
+                mem->index_bytes = df->tri ? sizeof(int) * ns : 0;
+                mem->other_bytes = gv + gi + go + sizeof(float) * 3 * (int64_t)df->nv +
+                    sizeof(int) * (int64_t)df->nbrick[0] * df->nbrick[1] * df->nbrick[2];
+                mem->total_bytes = mem->vertex_bytes + mem->index_bytes + mem->other_bytes;
+            }
+            break;
         }
     }
 
@@ -84,13 +430,26 @@ extern "C" int search_query(const void* ctx, int kind, search_query_config* cfg,
             .cfg = cfg, 
             .hit = hit, 
             .info = info, 
-            .invert_dir = (kind & SEARCH_INVERT_DIRECTION) != 0 
+            .invert_dir = (kind & SEARCH_INVERT_DIRECTION) != 0,
+            .bidir = (kind & SEARCH_BIDIRECTIONAL) != 0
         };
 
-        switch(kind & ~SEARCH_INVERT_DIRECTION) {
+        switch(kind & ~(SEARCH_INVERT_DIRECTION | SEARCH_BIDIRECTIONAL | SEARCH_SEED_HINT | SEARCH_SEED_PREVIOUS)) {
         case SEARCH_NN_DPTBARY:
-            for (int i = 0; i < n; i++) {
-                qi.hit[i] = trigrid_nn<PtTri_DPtBary>(qi.g, orig + 3 * i, cfg->max_dist, (float*)qi.info + PtTri_DPtBary::ResultSize * i);
+            if (kind & SEARCH_SEED_HINT) {
+                for (int i = 0; i < n; i++)
+                    qi.hit[i] = trigrid_nn<PtTri_DPtBary>(qi.g, orig + 3 * i, cfg->max_dist, (float*)qi.info + PtTri_DPtBary::ResultSize * i, qi.hit[i]);
+            } else if (kind & SEARCH_SEED_PREVIOUS) {
+                int seed = -1;
+                for (int i = 0; i < n; i++) {
+                    const int h = trigrid_nn<PtTri_DPtBary>(qi.g, orig + 3 * i, cfg->max_dist, (float*)qi.info + PtTri_DPtBary::ResultSize * i, seed);
+                    qi.hit[i] = h;
+                    if (h >= 0)
+                        seed = h;
+                }
+            } else {
+                for (int i = 0; i < n; i++)
+                    qi.hit[i] = trigrid_nn<PtTri_DPtBary>(qi.g, orig + 3 * i, cfg->max_dist, (float*)qi.info + PtTri_DPtBary::ResultSize * i);
             }
             return WCORE_OK;
 
@@ -119,6 +478,60 @@ extern "C" int search_query(const void* ctx, int kind, search_query_config* cfg,
             }
             return WCORE_OK;
 
+        case SEARCH_RAYCAST_MULTI:
+            return trigrid_query_raycast_multi(qi.g, cfg, orig, dir, qi.invert_dir, n, hit, (search_ray_hit*)info);
+
+        case SEARCH_RAYCAST_NN_FALLBACK:
+            for (int i = 0; i < n; i++) {
+                float* res = (float*)qi.info + PtTri_DPtBary::ResultSize * i;
+                if (qi.invert_dir) {
+                    float dd[3]{ -dir[3 * i], -dir[3 * i + 1], -dir[3 * i + 2] };
+                    qi.hit[i] = raycast_nn_fallback(qi.g, orig + 3 * i, dd, qi.bidir, cfg, res);
+                } else {
+                    qi.hit[i] = raycast_nn_fallback(qi.g, orig + 3 * i, dir + 3 * i, qi.bidir, cfg, res);
+                }
+            }
+            return WCORE_OK;
+
+        default:
+            return WCORE_INVALID_ARGUMENT;
+        }
+    } else if (structure == SEARCH_PCL_KDTREE) {
+        const kdtree* tree = (const kdtree*)ctx;
+
+        switch (kind) {
+        case SEARCH_KNN_PCL:
+            return kdtree_query_knn(tree, cfg, orig, n, hit, (float*)info);
+
+        case SEARCH_RADIUS_PCL:
+            return kdtree_query_radius(tree, cfg, orig, n, hit, (int*)info);
+
+        default:
+            return WCORE_INVALID_ARGUMENT;
+        }
+    } else if (structure == SEARCH_TRIGRID3_DISTFIELD) {
+        const distfield* df = (const distfield*)ctx;
+        float* dist = (float*)info;
+
+        switch (kind) {
+        case SEARCH_SIGNED_DIST:
+            #pragma omp parallel for schedule(dynamic, 256)
+            for (int i = 0; i < n; i++) {
+                const int h = distfield_query(df, orig + 3 * i, cfg->max_dist, dist[i]);
+                if (hit)
+                    hit[i] = h;
+            }
+            return WCORE_OK;
+
+        case SEARCH_SIGNED_DIST_EXACT:
+            #pragma omp parallel for schedule(dynamic, 256)
+            for (int i = 0; i < n; i++) {
+                const int h = distfield_query_exact(df, orig + 3 * i, cfg->max_dist, dist[i]);
+                if (hit)
+                    hit[i] = h;
+            }
+            return WCORE_OK;
+
         default:
             return WCORE_INVALID_ARGUMENT;
         }
@@ -143,4 +556,178 @@ extern "C" int search_direct(int kind, const float* orig, const float* dir, cons
     }
 
     return -1;
+}
+
+// Copy the triangles of an indexed mesh to AoSoA blocks of 8, as _raytri and _pttri expect. The unused
+// lanes of the last block repeat its first triangle.
+static float* make_trisoup_aosoa(const float* vert, const int* idx, int nt)
+{
+    const int ntb = round_up(nt, 8);
+    float* soup = (float*)_aligned_malloc(sizeof(float) * 9 * ntb, 32);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < ntb; i++) {
+        const int t = (i < nt) ? i : (nt & ~7);
+        float* blk = soup + 9 * (i & ~7) + (i & 7);
+        for (int k = 0; k < 3; k++) {
+            const float* v = vert + 3 * idx[3 * t + k];
+            blk[(3 * k) * 8] = v[0];
+            blk[(3 * k + 1) * 8] = v[1];
+            blk[(3 * k + 2) * 8] = v[2];
+        }
+    }
+
+    return soup;
+}
+
+// Brute force search_direct for n queries at once. For SEARCHD_NN_PCL_3, vert holds nv points. For the 
+// triangle soup kinds, vert and idx are an indexed mesh with nv vertices and nt triangles, or, if idx is 
+// null, vert is already an AoSoA soup of nt triangles as in search_direct. hit receives the closest 
+// point, triangle or -1. info (optional) receives the distance to the hit, or the ray parameter for 
+// SEARCHD_RAYCAST_TRISOUP_3, NaN if there is no hit.
+extern "C" int search_direct_batch(int kind, const float* orig, const float* dir, const float* vert, const int* idx, int nv, int nt, int n, int* hit, float* info)
+{
+    if (!orig || !vert || !hit || n < 0 || nv < 0 || nt < 0)
+        return WCORE_INVALID_ARGUMENT;
+
+    if (kind == SEARCHD_NN_PCL_3) {
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int i = 0; i < n; i++) {
+            const float* q = orig + 3 * i;
+            const int h = (nv > 0) ? nearest<3>(vert, nv, q) : -1;
+            hit[i] = h;
+
+            if (info) {
+                if (h >= 0) {
+                    const float* p = vert + 3 * h;
+                    const float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+                    info[i] = sqrtf(dx * dx + dy * dy + dz * dz);
+                } else {
+                    info[i] = NAN;
+                }
+            }
+        }
+
+        return WCORE_OK;
+    }
+
+    if (kind != SEARCHD_RAYCAST_TRISOUP_3 && kind != SEARCHD_NN_TRISOUP_3)
+        return WCORE_INVALID_ARGUMENT;
+
+    if (kind == SEARCHD_RAYCAST_TRISOUP_3 && !dir)
+        return WCORE_INVALID_ARGUMENT;
+
+    float* soup = (idx && nt > 0) ? make_trisoup_aosoa(vert, idx, nt) : nullptr;
+    const float* tris = soup ? soup : vert;
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++) {
+        float t = FLT_MAX;
+        int h = -1;
+
+        if (nt > 0) {
+            if (kind == SEARCHD_RAYCAST_TRISOUP_3) {
+                h = raytri<RayTri_T>(warpcore::p3f_set(orig + 3 * i), warpcore::p3f_set(dir + 3 * i), tris, nt, &t);
+            } else {
+                h = pttri<PtTri_Blank>(warpcore::p3f_set(orig + 3 * i), tris, nt, nullptr, &t);
+                t = sqrtf(t);
+            }
+        }
+
+        hit[i] = h;
+        if (info)
+            info[i] = (h >= 0) ? t : NAN;
+    }
+
+    _aligned_free(soup);
+    return WCORE_OK;
+}
+
+// For each source vertex, find the distance to the nearest point on the target mesh (vert, idx), using
+// the search context ctx if it is a trigrid on that mesh or a temporary one otherwise. Signed distances
+// are positive where the target lies in front of the source along the target's normal, which is
+// interpolated from normals (per vertex, optional) at the hit barycentrics, or taken from the face.
+// Source vertices with no hit within cfg->max_dist get NaN distance and -1 in hit.
+extern "C" int mesh_surface_distance(const void* ctx, const float* vert, const int* idx, const float* normals, int nv, int nt, const float* src, int n, const surface_distance_config* cfg, float* dist, int* hit, surface_distance_summary* summary)
+{
+    if (!vert || !idx || !src || !cfg || !dist || n < 0)
+        return WCORE_INVALID_ARGUMENT;
+
+    if (ctx && *(const int*)ctx != SEARCH_TRIGRID3)
+        return WCORE_INVALID_ARGUMENT;
+
+    // The hits index idx and vert, so the grid must have been built on this very mesh.
+    if (ctx && (((const trigrid*)ctx)->nt != nt || ((const trigrid*)ctx)->nv != nv))
+        return WCORE_INVALID_ARGUMENT;
+
+    trigrid* temp = nullptr;
+    if (!ctx) {
+        temp = new trigrid;
+        temp->__magic = SEARCH_TRIGRID3;
+        trigrid_build(temp, vert, idx, nv, nt, 16);
+    }
+
+    const trigrid* g = ctx ? (const trigrid*)ctx : temp;
+    const bool sign = (cfg->flags & SURFDIST_SIGNED) != 0;
+    float dmax = 0;
+    double dsum2 = 0;
+    int nhit = 0;
+
+    #pragma omp parallel for schedule(dynamic, 256) reduction(max: dmax) reduction(+: dsum2, nhit)
+    for (int i = 0; i < n; i++) {
+        alignas(16) float res[PtTri_DPtBary::ResultSize];
+        const float* s = src + 3 * i;
+        const int h = trigrid_nn<PtTri_DPtBary>(g, s, cfg->max_dist, res);
+
+        if (hit)
+            hit[i] = h;
+
+        if (h < 0) {
+            dist[i] = NAN;
+            continue;
+        }
+
+        float d = res[0];
+        if (sign) {
+            const int* f = idx + 3 * h;
+            const float u = res[4], v = res[5];
+            float nrm[3];
+
+            if (normals) {
+                for (int j = 0; j < 3; j++)
+                    nrm[j] = (1 - u - v) * normals[3 * f[0] + j] + u * normals[3 * f[1] + j] + v * normals[3 * f[2] + j];
+            } else {
+                const float* a = vert + 3 * f[0];
+                const float* b = vert + 3 * f[1];
+                const float* c = vert + 3 * f[2];
+                const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                nrm[0] = e1[1] * e2[2] - e1[2] * e2[1];
+                nrm[1] = e1[2] * e2[0] - e1[0] * e2[2];
+                nrm[2] = e1[0] * e2[1] - e1[1] * e2[0];
+            }
+
+            const float dot = (res[1] - s[0]) * nrm[0] + (res[2] - s[1]) * nrm[1] + (res[3] - s[2]) * nrm[2];
+            if (dot < 0)
+                d = -d;
+        }
+
+        dist[i] = d;
+        dmax = std::max(dmax, res[0]);
+        dsum2 += (double)res[0] * res[0];
+        nhit++;
+    }
+
+    if (summary) {
+        summary->hausdorff = dmax;
+        summary->rms = (nhit > 0) ? (float)sqrt(dsum2 / nhit) : 0.0f;
+        summary->num_hits = nhit;
+    }
+
+    if (temp) {
+        trigrid_destroy(temp);
+        delete temp;
+    }
+
+    return WCORE_OK;
 }
\ No newline at end of file
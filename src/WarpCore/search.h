@@ -4,7 +4,9 @@
 #include "config.h"
 
 enum SEARCH_STRUCTURE {
-    SEARCH_TRIGRID3 = 0
+    SEARCH_TRIGRID3 = 0,
+    SEARCH_PCL_KDTREE = 1, // point cloud, idx may be null
+    SEARCH_TRIGRID3_DISTFIELD = 2
 };
 
 enum SEARCHD_KIND {
@@ -17,25 +19,117 @@ enum SEARCH_KIND {
     SEARCH_NN_DPTBARY = 0,
     SEARCH_RAYCAST_T = 1,
     SEARCH_RAYCAST_TBARY = 2,
+    SEARCH_RAYCAST_NN_FALLBACK = 3,
+    SEARCH_KNN_PCL = 4, // SEARCH_PCL_KDTREE only, hit: int[n*k], info: float[n*k] distances or null
+    SEARCH_RADIUS_PCL = 5, // SEARCH_PCL_KDTREE only, hit: int[n+1] CSR offsets, info: int[hit[n]] or null
+    SEARCH_SIGNED_DIST = 6, // SEARCH_TRIGRID3_DISTFIELD only, hit: int[n] or null, info: float[n]
+    SEARCH_SIGNED_DIST_EXACT = 7, // SEARCH_TRIGRID3_DISTFIELD only, as SEARCH_SIGNED_DIST
+    SEARCH_RAYCAST_MULTI = 8, // hit: int[n+1] CSR offsets, info: search_ray_hit[hit[n]] or null
 
+    SEARCH_SEED_HINT = 0x04000000, // SEARCH_NN_DPTBARY only, hit holds a hint triangle on input
+    SEARCH_SEED_PREVIOUS = 0x08000000, // SEARCH_NN_DPTBARY only, seed with the previous query's hit
+    SEARCH_BIDIRECTIONAL = 0x10000000, // SEARCH_RAYCAST_NN_FALLBACK only
     SEARCH_INVERT_DIRECTION = 0x20000000
 };
 
 enum SEARCH_INFO {
-    SEARCHINFO_AABB = 0
+    SEARCHINFO_AABB = 0,
+    SEARCHINFO_STATS = 1, // search_stats, requires search_collect_stats
+    SEARCHINFO_CELL_HISTOGRAM = 2, // int[ressize/4], param is the bin width in triangles
+    SEARCHINFO_MEMORY = 3 // search_memory
+};
+
+enum TRIGRID_FLAGS {
+    TRIGRID_QUANTIZED = 1 // 16-bit vertex coordinates in the cells, AVX2 kernels only
 };
 
 struct trigrid_config { 
     int num_cells; 
+    int flags;
+};
+
+struct kdtree_config {
+    int leaf_size;
+};
+
+enum DISTFIELD_FLAGS {
+    DISTFIELD_STORE_TRIANGLES = 1
+};
+
+// voxel_size <= 0 selects 1/64 of the longest side of the mesh AABB, band <= 0 selects two voxels.
+// With max_memory > 0 (in bytes), the voxel size is doubled until the brick index and the sampled bricks
+// fit, the exact trigrid and the vertex normals come on top of that. search_build fails with 
+// WCORE_INVALID_ARGUMENT if no voxel size fits.
+struct distfield_config {
+    float voxel_size;
+    float band;
+    int flags;
+    int64_t max_memory;
 };
 
 struct search_query_config
 {
     float max_dist;
+    float max_ray_dist; // SEARCH_RAYCAST_NN_FALLBACK, SEARCH_RAYCAST_MULTI only, <= 0 means unlimited
+    int k; // SEARCH_KNN_PCL, SEARCH_RAYCAST_MULTI (<= 0 means all hits) only
+};
+
+struct search_ray_hit
+{
+    int tri;
+    float t, u, v;
+};
+
+enum SURFDIST_FLAGS {
+    SURFDIST_SIGNED = 1
+};
+
+struct surface_distance_config
+{
+    int flags;
+    float max_dist;
+};
+
+// Summaries over the source vertices that found the target surface within max_dist.
+// hausdorff is the one-sided (source to target) Hausdorff distance.
+struct surface_distance_summary
+{
+    float hausdorff;
+    float rms;
+    int num_hits;
+};
+
+// Memory held by a search structure in bytes. vertex_bytes counts the primitive coordinates
+// (trigrid cell data, kd-tree points, distance field samples), index_bytes the triangle
+// or point indices that go with them and other_bytes the rest (cell tables, tree nodes, 
+// the exact trigrid of a distance field).
+struct search_memory
+{
+    int64_t total_bytes;
+    int64_t vertex_bytes;
+    int64_t index_bytes;
+    int64_t other_bytes;
+};
+
+// Traversal counters accumulated over all queries since statistics were enabled.
+struct search_stats
+{
+    int64_t queries;
+    int64_t cells_visited;
+    int64_t tris_tested;
+    int64_t early_outs;
+    int64_t max_dist_reached;
 };
 
 extern "C" WCEXPORT int search_build(int structure, const float* vert, const int* idx, int nv, int nt, const void* config, void** ctx);
+extern "C" WCEXPORT int search_refit(void* ctx, const float* vert);
 extern "C" WCEXPORT int search_free(void* ctx);
+// Paths are UTF-8.
+extern "C" WCEXPORT int search_save(const void* ctx, const char* path);
+extern "C" WCEXPORT int search_load(const char* path, void** ctx);
 extern "C" WCEXPORT int search_direct(int kind, const float* orig, const float* dir, const float* vert, int n);
+extern "C" WCEXPORT int search_direct_batch(int kind, const float* orig, const float* dir, const float* vert, const int* idx, int nv, int nt, int n, int* hit, float* info);
+extern "C" WCEXPORT int search_collect_stats(void* ctx, int enable);
 extern "C" WCEXPORT int search_info(const void* ctx, int kind, int param, void* res, int ressize);
-extern "C" WCEXPORT int search_query(const void* ctx, int kind, search_query_config* cfg, const float* orig, const float* dir, int n, int* hit, void* info);
\ No newline at end of file
+extern "C" WCEXPORT int search_query(const void* ctx, int kind, search_query_config* cfg, const float* orig, const float* dir, int n, int* hit, void* info);
+extern "C" WCEXPORT int mesh_surface_distance(const void* ctx, const float* vert, const int* idx, const float* normals, int nv, int nt, const float* src, int n, const surface_distance_config* cfg, float* dist, int* hit, surface_distance_summary* summary);
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifdef WARPCORE_TEST
+
+#include <CppUnitTest.h>
+#include "test_utils.h"
+#include "../impl/gpa_impl.h"
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace warpcore::impl;
+
+namespace warpcore::test
+{
+	TEST_CLASS(gpa_test)
+	{
+	public:
+		TEST_METHOD(_opa_rot_horn_matches_svd)
+		{
+			constexpr int n = 37;
+			float cov[9 * n], rot_horn[9 * n], rot_svd[9 * n];
+			bool ok[n];
+
+			std::mt19937 rng(1234);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			for (int i = 0; i < 9 * n; i++)
+				cov[i] = dist(rng);
+
+			opa_rot_horn(cov, n, rot_horn, ok);
+
+			for (int i = 0; i < n; i++) {
+				if (!ok[i])
+					continue;
+
+				Assert::AreEqual(0, opa_rot_svd(cov + 9 * i, rot_svd + 9 * i));
+				for (int j = 0; j < 9; j++)
+					assert_float_eq(rot_svd[9 * i + j], rot_horn[9 * i + j], 1e-4f);
+			}
+		}
+
+		TEST_METHOD(_opa_rot_horn_degenerate)
+		{
+			// Rank one covariance, the rotation about the x axis is not determined.
+			float cov[9] = { 1,0,0, 0,0,0, 0,0,0 };
+			float rot[9];
+			bool ok;
+
+			opa_rot_horn(cov, 1, rot, &ok);
+			Assert::IsFalse(ok);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifdef WARPCORE_TEST
+
+#include <CppUnitTest.h>
+#include "test_utils.h"
+#include "../impl/pca_impl.h"
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace warpcore::impl;
+
+namespace warpcore::test
+{
+	TEST_CLASS(pca_test)
+	{
+	public:
+		TEST_METHOD(_pca_rows_pack)
+		{
+			const uint32_t allow[2] = { 0xf000000f, 0x1 };
+			const float x[40] = { 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33 };
+
+			pca_rows rows;
+			pca_rows_make(allow, 33, rows);
+			Assert::AreEqual(9, rows.count);
+			Assert::AreEqual(2, (int)rows.start.size());
+
+			float p[9];
+			pca_rows_pack(rows, x, nullptr, 2, 7, p);
+			const float expected[5] = { 2, 3, 28, 29, 30 };
+			for (int i = 0; i < 5; i++)
+				assert_float_eq(expected[i], p[i]);
+		}
+
+		TEST_METHOD(_pca_covmat_masked)
+		{
+			constexpr int n = 7, m = 203;
+			float data[n][m], mean[m], cov[n * n];
+			const float* pdata[n];
+			uint32_t allow[(m + 31) / 32] = { 0 };
+
+			std::mt19937 rng(42);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			for (int i = 0; i < n; i++) {
+				for (int j = 0; j < m; j++)
+					data[i][j] = dist(rng);
+				pdata[i] = data[i];
+			}
+
+			for (int j = 0; j < m; j++) {
+				mean[j] = 0.1f * dist(rng);
+				if (j % 3 != 0)
+					allow[j >> 5] |= 1u << (j & 31);
+			}
+
+			pca_covmat(pdata, mean, allow, n, m, cov);
+
+			for (int a = 0; a < n; a++) {
+				for (int b = 0; b < n; b++) {
+					float ref = 0;
+					for (int j = 0; j < m; j++) {
+						if (j % 3 != 0)
+							ref += (data[a][j] - mean[j]) * (data[b][j] - mean[j]);
+					}
+
+					assert_float_eq(ref / (n - 1), cov[a * n + b], 1e-4f);
+				}
+			}
+		}
+
+		static int read_rows(void* user, int r0, int r1, float* dest)
+		{
+			const float* data = (const float*)user;
+			for (int i = 0; i < 7; i++) {
+				for (int r = r0; r < r1; r++)
+					dest[i * (r1 - r0) + r - r0] = data[i * 203 + r];
+			}
+			return 0;
+		}
+
+		TEST_METHOD(_pca_covmat_stream)
+		{
+			constexpr int n = 7, m = 203;
+			float data[n * m], mean[m], mean_stream[m], cov[n * n], cov_stream[n * n];
+			float panel[17 * n];
+			const float* pdata[n];
+			uint32_t allow[(m + 31) / 32] = { 0 };
+
+			std::mt19937 rng(42);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			for (int i = 0; i < n; i++) {
+				for (int j = 0; j < m; j++)
+					data[i * m + j] = dist(rng) + 0.01f * j;
+				pdata[i] = data + i * m;
+			}
+
+			// Leave some panels of 17 rows without any allowed rows.
+			for (int j = 0; j < m; j++) {
+				if (j % 3 != 0 && (j < 40 || j > 80))
+					allow[j >> 5] |= 1u << (j & 31);
+			}
+
+			pca_mean(pdata, n, m, mean);
+			pca_covmat(pdata, mean, allow, n, m, cov);
+
+			Assert::IsTrue(pca_mean_stream(read_rows, data, n, m, 17, panel, mean_stream));
+			Assert::IsTrue(pca_covmat_stream(read_rows, data, mean_stream, allow, n, m, 17, panel, cov_stream));
+
+			for (int j = 0; j < m; j++)
+				assert_float_eq(mean[j], mean_stream[j], 1e-6f);
+
+			for (int i = 0; i < n * n; i++)
+				assert_float_eq(cov[i], cov_stream[i], 1e-4f);
+		}
+
+		TEST_METHOD(_pca_make_scores_masked)
+		{
+			constexpr int n = 5, m = 75, npcs = 3;
+			float data[n * m], mean[m], pcs[npcs * m], sc[n * npcs], pred[n * m];
+			const float* pdata[n];
+			uint32_t allow[(m + 31) / 32] = { 0 };
+
+			std::mt19937 rng(42);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			for (int i = 0; i < n * m; i++)
+				data[i] = dist(rng);
+			for (int i = 0; i < npcs * m; i++)
+				pcs[i] = dist(rng);
+			for (int i = 0; i < n; i++)
+				pdata[i] = data + i * m;
+
+			for (int j = 0; j < m; j++) {
+				mean[j] = 0.1f * dist(rng);
+				if (j % 5 != 0)
+					allow[j >> 5] |= 1u << (j & 31);
+			}
+
+			pca_make_scores(pdata, mean, pcs, allow, n, npcs, m, sc);
+			pca_predict(sc, mean, pcs, n, npcs, m, pred);
+
+			for (int i = 0; i < n; i++) {
+				for (int k = 0; k < npcs; k++) {
+					float ref = 0;
+					for (int j = 0; j < m; j++) {
+						if (j % 5 != 0)
+							ref += (data[i * m + j] - mean[j]) * pcs[k * m + j];
+					}
+
+					assert_float_eq(ref, sc[i * npcs + k], 1e-4f);
+				}
+
+				for (int j = 0; j < m; j++) {
+					float ref = mean[j];
+					for (int k = 0; k < npcs; k++)
+						ref += sc[i * npcs + k] * pcs[k * m + j];
+
+					assert_float_eq(ref, pred[i * m + j], 1e-4f);
+				}
+			}
+		}
+	};
+}
+
+#endif
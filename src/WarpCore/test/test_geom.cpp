@@ -4,6 +4,8 @@
 #include "test_utils.h"
 #include <iostream>
 #include "../impl/search_impl.h"
+#include "../impl/cpu_info.h"
+#include "../impl/utils.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace warpcore::impl;
@@ -13,6 +15,7 @@ namespace warpcore::test
 {
 	void make_two_triangles(float* vertAosoa);
 	int _pttri_case(const float* vertAosoa, p3f pt, float expU, float expV, int expIdx=0);
+	void make_random_triangles(float* vertAosoa, int n, int width, unsigned seed);
 
 	TEST_CLASS(pttri_test)
 	{
@@ -136,6 +139,84 @@ namespace warpcore::test
 
 			Assert::AreEqual(0, numErr);
 		}
+
+		TEST_METHOD(_pttri_avx512_matches_avx2)
+		{
+			init_cpuinfo();
+			require_isa(WCORE_OPTPATH::AVX512);
+
+			constexpr int N = 29;
+			float vx8[9 * 32], vx16[9 * 32];
+			make_random_triangles(vx8, N, 8, 42);
+			make_random_triangles(vx16, N, 16, 42);
+
+			int numErr = 0;
+			for (int i = 0; i < 1000; i++) {
+				p3f pt = _p3f((float)(i % 10) - 4.5f, (float)((i / 10) % 10) - 4.5f, (float)(i / 100) - 4.5f);
+
+				p3f bary8{}, hit8{}, bary16{}, hit16{};
+				float dist8 = FLT_MAX, dist16 = FLT_MAX;
+				int idx8 = -1;
+				for (int j = 0; j < N; j += 8) {
+					float d = FLT_MAX;
+					p3f b{}, h{};
+					int k = _pttri(pt, vx8 + 9 * j, std::min(8, N - j), b, h, d);
+					if (d < dist8) {
+						dist8 = d; bary8 = b; hit8 = h; idx8 = j + k;
+					}
+				}
+
+				int idx16 = _pttri_avx512(pt, vx16, N, bary16, hit16, dist16);
+
+				if (idx8 != idx16 || abs(dist8 - dist16) > 1e-4f * (1 + dist8)) {
+					if (numErr < 50)
+						cerr << "at " << i << ": idx " << idx8 << " vs " << idx16 << ", dist " << dist8 << " vs " << dist16 << endl;
+
+					numErr++;
+				}
+			}
+
+			Assert::AreEqual(0, numErr);
+		}
+
+		TEST_METHOD(_raytri_avx512_matches_avx2)
+		{
+			init_cpuinfo();
+			require_isa(WCORE_OPTPATH::AVX512);
+
+			constexpr int N = 29;
+			float vx8[9 * 32], vx16[9 * 32];
+			make_random_triangles(vx8, N, 8, 7);
+			make_random_triangles(vx16, N, 16, 7);
+
+			int numErr = 0;
+			for (int i = 0; i < 1000; i++) {
+				p3f orig = _p3f((float)(i % 10) - 4.5f, (float)((i / 10) % 10) - 4.5f, -10.0f);
+				p3f dir = _p3f(0.01f * (float)(i / 100), 0.0f, 1.0f);
+
+				float r8[2] = { 0, 0 }, r16[2] = { 0, 0 };
+				float best8 = 1e30f;
+				int idx8 = -1;
+				for (int j = 0; j < N; j += 8) {
+					float r[2];
+					int k = raytri<RayTri_T>(orig, dir, vx8 + 9 * j, std::min(8, N - j), r);
+					if (k >= 0 && r[0] < best8) {
+						best8 = r[0]; idx8 = j + k;
+					}
+				}
+
+				int idx16 = raytri<RayTri_T, 16>(orig, dir, vx16, N, r16);
+
+				if (idx8 != idx16 || (idx8 >= 0 && abs(best8 - r16[0]) > 1e-3f * (1 + best8))) {
+					if (numErr < 50)
+						cerr << "at " << i << ": idx " << idx8 << " vs " << idx16 << endl;
+
+					numErr++;
+				}
+			}
+
+			Assert::AreEqual(0, numErr);
+		}
 	};
 
 	void make_two_triangles(float* vertAosoa)
@@ -158,6 +239,18 @@ namespace warpcore::test
 		vertAosoa[8 * 8] = 0; vertAosoa[8 * 8 + 1] = 1000;
 	}
 
+	void make_random_triangles(float* vertAosoa, int n, int width, unsigned seed)
+	{
+		memset(vertAosoa, 0, sizeof(float) * 9 * round_up(n, width));
+
+		srand(seed);
+		for (int i = 0; i < n; i++) {
+			float* blk = vertAosoa + 9 * (i & ~(width - 1)) + (i & (width - 1));
+			for (int k = 0; k < 9; k++)
+				blk[k * width] = 10.0f * (float)rand() / (float)RAND_MAX - 5.0f;
+		}
+	}
+
 	int _pttri_case(const float* vertAosoa, p3f pt, float expU, float expV, int expIdx)
 	{
 		constexpr float tol = 1e-3f;
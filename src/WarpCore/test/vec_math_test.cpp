@@ -3,6 +3,7 @@
 #include <CppUnitTest.h>
 #include "test_utils.h"
 #include "../impl/vec_math.h"
+#include "../impl/cpu_info.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace warpcore::impl;
@@ -17,6 +18,57 @@ namespace warpcore::test
 			float a[18] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18 };
 			assert_float_eq(171.0f, reduce_add(a, 18));
 		}
+
+		TEST_METHOD(_demux_mux_avx2)
+		{
+			float a[24], b[24];
+			for (int i = 0; i < 24; i++)
+				a[i] = (float)i;
+
+			__m256 v0 = _mm256_loadu_ps(a), v1 = _mm256_loadu_ps(a + 8), v2 = _mm256_loadu_ps(a + 16);
+			demux(v0, v1, v2);
+			_mm256_storeu_ps(b, v0);
+			_mm256_storeu_ps(b + 8, v1);
+			_mm256_storeu_ps(b + 16, v2);
+			for (int i = 0; i < 8; i++) {
+				for (int j = 0; j < 3; j++)
+					assert_float_eq(a[3 * i + j], b[8 * j + i]);
+			}
+
+			mux(v0, v1, v2);
+			_mm256_storeu_ps(b, v0);
+			_mm256_storeu_ps(b + 8, v1);
+			_mm256_storeu_ps(b + 16, v2);
+			for (int i = 0; i < 24; i++)
+				assert_float_eq(a[i], b[i]);
+		}
+
+		TEST_METHOD(_demux_mux_avx512)
+		{
+			init_cpuinfo();
+			require_isa(WCORE_OPTPATH::AVX512);
+
+			float a[48], b[48];
+			for (int i = 0; i < 48; i++)
+				a[i] = (float)i;
+
+			__m512 v0 = _mm512_loadu_ps(a), v1 = _mm512_loadu_ps(a + 16), v2 = _mm512_loadu_ps(a + 32);
+			demux(v0, v1, v2);
+			_mm512_storeu_ps(b, v0);
+			_mm512_storeu_ps(b + 16, v1);
+			_mm512_storeu_ps(b + 32, v2);
+			for (int i = 0; i < 16; i++) {
+				for (int j = 0; j < 3; j++)
+					assert_float_eq(a[3 * i + j], b[16 * j + i]);
+			}
+
+			mux(v0, v1, v2);
+			_mm512_storeu_ps(b, v0);
+			_mm512_storeu_ps(b + 16, v1);
+			_mm512_storeu_ps(b + 32, v2);
+			for (int i = 0; i < 48; i++)
+				assert_float_eq(a[i], b[i]);
+		}
 	};
 }
 
@@ -2,5 +2,6 @@
 
 #include "cpd.h"
 #include "gpa.h"
+#include "icp.h"
 #include "misc.h"
 #include "search.h"
\ No newline at end of file
@@ -83,16 +83,25 @@ namespace Warp9.JobItems
             int npcs = Math.Min(50, ns - 1);
 
             int npcsall = pca.NumPcs;
-            float[] scores = ArrayPool<float>.Shared.Rent(npcsall);
-            Matrix<float> scoresMat = new Matrix<float>(npcs, ns);
-            Parallel.For(0, ns, (i) =>
+            for (int i = 0; i < ns; i++)
             {
-                if (dcaCorrPcls[i] is null || !pca.TryGetScores(dcaCorrPcls[i]!, scores.AsSpan()))
+                if (dcaCorrPcls[i] is null)
                     throw new ModelException($"Cannot transform specimen {i}.");
+            }
+
+            float[] scores = ArrayPool<float>.Shared.Rent(ns * npcsall);
+            if (!pca.TryGetScores(dcaCorrPcls, scores.AsSpan()))
+            {
+                ArrayPool<float>.Shared.Return(scores);
+                throw new ModelException("Cannot transform specimens.");
+            }
 
+            Matrix<float> scoresMat = new Matrix<float>(npcs, ns);
+            for (int i = 0; i < ns; i++)
+            {
                 for (int j = 0; j < npcs; j++)
-                    scoresMat[i, j] = scores[j];
-            });
+                    scoresMat[i, j] = scores[i * npcsall + j];
+            }
 
             ArrayPool<float>.Shared.Return(scores);
 
@@ -0,0 +1,51 @@
+﻿using System;
+using System.Numerics;
+using System.Runtime.InteropServices;
+using Warp9.Data;
+
+namespace Warp9.Native
+{
+    public static class NonRigidIcp
+    {
+        // Deform templ onto the surface of target, writing the moved template vertices to result. The
+        // template should already be rigidly aligned to target. If ctx is a trigrid on target, it is
+        // used for the correspondence search.
+        public static WarpCoreStatus Fit(Mesh target, Mesh templ, NicpConfig cfg, SearchContext? ctx, Span<Vector3> result, out IcpResult res)
+        {
+            if (!target.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> vert) ||
+                !target.TryGetIndexData(out ReadOnlySpan<FaceIndices> idx))
+                throw new InvalidOperationException();
+
+            if (!templ.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> templVert) ||
+                !templ.TryGetIndexData(out ReadOnlySpan<FaceIndices> templIdx))
+                throw new InvalidOperationException();
+
+            if (result.Length < templ.VertexCount)
+                throw new ArgumentException(nameof(result));
+
+            if (ctx is not null && ctx.StructureKind != SEARCH_STRUCTURE.SEARCH_TRIGRID3)
+                ctx = null;
+
+            IcpResult ret = new IcpResult();
+            WarpCoreStatus s;
+
+            unsafe
+            {
+                fixed (Vector3* ptrVert = &MemoryMarshal.GetReference(vert))
+                fixed (FaceIndices* ptrIdx = &MemoryMarshal.GetReference(idx))
+                fixed (Vector3* ptrTemplVert = &MemoryMarshal.GetReference(templVert))
+                fixed (FaceIndices* ptrTemplIdx = &MemoryMarshal.GetReference(templIdx))
+                fixed (Vector3* ptrResult = &MemoryMarshal.GetReference(result))
+                {
+                    s = (WarpCoreStatus)WarpCore.nicp_fit(ctx?.NativeContext ?? nint.Zero, 
+                        (nint)ptrVert, (nint)ptrIdx, target.VertexCount, target.FaceCount,
+                        (nint)ptrTemplVert, (nint)ptrTemplIdx, templ.VertexCount, templ.FaceCount,
+                        ref cfg, (nint)ptrResult, ref ret);
+                }
+            }
+
+            res = ret;
+            return s;
+        }
+    }
+}
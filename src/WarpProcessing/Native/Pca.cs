@@ -4,6 +4,7 @@ using System.Drawing.Drawing2D;
 using System.Linq;
 using System.Numerics;
 using System.Reflection.Metadata;
+using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 using System.Text;
 using System.Threading.Tasks;
@@ -18,6 +19,9 @@ namespace Warp9.Native
         General
     }
 
+    // Fills dest with the rows firstRow..endRow-1 of all specimens, those of one specimen after another.
+    public delegate bool PcaRowReader(int firstRow, int endRow, Span<float> dest);
+
     public class Pca
     {
         private Pca(PcaSourceDataKind kind, float[] pcsMean, float[] variance, int[] allowBitfield, PcaInfo info)
@@ -43,6 +47,7 @@ namespace Warp9.Native
         public const int KeyPcVariance = 1;
         public const int KeyAllow = 2;
         public const int KeyScores = 3;
+        public const int KeyNumSourceData = 4;
 
         public ReadOnlySpan<float> GetMean()
         {
@@ -63,6 +68,9 @@ namespace Warp9.Native
 
             foreach ((int, float) s in scores)
             {
+                if (s.Item1 < 0 || s.Item1 >= NumPcs)
+                    throw new ArgumentOutOfRangeException(nameof(scores));
+
                 int offs = (s.Item1 + 1) * Dimension;
                 float v = s.Item2;
 
@@ -114,6 +122,69 @@ namespace Warp9.Native
             return ret == WarpCoreStatus.WCORE_OK;
         }
 
+        // Scores of all point clouds at once, NumPcs per point cloud one after another.
+        public bool TryGetScores(IReadOnlyList<PointCloud> pcls, Span<float> scores)
+        {
+            int n = pcls.Count;
+            if (scores.Length < n * NumPcs)
+                return false;
+
+            BufferSegment<Vector3>[] pins = new BufferSegment<Vector3>[n];
+            nint[] handles = new nint[n];
+            int numLocked = 0;
+            WarpCoreStatus ret = WarpCoreStatus.WCORE_INVALID_ARGUMENT;
+
+            try
+            {
+                for (; numLocked < n; numLocked++)
+                {
+                    if (pcls[numLocked].VertexCount * 3 != Dimension ||
+                        !pcls[numLocked].TryGetData(MeshSegmentSemantic.Position, out pins[numLocked]))
+                        return false;
+
+                    handles[numLocked] = pins[numLocked].Lock();
+                }
+
+                unsafe
+                {
+                    fixed (nint* ppdata = &MemoryMarshal.GetReference(handles.AsSpan()))
+                    fixed (int* pallow = &MemoryMarshal.GetReference(allow.AsSpan()))
+                    fixed (float* pmeanpcs = &MemoryMarshal.GetReference(pcsMean.AsSpan()))
+                    fixed (float* pscores = &MemoryMarshal.GetReference(scores))
+                    {
+                        ret = (WarpCoreStatus)WarpCore.pca_data_to_scores_batch(ref info, (nint)ppdata, n, (nint)pmeanpcs, (nint)pallow, (nint)pscores);
+                    }
+                }
+            }
+            finally
+            {
+                for (int i = 0; i < numLocked; i++)
+                    pins[i].Unlock();
+            }
+
+            return ret == WarpCoreStatus.WCORE_OK;
+        }
+
+        // Reconstructs count specimens from NumPcs scores each, the results are stored one after another.
+        public bool TryPredict(ReadOnlySpan<float> scores, int count, Span<float> pred)
+        {
+            if (scores.Length < count * NumPcs || pred.Length < count * Dimension)
+                return false;
+
+            WarpCoreStatus ret = WarpCoreStatus.WCORE_INVALID_ARGUMENT;
+            unsafe
+            {
+                fixed (float* pmeanpcs = &MemoryMarshal.GetReference(pcsMean.AsSpan()))
+                fixed (float* ppred = &MemoryMarshal.GetReference(pred))
+                fixed (float* pscores = &MemoryMarshal.GetReference(scores))
+                {
+                    ret = (WarpCoreStatus)WarpCore.pca_scores_to_data_batch(ref info, (nint)pscores, count, (nint)pmeanpcs, (nint)ppred);
+                }
+            }
+
+            return ret == WarpCoreStatus.WCORE_OK;
+        }
+
         public bool TryPredict(ReadOnlySpan<float> scores, Span<float> pred)
         {
             if (scores.Length < NumPcs || pred.Length < Dimension)
@@ -136,8 +207,9 @@ namespace Warp9.Native
         public MatrixCollection ToMatrixCollection()
         {
             MatrixCollection ret = new MatrixCollection();
-            ret[KeyPcsMean] = new Matrix<float>(pcsMean, info.n + 1, info.m);
+            ret[KeyPcsMean] = new Matrix<float>(pcsMean, info.npcs + 1, info.m);
             ret[KeyPcVariance] = new Matrix<float>(PcVariance);
+            ret[KeyNumSourceData] = new Matrix<int>(new int[1] { info.n });
 
             if (allow is not null)
                 ret[KeyAllow] = new Matrix<int>(allow);
@@ -157,9 +229,13 @@ namespace Warp9.Native
                 {
                     m = matPcsMean.Rows,
                     n = matPcsMean.Columns - 1,
-                    npcs = mc.Count
+                    npcs = matPcsMean.Columns - 1
                 };
 
+                // Collections saved before the PCA could be truncated have all n components.
+                if (mc.TryGetMatrix(KeyNumSourceData, out Matrix<int>? matN) && matN is not null)
+                    info.n = matN.Data[0];
+
                 int[]? allow = null;
                 if (mc.TryGetMatrix(KeyAllow, out Matrix<int>? matAllow) && matAllow is not null)
                     allow = matAllow.Data;
@@ -179,7 +255,9 @@ namespace Warp9.Native
             return null;
         }
 
-        public static Pca? Fit(IReadOnlyList<PointCloud> pcls, bool[] vertexAllow, bool scale = false)
+        // If numPcs is positive and less than the number of point clouds, only that many principal components
+        // are computed.
+        public static Pca? Fit(IReadOnlyList<PointCloud> pcls, bool[] vertexAllow, bool scale = false, int numPcs = 0)
         {
             int n = pcls.Count;
             int m = 3 * pcls[0].VertexCount;
@@ -194,10 +272,11 @@ namespace Warp9.Native
 
             int[] allowBitField = BitMask.MakeBitMask(vertexAllow, 3);
 
-            PcaInfo pcaInfo = new PcaInfo { m = m, n = n, npcs = n, flags = 0 };
+            int npcs = (numPcs > 0) ? Math.Min(numPcs, n) : n;
+            PcaInfo pcaInfo = new PcaInfo { m = m, n = n, npcs = npcs, flags = 0 };
 
-            float[] pcsMean = new float[(n + 1) * m];
-            float[] pcVar = new float[n];
+            float[] pcsMean = new float[(npcs + 1) * m];
+            float[] pcVar = new float[npcs];
 
             WarpCoreStatus ret = WarpCoreStatus.WCORE_INVALID_ARGUMENT;
             unsafe
@@ -220,7 +299,7 @@ namespace Warp9.Native
             return new Pca(PcaSourceDataKind.VertexPositions, pcsMean, pcVar, allowBitField, pcaInfo);
         }
 
-        public static Pca? Fit(float[] mat, int cols, bool scale = false)
+        public static Pca? Fit(float[] mat, int cols, bool scale = false, int numPcs = 0)
         {
             int n = mat.Length / cols;
             int m = cols;
@@ -238,11 +317,12 @@ namespace Warp9.Native
             for (int i = 0; i < numAllow; i++)
                 allowBitField[i] = -1;
 
-            PcaInfo pcaInfo = new PcaInfo { m = m, n = n, npcs = n, flags = 0 };
+            int npcs = (numPcs > 0) ? Math.Min(numPcs, n) : n;
+            PcaInfo pcaInfo = new PcaInfo { m = m, n = n, npcs = npcs, flags = 0 };
             if (scale) pcaInfo.flags |= (int)PCA_FLAGS.PCA_SCALE_TO_UNITY;
 
-            float[] pcsMean = new float[(n + 1) * m];
-            float[] pcVar = new float[n];
+            float[] pcsMean = new float[(npcs + 1) * m];
+            float[] pcVar = new float[npcs];
 
             WarpCoreStatus ret = WarpCoreStatus.WCORE_INVALID_ARGUMENT;
             unsafe
@@ -261,5 +341,107 @@ namespace Warp9.Native
 
             return new Pca(PcaSourceDataKind.General, pcsMean, pcVar, allowBitField, pcaInfo);
         }
+
+        // Fits numSpecimens specimens of dimension each that are read in panels of rows by reader, so that
+        // they never have to be in memory at once. The panels take at most maxMemory bytes (256MB if it
+        // is not positive). Every row is enabled if allowBitField is null.
+        public static Pca? FitStream(int numSpecimens, int dimension, PcaRowReader reader, int[]? allowBitField = null, 
+            bool scale = false, int numPcs = 0, long maxMemory = 0)
+        {
+            int n = numSpecimens;
+            int m = dimension;
+            allowBitField ??= MakeFullAllow(m);
+
+            int npcs = (numPcs > 0) ? Math.Min(numPcs, n) : n;
+            PcaInfo pcaInfo = new PcaInfo { m = m, n = n, npcs = npcs, flags = 0 };
+            if (scale) pcaInfo.flags |= (int)PCA_FLAGS.PCA_SCALE_TO_UNITY;
+
+            float[] pcsMean = new float[(npcs + 1) * m];
+            float[] pcVar = new float[npcs];
+
+            GCHandle state = GCHandle.Alloc(new PcaStreamState(reader, n));
+            WarpCoreStatus ret = WarpCoreStatus.WCORE_INVALID_ARGUMENT;
+            try
+            {
+                unsafe
+                {
+                    fixed (int* pallow = &MemoryMarshal.GetReference(allowBitField.AsSpan()))
+                    fixed (float* pmeanpcs = &MemoryMarshal.GetReference(pcsMean.AsSpan()))
+                    fixed (float* pvar = &MemoryMarshal.GetReference(pcVar.AsSpan()))
+                    {
+                        delegate* unmanaged[Cdecl]<nint, int, int, float*, int> read = &ReadRows;
+                        ret = (WarpCoreStatus)WarpCore.pca_fit_stream(ref pcaInfo, (nint)read, GCHandle.ToIntPtr(state),
+                            (nint)pallow, maxMemory, (nint)pmeanpcs, (nint)pvar);
+                    }
+                }
+            }
+            finally
+            {
+                state.Free();
+            }
+
+            if (ret != WarpCoreStatus.WCORE_OK)
+                return null;
+
+            return new Pca(PcaSourceDataKind.General, pcsMean, pcVar, allowBitField, pcaInfo);
+        }
+
+        // As FitStream, with the specimens stored one after another as floats in a file, starting at offset
+        // bytes. The file is memory-mapped, not read as a whole.
+        public static Pca? FitFile(string path, long offset, int numSpecimens, int dimension, int[]? allowBitField = null,
+            bool scale = false, int numPcs = 0, long maxMemory = 0)
+        {
+            int n = numSpecimens;
+            int m = dimension;
+            allowBitField ??= MakeFullAllow(m);
+
+            int npcs = (numPcs > 0) ? Math.Min(numPcs, n) : n;
+            PcaInfo pcaInfo = new PcaInfo { m = m, n = n, npcs = npcs, flags = 0 };
+            if (scale) pcaInfo.flags |= (int)PCA_FLAGS.PCA_SCALE_TO_UNITY;
+
+            float[] pcsMean = new float[(npcs + 1) * m];
+            float[] pcVar = new float[npcs];
+
+            WarpCoreStatus ret = WarpCoreStatus.WCORE_INVALID_ARGUMENT;
+            unsafe
+            {
+                fixed (int* pallow = &MemoryMarshal.GetReference(allowBitField.AsSpan()))
+                fixed (float* pmeanpcs = &MemoryMarshal.GetReference(pcsMean.AsSpan()))
+                fixed (float* pvar = &MemoryMarshal.GetReference(pcVar.AsSpan()))
+                {
+                    ret = (WarpCoreStatus)WarpCore.pca_fit_file(ref pcaInfo, path, offset, (nint)pallow, maxMemory, (nint)pmeanpcs, (nint)pvar);
+                }
+            }
+
+            if (ret != WarpCoreStatus.WCORE_OK)
+                return null;
+
+            return new Pca(PcaSourceDataKind.General, pcsMean, pcVar, allowBitField, pcaInfo);
+        }
+
+        private static int[] MakeFullAllow(int m)
+        {
+            int[] ret = new int[(m + 31) / 32];
+            Array.Fill(ret, -1);
+            return ret;
+        }
+
+        private record PcaStreamState(PcaRowReader Reader, int NumSpecimens);
+
+        [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+        private static unsafe int ReadRows(nint user, int r0, int r1, float* dest)
+        {
+            // Exceptions must not unwind into native code, report them as a failed read.
+            try
+            {
+                PcaStreamState state = (PcaStreamState)GCHandle.FromIntPtr(user).Target!;
+                Span<float> span = new Span<float>(dest, state.NumSpecimens * (r1 - r0));
+                return state.Reader(r0, r1, span) ? 0 : 1;
+            }
+            catch
+            {
+                return 1;
+            }
+        }
     }
 }
@@ -39,6 +39,81 @@ namespace Warp9.Native
             return null;
         }
 
+        // Transforms pcls[i] with xforms[i], or the only point cloud in pcls with all xforms. If post is
+        // given, it is applied after each transform. All point clouds must have the same vertex count.
+        public static PointCloud[] TransformPosition(IReadOnlyList<PointCloud> pcls, IReadOnlyList<Rigid3> xforms, Rigid3? post = null)
+        {
+            const int d = 3;
+            int n = xforms.Count;
+            int nx = pcls.Count;
+
+            if (n == 0 && nx == 0)
+                return Array.Empty<PointCloud>();
+
+            if (n == 0 || (nx != 1 && nx != n))
+                throw new ArgumentException("Either one point cloud or one for each transform is required.", nameof(pcls));
+
+            int nv = pcls[0].VertexCount;
+            for (int i = 1; i < nx; i++)
+            {
+                if (pcls[i].VertexCount != nv)
+                    throw new ArgumentException("All point clouds must have the same number of vertices.", nameof(pcls));
+            }
+
+            BufferSegment<Vector3>[] pins = new BufferSegment<Vector3>[nx];
+            nint[] handles = new nint[nx];
+            for (int i = 0; i < nx; i++)
+            {
+                if (!pcls[i].TryGetData(MeshSegmentSemantic.Position, out pins[i]))
+                    throw new InvalidOperationException();
+
+                handles[i] = pins[i].Lock();
+            }
+
+            byte[][] dest = new byte[n][];
+            GCHandle[] destPins = new GCHandle[n];
+            nint[] destHandles = new nint[n];
+            for (int i = 0; i < n; i++)
+            {
+                dest[i] = new byte[nv * d * 4];
+                destPins[i] = GCHandle.Alloc(dest[i], GCHandleType.Pinned);
+                destHandles[i] = destPins[i].AddrOfPinnedObject();
+            }
+
+            Rigid3[] xf = new Rigid3[n];
+            for (int i = 0; i < n; i++)
+                xf[i] = xforms[i];
+
+            Rigid3 postXform = post ?? default;
+            WarpCoreStatus ret;
+
+            unsafe
+            {
+                fixed (nint* ppdata = &MemoryMarshal.GetReference(handles.AsSpan()))
+                fixed (nint* ppres = &MemoryMarshal.GetReference(destHandles.AsSpan()))
+                fixed (Rigid3* pxforms = &MemoryMarshal.GetReference(xf.AsSpan()))
+                {
+                    ret = (WarpCoreStatus)WarpCore.rigid_transform_batch(
+                        (nint)ppdata, nx, d, n, nv, (nint)pxforms, post.HasValue ? (nint)(&postXform) : nint.Zero, (nint)ppres);
+                }
+            }
+
+            for (int i = 0; i < n; i++)
+                destPins[i].Free();
+
+            for (int i = 0; i < nx; i++)
+                pins[i].Unlock();
+
+            if (ret != WarpCoreStatus.WCORE_OK)
+                throw new InvalidOperationException();
+
+            PointCloud[] res = new PointCloud[n];
+            for (int i = 0; i < n; i++)
+                res[i] = PointCloud.FromRawPositions(nv, dest[i]);
+
+            return res;
+        }
+
         public static PclStat3 MakePclStats(PointCloud pcl)
         {
             if (!pcl.TryGetRawData(MeshSegmentSemantic.Position, out ReadOnlySpan<byte> data, out _))
@@ -116,10 +191,45 @@ namespace Warp9.Native
             return ret;
         }
 
-        public static WarpCoreStatus FitGpa(IReadOnlyList<PointCloud> pcls, int[]? allowBitField, out PointCloud meanPcl, out Rigid3[] transforms, out GpaResult result)
+        // Find rigid transform floating -> target surface with ICP. If ctx is a trigrid on target, it is
+        // used for the correspondence search. With ICP_INIT_XFORM in cfg.flags, xform holds the initial guess.
+        public static WarpCoreStatus FitIcp(Mesh target, PointCloud floating, IcpConfig cfg, SearchContext? ctx, ref Rigid3 xform, out IcpResult result)
+        {
+            if (!target.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> vert) ||
+                !target.TryGetIndexData(out ReadOnlySpan<FaceIndices> idx))
+                throw new InvalidOperationException();
+
+            if (!floating.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> src))
+                throw new InvalidOperationException();
+
+            if (ctx is not null && ctx.StructureKind != SEARCH_STRUCTURE.SEARCH_TRIGRID3)
+                ctx = null;
+
+            IcpResult res = new IcpResult();
+            WarpCoreStatus s;
+
+            unsafe
+            {
+                fixed (Vector3* ptrVert = &MemoryMarshal.GetReference(vert))
+                fixed (FaceIndices* ptrIdx = &MemoryMarshal.GetReference(idx))
+                fixed (Vector3* ptrSrc = &MemoryMarshal.GetReference(src))
+                {
+                    s = (WarpCoreStatus)WarpCore.icp_fit(ctx?.NativeContext ?? nint.Zero, (nint)ptrVert, (nint)ptrIdx,
+                        target.VertexCount, target.FaceCount, (nint)ptrSrc, floating.VertexCount, ref cfg, ref xform, ref res);
+                }
+            }
+
+            result = res;
+            return s;
+        }
+
+        public static WarpCoreStatus FitGpa(IReadOnlyList<PointCloud> pcls, int[]? allowBitField, GpaInfo info, out PointCloud meanPcl, out Rigid3[] transforms, out GpaResult result, float[]? errors = null)
         {
             const int d = 3;
             int n = pcls.Count;
+
+            if (errors is not null && errors.Length < info.maxit)
+                throw new ArgumentException("The error history must hold maxit values.", nameof(errors));
                        
             BufferSegment<Vector3>[] pins = new BufferSegment<Vector3>[n];
             nint[] handles = new nint[n];
@@ -145,9 +255,10 @@ namespace Warp9.Native
                     fixed (Rigid3* pxforms = &MemoryMarshal.GetReference(xforms.AsSpan()))
                     fixed (byte* pmean = &MemoryMarshal.GetReference(mean.AsSpan()))
                     fixed (int* pallow = &MemoryMarshal.GetReference(allowBitField.AsSpan()))
+                    fixed (float* perr = errors)
                     {
                         ret = (WarpCoreStatus)WarpCore.gpa_fit(
-                            (nint)ppdata, (nint)pallow, d, n, specimenDataSize / 4 / d, (nint)pxforms, (nint)pmean, ref gpaRes);
+                            (nint)ppdata, (nint)pallow, d, n, specimenDataSize / 4 / d, ref info, (nint)pxforms, (nint)pmean, (nint)perr, ref gpaRes);
                     }
                 }
                 else
@@ -156,9 +267,10 @@ namespace Warp9.Native
                     fixed (nint* ppdata = &MemoryMarshal.GetReference(handles.AsSpan()))
                     fixed (Rigid3* pxforms = &MemoryMarshal.GetReference(xforms.AsSpan()))
                     fixed (byte* pmean = &MemoryMarshal.GetReference(mean.AsSpan()))
+                    fixed (float* perr = errors)
                     {
                         ret = (WarpCoreStatus)WarpCore.gpa_fit(
-                            (nint)ppdata, nint.Zero, d, n, specimenDataSize / 4 / d, (nint)pxforms, (nint)pmean, ref gpaRes);
+                            (nint)ppdata, nint.Zero, d, n, specimenDataSize / 4 / d, ref info, (nint)pxforms, (nint)pmean, (nint)perr, ref gpaRes);
                     }
                 }
             }
@@ -172,5 +284,65 @@ namespace Warp9.Native
 
             return ret;
         }
+
+        // Adds pcls[numOld..] to a GPA of pcls[0..numOld-1] that gave prevMean and prevTransforms.
+        public static WarpCoreStatus FitGpaIncremental(IReadOnlyList<PointCloud> pcls, int numOld, int[]? allowBitField, GpaInfo info, 
+            PointCloud prevMean, IReadOnlyList<Rigid3> prevTransforms, out PointCloud meanPcl, out Rigid3[] transforms, out GpaResult result, float[]? errors = null)
+        {
+            const int d = 3;
+            int n = pcls.Count;
+
+            if (numOld < 1 || numOld > n || prevTransforms.Count < numOld)
+                throw new ArgumentException("The previous GPA must cover the first numOld specimens.", nameof(numOld));
+
+            if (errors is not null && errors.Length < info.maxit)
+                throw new ArgumentException("The error history must hold maxit values.", nameof(errors));
+
+            if (!prevMean.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> prevMeanPos))
+                throw new ArgumentException("The previous mean has no positions.", nameof(prevMean));
+
+            BufferSegment<Vector3>[] pins = new BufferSegment<Vector3>[n];
+            nint[] handles = new nint[n];
+            for (int i = 0; i < n; i++)
+            {
+                pcls[i].TryGetData(MeshSegmentSemantic.Position, out pins[i]);
+                handles[i] = pins[i].Lock();
+            }
+
+            int specimenDataSize = pins[0].Length;
+            int nv = specimenDataSize / d / 4;
+
+            Rigid3[] xforms = new Rigid3[n];
+            for (int i = 0; i < numOld; i++)
+                xforms[i] = prevTransforms[i];
+
+            byte[] mean = new byte[specimenDataSize];
+            MemoryMarshal.AsBytes(prevMeanPos).CopyTo(mean);
+
+            GpaResult gpaRes = new GpaResult();
+            WarpCoreStatus ret;
+
+            unsafe
+            {
+                fixed (nint* ppdata = &MemoryMarshal.GetReference(handles.AsSpan()))
+                fixed (Rigid3* pxforms = &MemoryMarshal.GetReference(xforms.AsSpan()))
+                fixed (byte* pmean = &MemoryMarshal.GetReference(mean.AsSpan()))
+                fixed (int* pallow = allowBitField)
+                fixed (float* perr = errors)
+                {
+                    ret = (WarpCoreStatus)WarpCore.gpa_fit_incremental(
+                        (nint)ppdata, (nint)pallow, d, numOld, n, nv, ref info, (nint)pxforms, (nint)pmean, (nint)perr, ref gpaRes);
+                }
+            }
+
+            result = gpaRes;
+            transforms = xforms;
+            meanPcl = PointCloud.FromRawPositions(nv, mean);
+
+            for (int i = 0; i < n; i++)
+                pins[i].Unlock();
+
+            return ret;
+        }
     }
 }
@@ -48,7 +48,9 @@ namespace Warp9.Native
         WCORE_OK = 0,
         WCORE_INVALID_ARGUMENT = -1,
         WCORE_INVALID_DIMENSION = -2,
-        WCORE_NONCONVERGENCE = -3
+        WCORE_NONCONVERGENCE = -3,
+        WCORE_INVALID_DATA = -4,
+        WCORE_IO_ERROR = -5
     }
 
     [Flags]
@@ -72,7 +74,9 @@ namespace Warp9.Native
 
     public enum SEARCH_STRUCTURE : int
     {
-        SEARCH_TRIGRID3 = 0
+        SEARCH_TRIGRID3 = 0,
+        SEARCH_PCL_KDTREE = 1,
+        SEARCH_TRIGRID3_DISTFIELD = 2
     };
 
     public enum SEARCHD_KIND : int
@@ -88,13 +92,62 @@ namespace Warp9.Native
         SEARCH_NN_DPTBARY = 0,
         SEARCH_RAYCAST_T = 1,
         SEARCH_RAYCAST_TBARY = 2,
-
+        SEARCH_RAYCAST_NN_FALLBACK = 3,
+        SEARCH_KNN_PCL = 4,
+        SEARCH_RADIUS_PCL = 5,
+        SEARCH_SIGNED_DIST = 6,
+        SEARCH_SIGNED_DIST_EXACT = 7,
+        SEARCH_RAYCAST_MULTI = 8,
+
+        SEARCH_SEED_HINT = 0x04000000,
+        SEARCH_SEED_PREVIOUS = 0x08000000,
+        SEARCH_BIDIRECTIONAL = 0x10000000,
         SEARCH_INVERT_DIRECTION = 0x20000000
     };
 
     public enum SEARCH_INFO : int
     {
-        SEARCHINFO_AABB = 0
+        SEARCHINFO_AABB = 0,
+        SEARCHINFO_STATS = 1,
+        SEARCHINFO_CELL_HISTOGRAM = 2,
+        SEARCHINFO_MEMORY = 3
+    };
+
+    [Flags]
+    public enum TRIGRID_FLAGS : int
+    {
+        None = 0,
+        TRIGRID_QUANTIZED = 1
+    };
+
+    [Flags]
+    public enum DISTFIELD_FLAGS : int
+    {
+        None = 0,
+        DISTFIELD_STORE_TRIANGLES = 1
+    };
+
+    [Flags]
+    public enum SURFDIST_FLAGS : int
+    {
+        None = 0,
+        SURFDIST_SIGNED = 1
+    };
+
+    [Flags]
+    public enum ICP_FLAGS : int
+    {
+        None = 0,
+        ICP_POINT_TO_PLANE = 1,
+        ICP_FIT_SCALE = 2,
+        ICP_INIT_XFORM = 4
+    };
+
+    [Flags]
+    public enum GPA_FLAGS : int
+    {
+        None = 0,
+        GPA_ACCELERATE = 1
     };
 
     [Flags]
@@ -326,11 +379,20 @@ namespace Warp9.Native
         public Vector3 Center => new Vector3(xc, yc, zc);
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    public struct GpaInfo
+    {
+        public int maxit;
+        public float tol;
+        public int flags;
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     public struct GpaResult
     {
         public int iter;
         public float err;
+        public float shift;
 
         public readonly override string ToString()
         {
@@ -343,12 +405,97 @@ namespace Warp9.Native
     public struct TriGridConfig
     {
         public int num_cells;
+        public int flags;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct KdTreeConfig
+    {
+        public int leaf_size;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct DistFieldConfig
+    {
+        public float voxel_size;
+        public float band;
+        public int flags;
+        public long max_memory;
     }
 
     [StructLayout(LayoutKind.Sequential)]
     public struct SearchQueryConfig
     {
         public float max_dist;
+        public float max_ray_dist;
+        public int k;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SurfaceDistanceConfig
+    {
+        public int flags;
+        public float max_dist;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SurfaceDistanceSummary
+    {
+        public float hausdorff;
+        public float rms;
+        public int num_hits;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct IcpConfig
+    {
+        public int max_iter;
+        public int levels;
+        public int flags;
+        public float trim;
+        public float max_dist;
+        public float tol;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct IcpResult
+    {
+        public int iter;
+        public int num_inliers;
+        public float err;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct NicpConfig
+    {
+        public int stages;
+        public int max_iter;
+        public int cg_iter;
+        public float stiffness_init;
+        public float stiffness_final;
+        public float gamma;
+        public float trim;
+        public float max_dist;
+        public float tol;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SearchStats
+    {
+        public long queries;
+        public long cells_visited;
+        public long tris_tested;
+        public long early_outs;
+        public long max_dist_reached;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SearchMemory
+    {
+        public long total_bytes;
+        public long vertex_bytes;
+        public long index_bytes;
+        public long other_bytes;
     }
 
     [StructLayout(LayoutKind.Sequential)]
@@ -393,11 +540,17 @@ namespace Warp9.Native
         public static partial int cpd_process(ref CpdInfo cpd, nint x, nint y, nint init, nint t, ref CpdResult result);
 
         [LibraryImport("WarpCore")]
-        public static partial int gpa_fit(nint ppdata, nint pallow, int d, int n, int m, nint xforms, nint mean, ref GpaResult result);
+        public static partial int gpa_fit(nint ppdata, nint pallow, int d, int n, int m, ref GpaInfo info, nint xforms, nint mean, nint err, ref GpaResult result);
+
+        [LibraryImport("WarpCore")]
+        public static partial int gpa_fit_incremental(nint ppdata, nint pallow, int d, int nOld, int n, int m, ref GpaInfo info, nint xforms, nint mean, nint err, ref GpaResult result);
 
         [LibraryImport("WarpCore")]
         public static partial int rigid_transform(nint data, int d, int m, nint xforms, nint result);
 
+        [LibraryImport("WarpCore")]
+        public static partial int rigid_transform_batch(nint ppdata, int nx, int d, int n, int m, nint xforms, nint post, nint ppresult);
+
         [LibraryImport("WarpCore")]
         public static partial int pcl_stat(nint x, int d, int m, ref PclStat3 stat);
 
@@ -407,30 +560,66 @@ namespace Warp9.Native
         [LibraryImport("WarpCore")]
         public static partial int search_build(int structure, nint vert, nint idx, int nv, int nt, nint config, ref nint ctx);
 
+        [LibraryImport("WarpCore")]
+        public static partial int search_refit(nint ctx, nint vert);
+
         [LibraryImport("WarpCore")]
         public static partial int search_free(nint ctx);
 
+        [LibraryImport("WarpCore", StringMarshalling = StringMarshalling.Utf8)]
+        public static partial int search_save(nint ctx, string path);
+
+        [LibraryImport("WarpCore", StringMarshalling = StringMarshalling.Utf8)]
+        public static partial int search_load(string path, ref nint ctx);
+
         [LibraryImport("WarpCore")]
         public static partial int search_direct(int kind, nint orig, nint dir, nint vert, int n);
 
+        [LibraryImport("WarpCore")]
+        public static partial int search_direct_batch(int kind, nint orig, nint dir, nint vert, nint idx, int nv, int nt, int n, nint hit, nint info);
+
         [LibraryImport("WarpCore")]
         public static partial int search_query(nint ctx, int kind, ref SearchQueryConfig cfg, nint orig, nint dir, int n, nint hit, nint info);
 
+        [LibraryImport("WarpCore")]
+        public static partial int search_collect_stats(nint ctx, int enable);
+
         [LibraryImport("WarpCore")]
         public static partial int search_info(nint ctx, int kind, int param, nint res, int ressize);
 
+        [LibraryImport("WarpCore")]
+        public static partial int mesh_surface_distance(nint ctx, nint vert, nint idx, nint normals, int nv, int nt, nint src, int n, ref SurfaceDistanceConfig cfg, nint dist, nint hit, ref SurfaceDistanceSummary summary);
+
+        [LibraryImport("WarpCore")]
+        public static partial int icp_fit(nint ctx, nint vert, nint idx, int nv, int nt, nint src, int n, ref IcpConfig cfg, ref Rigid3 xform, ref IcpResult result);
+
+        [LibraryImport("WarpCore")]
+        public static partial int nicp_fit(nint ctx, nint vert, nint idx, int nv, int nt, nint templ, nint templIdx, int m, int mt, ref NicpConfig cfg, nint res, ref IcpResult result);
+
         [LibraryImport("WarpCore")]
         public static partial int clust_fit(nint x, int d, int n, int k, nint cent, nint label, int method);
 
         [LibraryImport("WarpCore")]
         public static partial int pca_fit(ref PcaInfo pca, nint ppdata, nint allow, nint pcs, nint lambda);
 
+        [LibraryImport("WarpCore")]
+        public static partial int pca_fit_stream(ref PcaInfo pca, nint read, nint user, nint allow, long maxMemory, nint pcs, nint lambda);
+
+        [LibraryImport("WarpCore", StringMarshalling = StringMarshalling.Utf8)]
+        public static partial int pca_fit_file(ref PcaInfo pca, string path, long offset, nint allow, long maxMemory, nint pcs, nint lambda);
+
         [LibraryImport("WarpCore")]
         public static partial int pca_data_to_scores(ref PcaInfo pca, nint data, nint pcs, nint allow, nint scores);
 
         [LibraryImport("WarpCore")]
         public static partial int pca_scores_to_data(ref PcaInfo pca, nint scores, nint pcs, nint data);
 
+        [LibraryImport("WarpCore")]
+        public static partial int pca_data_to_scores_batch(ref PcaInfo pca, nint ppdata, int count, nint pcs, nint allow, nint scores);
+
+        [LibraryImport("WarpCore")]
+        public static partial int pca_scores_to_data_batch(ref PcaInfo pca, nint scores, int count, nint pcs, nint data);
+
         [LibraryImport("WarpCore")]
         public static partial int pcl_impute(ref ImputeInfo info, nint data, nint templ, nint valid_mask);
 
@@ -8,11 +8,25 @@ namespace Warp9.Processing
 {
     public class GpaConfiguration
     {
+        public int MaxIterations { get; set; } = 150;
+        public float Tolerance { get; set; } = 1e-5f;
+        public bool Accelerate { get; set; } = false;
+        public int RefinementPasses { get; set; } = 3;
+
+        public GpaInfo ToGpaInfo(bool incremental = false)
+        {
+            return new GpaInfo
+            {
+                maxit = incremental ? RefinementPasses : MaxIterations,
+                tol = Tolerance,
+                flags = (int)(Accelerate ? GPA_FLAGS.GPA_ACCELERATE : GPA_FLAGS.None)
+            };
+        }
     }
 
     public class Gpa
     {
-        private Gpa(PointCloud[] pcls, Rigid3[] xforms, PointCloud mean, GpaResult res)
+        private Gpa(PointCloud[] pcls, Rigid3[] xforms, PointCloud mean, GpaResult res, float[] errors)
         {
             if (pcls.Length != xforms.Length)
                 throw new ArgumentException();
@@ -21,6 +35,7 @@ namespace Warp9.Processing
             pointClouds = pcls;
             transforms = xforms;
             result = res;
+            Errors = errors;
         }
 
         private PointCloud[] pointClouds;
@@ -28,6 +43,7 @@ namespace Warp9.Processing
         private GpaResult result;
 
         public PointCloud Mean { get; private init; }
+        public IReadOnlyList<float> Errors { get; private init; }
         public int NumData => pointClouds.Length;
         public int NumVertices => Mean.VertexCount;
 
@@ -51,10 +67,10 @@ namespace Warp9.Processing
             return transformed;
         }
 
+        // Transforms all specimens in one batch up front, rather than one by one as they are enumerated.
         public IEnumerable<PointCloud> EnumerateTransformed()
         {
-            for (int i = 0; i < pointClouds.Length; i++)
-                yield return GetTransformed(i);
+            return RigidTransform.TransformPosition(pointClouds, transforms);
         }
 
         public Rigid3 GetTransform(int idx)
@@ -68,13 +84,35 @@ namespace Warp9.Processing
 
         public static Gpa Fit(PointCloud[] data, int[]? allowBitField = null, GpaConfiguration? cfg = null)
         {
-            WarpCoreStatus s = RigidTransform.FitGpa(data, allowBitField, 
-                out PointCloud mean, out Rigid3[] xforms, out GpaResult res);
+            GpaInfo info = (cfg ?? new GpaConfiguration()).ToGpaInfo();
+            float[] errors = new float[info.maxit];
+            WarpCoreStatus s = RigidTransform.FitGpa(data, allowBitField, info,
+                out PointCloud mean, out Rigid3[] xforms, out GpaResult res, errors);
+
+            if (s != WarpCoreStatus.WCORE_OK)
+                throw new InvalidOperationException();
+
+            return new Gpa(data, xforms, mean, res, errors.AsSpan(0, Math.Min(res.iter + 1, info.maxit)).ToArray());
+        }
+
+        // Adds specimens to this analysis, warm starting from its mean and transforms. The result
+        // covers the old specimens followed by the new ones.
+        public Gpa Append(PointCloud[] data, int[]? allowBitField = null, GpaConfiguration? cfg = null)
+        {
+            PointCloud[] all = new PointCloud[pointClouds.Length + data.Length];
+            pointClouds.CopyTo(all, 0);
+            data.CopyTo(all, pointClouds.Length);
+
+            GpaInfo info = (cfg ?? new GpaConfiguration()).ToGpaInfo(true);
+            float[] errors = new float[info.maxit];
+            WarpCoreStatus s = RigidTransform.FitGpaIncremental(all, pointClouds.Length, allowBitField, info,
+                Mean, transforms, out PointCloud mean, out Rigid3[] xforms, out GpaResult res, errors);
 
             if (s != WarpCoreStatus.WCORE_OK)
                 throw new InvalidOperationException();
 
-            return new Gpa(data, xforms, mean, res);
+            int numErrors = info.maxit > 0 ? Math.Min(res.iter + 1, info.maxit) : 0;
+            return new Gpa(all, xforms, mean, res, errors.AsSpan(0, numErrors).ToArray());
         }
     }
 }
@@ -7,6 +7,7 @@ using System.Runtime.InteropServices;
 using System.Text;
 using System.Threading.Tasks;
 using Warp9.Data;
+using Warp9.Native;
 
 namespace Warp9.Processing
 {
@@ -169,5 +170,53 @@ namespace Warp9.Processing
                 result[i] = MathF.Abs(Vector3.Dot(pos1[i] - pos0[i], normal[i]));
             }
         }
+
+        // Distance from every vertex of pcl0 to the nearest point on the surface of target, computed in
+        // one native call. The meshes need not be homologous. Signed distances follow the convention
+        // of SignedSurfaceDistance. If ctx is a trigrid built on target, it is reused. Vertices with
+        // no surface within maxDist get NaN.
+        public static bool MeshSurfaceDistance(Span<float> result, PointCloud pcl0, Mesh target, bool signed, out SurfaceDistanceSummary summary, SearchContext? ctx = null, float maxDist = float.MaxValue)
+        {
+            summary = new SurfaceDistanceSummary();
+
+            if (result.Length != pcl0.VertexCount)
+                throw new InvalidOperationException("Result field not of correct size.");
+
+            if (!pcl0.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pos0) ||
+                !target.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pos1) ||
+                !target.TryGetIndexData(out ReadOnlySpan<FaceIndices> indices))
+            {
+                throw new InvalidOperationException("Cannot extract the position or index fields.");
+            }
+
+            // Per-vertex normals are optional, face normals are used otherwise.
+            if (!target.TryGetData(MeshSegmentSemantic.Normal, out ReadOnlySpan<Vector3> normal) ||
+                normal.Length != pos1.Length)
+                normal = ReadOnlySpan<Vector3>.Empty;
+
+            if (ctx is not null && ctx.StructureKind != SEARCH_STRUCTURE.SEARCH_TRIGRID3)
+                ctx = null;
+
+            SurfaceDistanceConfig cfg = new SurfaceDistanceConfig()
+            {
+                flags = signed ? (int)SURFDIST_FLAGS.SURFDIST_SIGNED : 0,
+                max_dist = maxDist
+            };
+
+            unsafe
+            {
+                fixed (Vector3* pos0Ptr = &MemoryMarshal.GetReference(pos0))
+                fixed (Vector3* pos1Ptr = &MemoryMarshal.GetReference(pos1))
+                fixed (FaceIndices* idxPtr = &MemoryMarshal.GetReference(indices))
+                fixed (Vector3* normalPtr = &MemoryMarshal.GetReference(normal))
+                fixed (float* resultPtr = &MemoryMarshal.GetReference(result))
+                {
+                    return WarpCoreStatus.WCORE_OK == (WarpCoreStatus)WarpCore.mesh_surface_distance(
+                        ctx?.NativeContext ?? nint.Zero, (nint)pos1Ptr, (nint)idxPtr, (nint)normalPtr,
+                        target.VertexCount, target.FaceCount, (nint)pos0Ptr, pcl0.VertexCount,
+                        ref cfg, (nint)resultPtr, nint.Zero, ref summary);
+                }
+            }
+        }
     }
 }
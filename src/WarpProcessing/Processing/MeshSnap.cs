@@ -71,7 +71,7 @@ namespace Warp9.Processing
             if (src.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pclNrPos) &&
                 src.TryGetData(MeshSegmentSemantic.Normal, out ReadOnlySpan<Vector3> pclNrNormal))
             {
-                if (!searchCtx.Nearest(pclNrPos, nv, 1e3f, hitIndexNN.AsSpan(), projNN.AsSpan()) ||
+                if (!searchCtx.Nearest(pclNrPos, nv, 1e3f, hitIndexNN.AsSpan(), projNN.AsSpan(), seedPrevious: true) ||
                     !searchCtx.Raycast(pclNrPos, pclNrNormal, nv, hitIndexRay0.AsSpan(), projRay0.AsSpan(), false) ||
                     !searchCtx.Raycast(pclNrPos, pclNrNormal, nv, hitIndexRay1.AsSpan(), projRay1.AsSpan(), true))
                     return null;
@@ -31,6 +31,16 @@ namespace Warp9.Test
             WarpCore.LimitOptimizationPath();
         }
 
+        private static void AssertPclEqual(PointCloud a, PointCloud b, float tol)
+        {
+            Assert.IsTrue(a.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pa));
+            Assert.IsTrue(b.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pb));
+            Assert.AreEqual(pa.Length, pb.Length);
+
+            for (int j = 0; j < pa.Length; j++)
+                Assert.IsTrue(Vector3.Distance(pa[j], pb[j]) < tol);
+        }
+
         private static void AssertMatrixEqual(Matrix4x4 expected, Matrix4x4 got, float tol = 1e-6f)
         {
             Matrix4x4 d = expected - got;
@@ -288,6 +298,108 @@ namespace Warp9.Test
                new TestRenderItem(TriStyle.PointCloud, gpa.GetTransformed(2), wireCol: Color.DarkBlue));
         }
 
+        [TestMethod]
+        public void GpaAcceleratedTest()
+        {
+            Mesh pcl1 = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            PointCloud[] pcls = new PointCloud[4] { 
+                pcl1,
+                DistortPcl(pcl1, new Vector3(0.5f, 0.2f, -0.1f), 0.80f, 0.25f),
+                DistortPcl(pcl1, Vector3.Zero, 1.10f, 0.1f),
+                DistortPcl(pcl1, new Vector3(-0.3f, 0.1f, 0.4f), 0.95f, 0.15f)
+            };
+
+            Gpa plain = Gpa.Fit(pcls, null, new GpaConfiguration() { Accelerate = false });
+            Gpa accel = Gpa.Fit(pcls, null, new GpaConfiguration() { Accelerate = true });
+            Console.WriteLine("plain: " + string.Join(", ", plain.Errors));
+            Console.WriteLine("accelerated: " + string.Join(", ", accel.Errors));
+
+            Assert.IsTrue(accel.Errors.Count <= plain.Errors.Count);
+
+            // The orientation of the mean is arbitrary, compare distances between the aligned specimens.
+            for (int i = 1; i < pcls.Length; i++)
+            {
+                Assert.IsTrue(plain.GetTransformed(0).TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pa0));
+                Assert.IsTrue(plain.GetTransformed(i).TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pai));
+                Assert.IsTrue(accel.GetTransformed(0).TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pb0));
+                Assert.IsTrue(accel.GetTransformed(i).TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pbi));
+
+                for (int j = 0; j < pa0.Length; j++)
+                    Assert.AreEqual(Vector3.Distance(pa0[j], pai[j]), Vector3.Distance(pb0[j], pbi[j]), 1e-3f);
+            }
+        }
+
+        [TestMethod]
+        public void GpaIncrementalTest()
+        {
+            Mesh pcl1 = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            PointCloud[] pcls = new PointCloud[3] {
+                pcl1,
+                DistortPcl(pcl1, new Vector3(0.5f, 0.2f, -0.1f), 0.80f, 0.25f),
+                DistortPcl(pcl1, Vector3.Zero, 1.10f, 0.1f)
+            };
+            PointCloud[] added = new PointCloud[1] {
+                DistortPcl(pcl1, new Vector3(-0.3f, 0.1f, 0.4f), 0.95f, 0.15f)
+            };
+
+            Gpa gpa = Gpa.Fit(pcls);
+            Gpa appended = gpa.Append(added);
+            Gpa full = Gpa.Fit(new PointCloud[4] { pcls[0], pcls[1], pcls[2], added[0] });
+            Console.WriteLine(appended.ToString());
+
+            Assert.AreEqual(4, appended.NumData);
+
+            // The orientation of the mean is arbitrary, compare distances between the aligned specimens.
+            Assert.IsTrue(appended.GetTransformed(0).TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pa0));
+            Assert.IsTrue(appended.GetTransformed(3).TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pa3));
+            Assert.IsTrue(full.GetTransformed(0).TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pb0));
+            Assert.IsTrue(full.GetTransformed(3).TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pb3));
+
+            for (int j = 0; j < pa0.Length; j++)
+                Assert.AreEqual(Vector3.Distance(pa0[j], pa3[j]), Vector3.Distance(pb0[j], pb3[j]), 1e-3f);
+        }
+
+        [TestMethod]
+        public void RigidTransformBatchTest()
+        {
+            Mesh pcl1 = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            PointCloud[] pcls = new PointCloud[3] {
+                pcl1,
+                DistortPcl(pcl1, new Vector3(0.5f, 0.2f, -0.1f), 0.80f, 0.25f),
+                DistortPcl(pcl1, Vector3.Zero, 1.10f, 0.1f)
+            };
+            Rigid3[] xforms = new Rigid3[3] {
+                Rigid3.Identity,
+                Rigid3.RotateAboutZ(0.3f),
+                new Rigid3(new Vector3(-1, -2, -4), 0.5f, Vector3.UnitX, Vector3.UnitY, Vector3.UnitZ)
+            };
+            Rigid3 post = Rigid3.RotateAboutZ(-0.2f) * Rigid3.Translation(new Vector3(0.1f, -0.05f, 0.2f));
+            Rigid3 postScaled = new Rigid3(new Vector3(0.3f, -0.1f, 0.2f), 1.7f, Vector3.UnitY, -Vector3.UnitX, Vector3.UnitZ);
+
+            PointCloud[] batch = RigidTransform.TransformPosition(pcls, xforms);
+            PointCloud[] batchPost = RigidTransform.TransformPosition(pcls, xforms, post);
+            PointCloud[] batchPostScaled = RigidTransform.TransformPosition(pcls, xforms, postScaled);
+            PointCloud[] batchShared = RigidTransform.TransformPosition(new PointCloud[1] { pcl1 }, xforms);
+
+            for (int i = 0; i < pcls.Length; i++)
+            {
+                PointCloud single = RigidTransform.TransformPosition(pcls[i], xforms[i])!;
+                PointCloud singlePost = RigidTransform.TransformPosition(single, post)!;
+                PointCloud singlePostScaled = RigidTransform.TransformPosition(single, postScaled)!;
+                PointCloud singleShared = RigidTransform.TransformPosition(pcl1, xforms[i])!;
+
+                AssertPclEqual(single, batch[i], 1e-5f);
+                AssertPclEqual(singlePost, batchPost[i], 1e-4f);
+                AssertPclEqual(singlePostScaled, batchPostScaled[i], 1e-4f);
+                AssertPclEqual(singleShared, batchShared[i], 1e-5f);
+            }
+
+            Assert.AreEqual(0, RigidTransform.TransformPosition(Array.Empty<PointCloud>(), Array.Empty<Rigid3>()).Length);
+            Assert.Throws<ArgumentException>(() => RigidTransform.TransformPosition(pcls, new Rigid3[2] { Rigid3.Identity, post }));
+            Assert.Throws<ArgumentException>(() => RigidTransform.TransformPosition(
+                new PointCloud[2] { pcl1, PointCloud.FromRawPositions(4, new byte[4 * 12]) }, new Rigid3[2] { Rigid3.Identity, post }));
+        }
+
         [TestMethod]
         public void OpaTeapotsTest()
         {
@@ -319,6 +431,56 @@ namespace Warp9.Test
                new TestRenderItem(TriStyle.PointCloud, pcl2a, wireCol: Color.Red));
         }
 
+        [TestMethod]
+        [DataRow(ICP_FLAGS.None, 0.0f)]
+        [DataRow(ICP_FLAGS.ICP_POINT_TO_PLANE, 0.0f)]
+        [DataRow(ICP_FLAGS.ICP_POINT_TO_PLANE, 0.1f)]
+        [DataRow(ICP_FLAGS.ICP_FIT_SCALE, 0.0f)]
+        public void IcpTeapotTest(ICP_FLAGS flags, float trim)
+        {
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            float scale = flags.HasFlag(ICP_FLAGS.ICP_FIT_SCALE) ? 1.1f : 1.0f;
+            Rigid3 gt = Rigid3.RotateAboutZ(0.15f) * Rigid3.Translation(new Vector3(0.1f, -0.05f, 0.2f));
+            PointCloud? pcl = RigidTransform.TransformPosition(mesh, scale * gt);
+            Assert.IsNotNull(pcl);
+
+            IcpConfig cfg = new IcpConfig() { flags = (int)flags, trim = trim };
+            Rigid3 xform = Rigid3.Identity;
+            WarpCoreStatus s = RigidTransform.FitIcp(mesh, pcl, cfg, null, ref xform, out IcpResult res);
+            Console.WriteLine(string.Format("it={0}, inliers={1}, err={2}", res.iter, res.num_inliers, res.err));
+
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, s);
+            Assert.IsTrue(res.err < 1e-4f);
+            Assert.AreEqual((1.0f - trim) * pcl.VertexCount, res.num_inliers, 1.0f);
+
+            PointCloud? pclBack = RigidTransform.TransformPosition(pcl, xform);
+            Assert.IsNotNull(pclBack);
+            ComparePcls(pclBack, mesh);
+        }
+
+        [TestMethod]
+        public void NicpTeapotTest()
+        {
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+
+            MeshBuilder mb = mesh.ToBuilder();
+            List<Vector3> pos = mb.GetSegmentForEditing<Vector3>(MeshSegmentSemantic.Position, false).Data;
+            for (int i = 0; i < pos.Count; i++)
+            {
+                (float s, float c) = MathF.SinCos(0.1f * pos[i].X);
+                pos[i] = new Vector3(pos[i].X, c * pos[i].Y - s * pos[i].Z, s * pos[i].Y + c * pos[i].Z);
+            }
+            Mesh templ = mb.ToMesh();
+
+            Vector3[] deformed = new Vector3[templ.VertexCount];
+            WarpCoreStatus st = NonRigidIcp.Fit(mesh, templ, new NicpConfig(), null, deformed.AsSpan(), out IcpResult res);
+            Console.WriteLine(string.Format("it={0}, inliers={1}, err={2}", res.iter, res.num_inliers, res.err));
+
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, st);
+            Assert.AreEqual(templ.VertexCount, res.num_inliers);
+            Assert.IsTrue(res.err < 5e-3f);
+        }
+
         [DoNotParallelize]
         [TestMethod]
         [DataRow(PCL_IMPUTE_METHOD.TPS_GRIDSEL, 2)]
@@ -474,6 +636,48 @@ namespace Warp9.Test
             TrigridRaycastTestCase("TrigridRaycast1Test_0.png", 1, 128);
         }
 
+        [TestMethod]
+        public void TrigridFineRaycastTest()
+        {
+            // Fine grids skip empty macro cells, the result must not change.
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctxCoarse);
+            SearchContext.TryInitTrigrid(mesh, 128, out SearchContext? ctxFine);
+            Assert.IsNotNull(ctxCoarse);
+            Assert.IsNotNull(ctxFine);
+
+            Vector3 camera = new Vector3(2.0f, 3.5f, 0.5f);
+            TestUtils.GenerateRays(camera, bitmapSize, bitmapSize, out Vector3[] p0, out Vector3[] d);
+            for (int i = 0; i < n; i++)
+                p0[i] += 1.5f * camera;
+
+            int[] hitCoarse = new int[n];
+            int[] hitFine = new int[n];
+            float[] tCoarse = new float[n];
+            float[] tFine = new float[n];
+            ctxCoarse.Raycast(p0.AsSpan(), d.AsSpan(), n, hitCoarse.AsSpan(), tCoarse.AsSpan());
+            ctxFine.Raycast(p0.AsSpan(), d.AsSpan(), n, hitFine.AsSpan(), tFine.AsSpan());
+
+            int numHit = 0;
+            for (int i = 0; i < n; i++)
+            {
+                Assert.AreEqual(hitCoarse[i] < 0, hitFine[i] < 0);
+                if (hitCoarse[i] >= 0)
+                {
+                    Assert.AreEqual(tCoarse[i], tFine[i], 1e-4f);
+                    numHit++;
+                }
+            }
+
+            Assert.IsTrue(numHit > 0);
+
+            ctxCoarse.Dispose();
+            ctxFine.Dispose();
+        }
+
         [TestMethod]
         public void TrigridNnBarycentricTest()
         {
@@ -598,6 +802,503 @@ namespace Warp9.Test
             TrigridNnTestCase("Trigrid1NnTest_0.png", 1, 128);
         }
 
+        [TestMethod]
+        [DataRow(1)]
+        [DataRow(16)]
+        public void TrigridRefitNnTest(int gridCells)
+        {
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, gridCells, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+
+            Assert.IsTrue(mesh.TryGetData(MeshSegmentSemantic.Position, out BufferSegment<Vector3>? seg));
+            Assert.IsNotNull(seg);
+
+            Vector3[] pos = new Vector3[seg.Count];
+            Vector3[] posDeformed = new Vector3[seg.Count];
+            Vector3 center = new Vector3(0.2f, 1.6f, 0);
+            for (int i = 0; i < seg.Count; i++)
+            {
+                pos[i] = seg[i];
+                posDeformed[i] = center + 0.8f * (pos[i] - center);
+            }
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0f), new Vector3(3.5f, 5.2f, 0f), new Vector3(-3.5f, -1.8f, 0f),
+                out Vector3[] pts);
+
+            int[] hit0 = new int[n];
+            int[] hit1 = new int[n];
+            ResultInfoDPtBary[] res0 = new ResultInfoDPtBary[n];
+            ResultInfoDPtBary[] res1 = new ResultInfoDPtBary[n];
+            ctx.Nearest(pts.AsSpan(), n, 1.0f, hit0.AsSpan(), res0.AsSpan());
+
+            // Shrink the mesh and bring it back. The grid must answer as if freshly built.
+            Assert.IsTrue(ctx.Refit(posDeformed.AsSpan()));
+            Assert.IsTrue(ctx.Refit(pos.AsSpan()));
+            ctx.Nearest(pts.AsSpan(), n, 1.0f, hit1.AsSpan(), res1.AsSpan());
+
+            for (int i = 0; i < n; i++)
+                Assert.AreEqual(res0[i].d, res1[i].d, 1e-5f);
+
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void TrigridSeededNnTest()
+        {
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0f), new Vector3(3.5f, 5.2f, 0f), new Vector3(-3.5f, -1.8f, 0f),
+                out Vector3[] pts);
+
+            int[] hit0 = new int[n];
+            int[] hit1 = new int[n];
+            int[] hit2 = new int[n];
+            ResultInfoDPtBary[] res0 = new ResultInfoDPtBary[n];
+            ResultInfoDPtBary[] res1 = new ResultInfoDPtBary[n];
+            ResultInfoDPtBary[] res2 = new ResultInfoDPtBary[n];
+            ctx.Nearest(pts.AsSpan(), n, 10.0f, hit0.AsSpan(), res0.AsSpan());
+            ctx.Nearest(pts.AsSpan(), n, 10.0f, hit1.AsSpan(), res1.AsSpan(), seedPrevious: true);
+
+            // Hints that are far off must not change the result either.
+            for (int i = 0; i < n; i++)
+                hit2[i] = hit0[n - 1 - i];
+            ctx.Nearest(pts.AsSpan(), n, 10.0f, hit2.AsSpan(), res2.AsSpan(), seedHint: true);
+
+            for (int i = 0; i < n; i++)
+            {
+                Assert.AreEqual(res0[i].d, res1[i].d, 1e-6f);
+                Assert.AreEqual(res0[i].d, res2[i].d, 1e-6f);
+            }
+
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void TrigridQuantizedTest()
+        {
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+            SearchContext.TryInitTrigrid(mesh, 16, true, out SearchContext? ctxq);
+            Assert.IsNotNull(ctxq);
+
+            Assert.IsTrue(ctx.TryGetMemory(out SearchMemory mem));
+            Assert.IsTrue(ctxq.TryGetMemory(out SearchMemory memq));
+            Assert.AreEqual(mem.index_bytes, memq.index_bytes);
+            Assert.IsTrue(memq.vertex_bytes < mem.vertex_bytes);
+            Assert.AreEqual(memq.total_bytes, memq.vertex_bytes + memq.index_bytes + memq.other_bytes);
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0f), new Vector3(3.5f, 5.2f, 0f), new Vector3(-3.5f, -1.8f, 0f),
+                out Vector3[] pts);
+
+            int[] hit = new int[n];
+            int[] hitq = new int[n];
+            ResultInfoDPtBary[] res = new ResultInfoDPtBary[n];
+            ResultInfoDPtBary[] resq = new ResultInfoDPtBary[n];
+            ctx.Nearest(pts.AsSpan(), n, 10.0f, hit.AsSpan(), res.AsSpan());
+            ctxq.Nearest(pts.AsSpan(), n, 10.0f, hitq.AsSpan(), resq.AsSpan());
+
+            for (int i = 0; i < n; i++)
+                Assert.AreEqual(res[i].d, resq[i].d, 1e-4f);
+
+            Vector3 camera = new Vector3(2.0f, 3.5f, 0.5f);
+            TestUtils.GenerateRays(camera, bitmapSize, bitmapSize, out Vector3[] p0, out Vector3[] d);
+            for (int i = 0; i < n; i++)
+                p0[i] += 1.5f * camera;
+
+            float[] t = new float[n];
+            float[] tq = new float[n];
+            ctx.Raycast(p0.AsSpan(), d.AsSpan(), n, hit.AsSpan(), t.AsSpan());
+            ctxq.Raycast(p0.AsSpan(), d.AsSpan(), n, hitq.AsSpan(), tq.AsSpan());
+
+            // Rays grazing the silhouette may go either way.
+            int mismatch = 0;
+            for (int i = 0; i < n; i++)
+            {
+                if ((hit[i] >= 0) != (hitq[i] >= 0))
+                    mismatch++;
+                else if (hit[i] >= 0 && hit[i] == hitq[i])
+                    Assert.AreEqual(t[i], tq[i], 1e-3f * (1 + t[i]));
+            }
+
+            Assert.IsTrue(mismatch < n / 1000);
+
+            ctx.Dispose();
+            ctxq.Dispose();
+        }
+
+        [TestMethod]
+        public void SearchDirectBatchTest()
+        {
+            const int bitmapSize = 64;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            Assert.IsTrue(mesh.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> vert));
+            Assert.IsTrue(mesh.TryGetIndexData(out ReadOnlySpan<FaceIndices> idx));
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0f), new Vector3(3.5f, 5.2f, 0f), new Vector3(-3.5f, -1.8f, 0f),
+                out Vector3[] pts);
+
+            int[] hit = new int[n];
+            float[] dist = new float[n];
+            int[] hitGrid = new int[n];
+            ResultInfoDPtBary[] resGrid = new ResultInfoDPtBary[n];
+            Assert.IsTrue(SearchContext.SearchDirect(SEARCHD_KIND.SEARCHD_NN_TRISOUP_3, vert, idx, pts.AsSpan(), ReadOnlySpan<Vector3>.Empty, n, hit.AsSpan(), dist.AsSpan()));
+            ctx.Nearest(pts.AsSpan(), n, 10.0f, hitGrid.AsSpan(), resGrid.AsSpan());
+
+            for (int i = 0; i < n; i++)
+                Assert.AreEqual(resGrid[i].d, dist[i], 1e-5f);
+
+            Assert.IsTrue(SearchContext.SearchDirect(SEARCHD_KIND.SEARCHD_NN_PCL_3, vert, ReadOnlySpan<FaceIndices>.Empty, pts.AsSpan(), ReadOnlySpan<Vector3>.Empty, n, hit.AsSpan(), dist.AsSpan()));
+            for (int i = 0; i < n; i += 37)
+            {
+                float best = float.MaxValue;
+                for (int j = 0; j < vert.Length; j++)
+                    best = MathF.Min(best, Vector3.Distance(vert[j], pts[i]));
+
+                Assert.AreEqual(best, dist[i], 1e-5f);
+                Assert.AreEqual(best, Vector3.Distance(vert[hit[i]], pts[i]), 1e-5f);
+            }
+
+            Assert.IsFalse(SearchContext.SearchDirect(SEARCHD_KIND.SEARCHD_NN_PCL_3, vert, ReadOnlySpan<FaceIndices>.Empty, pts.AsSpan(), ReadOnlySpan<Vector3>.Empty, n, hit.AsSpan(0, n - 1), dist.AsSpan()));
+            Assert.IsFalse(SearchContext.SearchDirect(SEARCHD_KIND.SEARCHD_RAYCAST_TRISOUP_3, vert, idx, pts.AsSpan(), ReadOnlySpan<Vector3>.Empty, n, hit.AsSpan(), dist.AsSpan()));
+
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void MeshSurfaceDistanceTest()
+        {
+            const int bitmapSize = 64;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0.5f), new Vector3(3.5f, 5.2f, 0.5f), new Vector3(-3.5f, -1.8f, 0.5f),
+                out Vector3[] pts);
+
+            MeshBuilder mb = new MeshBuilder();
+            mb.GetSegmentForEditing<Vector3>(MeshSegmentSemantic.Position, false).Data.AddRange(pts);
+            PointCloud pcl = mb.ToPointCloud();
+
+            int[] hit = new int[n];
+            ResultInfoDPtBary[] res = new ResultInfoDPtBary[n];
+            ctx.Nearest(pts.AsSpan(), n, 10.0f, hit.AsSpan(), res.AsSpan());
+
+            float[] dist = new float[n];
+            float[] distSigned = new float[n];
+            Assert.IsTrue(HomoMeshDiff.MeshSurfaceDistance(dist.AsSpan(), pcl, mesh, false, out SurfaceDistanceSummary summary));
+            Assert.IsTrue(HomoMeshDiff.MeshSurfaceDistance(distSigned.AsSpan(), pcl, mesh, true, out _, ctx));
+
+            for (int i = 0; i < n; i++)
+            {
+                Assert.AreEqual(res[i].d, dist[i], 1e-5f);
+                Assert.AreEqual(dist[i], MathF.Abs(distSigned[i]), 1e-5f);
+            }
+
+            Assert.AreEqual(n, summary.num_hits);
+            Assert.AreEqual(dist.Max(), summary.hausdorff, 1e-5f);
+
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void KdTreeKnnRadiusTest()
+        {
+            const int k = 6;
+            const float radius = 0.3f;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, SearchContext.TryInitKdTree(mesh, 16, out SearchContext? ctx));
+            Assert.IsNotNull(ctx);
+
+            Assert.IsTrue(mesh.TryGetData(MeshSegmentSemantic.Position, out ReadOnlySpan<Vector3> pos));
+            Vector3[] pts = pos.ToArray();
+            int n = pts.Length;
+
+            int[] hit = new int[n * k];
+            float[] dist = new float[n * k];
+            Assert.IsTrue(ctx.Knn(pts.AsSpan(), n, k, 10.0f, hit.AsSpan(), dist.AsSpan()));
+            Assert.IsTrue(ctx.Radius(pts.AsSpan(), n, radius, out int[] offsets, out int[] neighbours));
+
+            for (int i = 0; i < n; i += 37)
+            {
+                float[] bf = pts.Select((p) => Vector3.Distance(p, pts[i])).Order().ToArray();
+                for (int j = 0; j < k; j++)
+                    Assert.AreEqual(bf[j], dist[i * k + j], 1e-5f);
+
+                Assert.AreEqual(bf.Count((d) => d <= radius), offsets[i + 1] - offsets[i]);
+                for (int j = offsets[i]; j < offsets[i + 1]; j++)
+                    Assert.IsTrue(Vector3.Distance(pts[neighbours[j]], pts[i]) <= radius);
+            }
+
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void TrigridRaycastMultiTest()
+        {
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+
+            Vector3 camera = new Vector3(2.0f, 3.5f, 0.5f);
+            TestUtils.GenerateRays(camera, bitmapSize, bitmapSize, out Vector3[] p0, out Vector3[] d);
+            for (int i = 0; i < n; i++)
+                p0[i] += 1.5f * camera;
+
+            int[] hit = new int[n];
+            float[] t = new float[n];
+            ctx.Raycast(p0.AsSpan(), d.AsSpan(), n, hit.AsSpan(), t.AsSpan());
+
+            Assert.IsTrue(ctx.RaycastMulti(p0.AsSpan(), d.AsSpan(), n, 0, 0, out int[] offsAll, out SearchRayHit[] hitsAll));
+            Assert.IsTrue(ctx.RaycastMulti(p0.AsSpan(), d.AsSpan(), n, 2, 0, out int[] offs2, out SearchRayHit[] hits2));
+
+            for (int i = 0; i < n; i++)
+            {
+                int numAll = offsAll[i + 1] - offsAll[i];
+                int num2 = offs2[i + 1] - offs2[i];
+                Assert.AreEqual(Math.Min(2, numAll), num2);
+                Assert.AreEqual(hit[i] >= 0, numAll > 0);
+
+                // Raycast stops in the first cell that yields a hit, even if the hit lies beyond it, so
+                // the first of the multiple hits may be closer, never further.
+                if (numAll > 0)
+                    Assert.IsTrue(hitsAll[offsAll[i]].t <= t[i] + 1e-3f * (1 + t[i]));
+
+                for (int j = offsAll[i] + 1; j < offsAll[i + 1]; j++)
+                    Assert.IsTrue(hitsAll[j - 1].t <= hitsAll[j].t);
+
+                for (int j = 0; j < num2; j++)
+                    Assert.AreEqual(hitsAll[offsAll[i] + j].tri, hits2[offs2[i] + j].tri);
+            }
+
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void DistFieldTest()
+        {
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+            const float voxel = 0.05f;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, SearchContext.TryInitDistField(mesh, voxel, 3 * voxel, true, 0, out SearchContext? ctx));
+            Assert.IsNotNull(ctx);
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctxGrid));
+            Assert.IsNotNull(ctxGrid);
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0.5f), new Vector3(3.5f, 5.2f, 0.5f), new Vector3(-3.5f, -1.8f, 0.5f),
+                out Vector3[] pts);
+
+            int[] hit = new int[n];
+            float[] dist = new float[n];
+            float[] distExact = new float[n];
+            ResultInfoDPtBary[] res = new ResultInfoDPtBary[n];
+            Assert.IsTrue(ctx.SignedDistance(pts.AsSpan(), n, 10.0f, hit.AsSpan(), dist.AsSpan()));
+            Assert.IsTrue(ctx.SignedDistance(pts.AsSpan(), n, 10.0f, Span<int>.Empty, distExact.AsSpan(), true));
+            ctxGrid.Nearest(pts.AsSpan(), n, 10.0f, new int[n], res.AsSpan());
+
+            int numInBand = 0;
+            for (int i = 0; i < n; i++)
+            {
+                Assert.AreEqual(res[i].d, MathF.Abs(distExact[i]), 1e-5f);
+                // Interpolation across creases of the distance field may be off by about a voxel.
+                Assert.AreEqual(distExact[i], dist[i], 2 * voxel);
+                Assert.IsTrue(hit[i] >= 0);
+
+                if (MathF.Abs(distExact[i]) < 3 * voxel)
+                    numInBand++;
+            }
+
+            Assert.IsTrue(numInBand > 0);
+
+            ctx.Dispose();
+            ctxGrid.Dispose();
+        }
+
+        [TestMethod]
+        public void DistFieldBudgetTest()
+        {
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+
+            // Less than a single brick of samples can never fit, no matter how coarse the voxels are.
+            Assert.AreEqual(WarpCoreStatus.WCORE_INVALID_ARGUMENT,
+                SearchContext.TryInitDistField(mesh, 0.05f, 0.15f, true, 1024, out SearchContext? ctx));
+            Assert.IsNull(ctx);
+
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK,
+                SearchContext.TryInitDistField(mesh, 0.05f, 0.15f, true, 1 << 20, out ctx));
+            Assert.IsNotNull(ctx);
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void TrigridStatisticsTest()
+        {
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+
+            Assert.IsFalse(ctx.TryGetStatistics(out _));
+            Assert.IsTrue(ctx.CollectStatistics(true));
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0f), new Vector3(3.5f, 5.2f, 0f), new Vector3(-3.5f, -1.8f, 0f),
+                out Vector3[] pts);
+
+            int[] hit = new int[n];
+            ResultInfoDPtBary[] res = new ResultInfoDPtBary[n];
+            ctx.Nearest(pts.AsSpan(), n, 0.5f, hit.AsSpan(), res.AsSpan());
+
+            Assert.IsTrue(ctx.TryGetStatistics(out SearchStats stats));
+            Assert.AreEqual((long)n, stats.queries);
+            Assert.AreEqual((long)hit.Count((t) => t < 0), stats.max_dist_reached);
+            Assert.IsTrue(stats.cells_visited > 0);
+            Assert.IsTrue(stats.tris_tested > 0);
+
+            int[] hist = ctx.GetCellHistogram(8, 32);
+            Assert.AreEqual(16 * 16 * 16, hist.Sum());
+
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void TrigridRaycastFallbackTest()
+        {
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+            const float maxRayDist = 0.25f;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0.01f), new Vector3(3.5f, 5.2f, 0.01f), new Vector3(-3.5f, -1.8f, 0.01f),
+                out Vector3[] pts);
+
+            Vector3[] dirs = new Vector3[n];
+            Array.Fill(dirs, Vector3.UnitZ);
+
+            int[] hitNN = new int[n];
+            int[] hit = new int[n];
+            ResultInfoDPtBary[] resNN = new ResultInfoDPtBary[n];
+            ResultInfoDPtBary[] res = new ResultInfoDPtBary[n];
+            ctx.Nearest(pts.AsSpan(), n, 10.0f, hitNN.AsSpan(), resNN.AsSpan());
+            ctx.RaycastWithFallback(pts.AsSpan(), dirs.AsSpan(), n, maxRayDist, 10.0f, hit.AsSpan(), res.AsSpan());
+
+            int numRay = 0;
+            for (int i = 0; i < n; i++)
+            {
+                if (res[i].res1 == 1)
+                {
+                    // Ray hits must be within the limit, on the line and not closer than the nearest point.
+                    Assert.IsTrue(res[i].d <= maxRayDist);
+                    Assert.IsTrue(res[i].d >= resNN[i].d - 1e-5f);
+                    Assert.AreEqual(pts[i].X, res[i].x, 1e-5f);
+                    Assert.AreEqual(pts[i].Y, res[i].y, 1e-5f);
+                    numRay++;
+                }
+                else
+                {
+                    Assert.AreEqual(resNN[i].d, res[i].d, 1e-5f);
+                }
+
+                Assert.AreEqual(1.0f, res[i].u + res[i].v + res[i].res0, 1e-5f);
+            }
+
+            Assert.IsTrue(numRay > 0);
+            ctx.Dispose();
+        }
+
+        [TestMethod]
+        public void TrigridSaveLoadTest()
+        {
+            const int bitmapSize = 128;
+            const int n = bitmapSize * bitmapSize;
+
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+            SearchContext.TryInitTrigrid(mesh, 16, out SearchContext? ctx);
+            Assert.IsNotNull(ctx);
+
+            string path = Path.GetTempFileName();
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, ctx.Save(path));
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, SearchContext.TryLoad(path, out SearchContext? ctxLoaded));
+            Assert.IsNotNull(ctxLoaded);
+
+            TestUtils.GenerateGrid(bitmapSize, bitmapSize,
+                new Vector3(-3.5f, 5.2f, 0f), new Vector3(3.5f, 5.2f, 0f), new Vector3(-3.5f, -1.8f, 0f),
+                out Vector3[] pts);
+
+            int[] hit0 = new int[n];
+            int[] hit1 = new int[n];
+            ResultInfoDPtBary[] res0 = new ResultInfoDPtBary[n];
+            ResultInfoDPtBary[] res1 = new ResultInfoDPtBary[n];
+            ctx.Nearest(pts.AsSpan(), n, 1.0f, hit0.AsSpan(), res0.AsSpan());
+            ctxLoaded.Nearest(pts.AsSpan(), n, 1.0f, hit1.AsSpan(), res1.AsSpan());
+
+            for (int i = 0; i < n; i++)
+            {
+                Assert.AreEqual(hit0[i], hit1[i]);
+                Assert.AreEqual(res0[i].d, res1[i].d);
+            }
+
+            // Corrupt the first vertex index of the first triangle, its offset follows the 88 bytes of the
+            // header fields and the offsets of the cells, vertex and index blocks.
+            byte[] file = File.ReadAllBytes(path);
+            long offsTriIdx = BitConverter.ToInt64(file, 88 + 4 * 8);
+            BitConverter.GetBytes(mesh.VertexCount).CopyTo(file, offsTriIdx);
+            File.WriteAllBytes(path, file);
+            Assert.AreEqual(WarpCoreStatus.WCORE_INVALID_DATA, SearchContext.TryLoad(path, out SearchContext? ctxCorrupt));
+            Assert.IsNull(ctxCorrupt);
+
+            Assert.AreEqual(WarpCoreStatus.WCORE_IO_ERROR, ctx.Save(Path.Combine(path, "cannot", "exist.bin")));
+            Assert.AreEqual(WarpCoreStatus.WCORE_IO_ERROR, SearchContext.TryLoad(path + ".missing", out _));
+
+            string pathUnicode = Path.Combine(Path.GetTempPath(), "trigrid_\u017elu\u0165ou\u010dk\u00fd_\u4e09\u89d2.bin");
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, ctx.Save(pathUnicode));
+            Assert.IsTrue(File.Exists(pathUnicode));
+            Assert.AreEqual(WarpCoreStatus.WCORE_OK, SearchContext.TryLoad(pathUnicode, out SearchContext? ctxUnicode));
+            Assert.IsNotNull(ctxUnicode);
+            ctxUnicode.Dispose();
+            File.Delete(pathUnicode);
+
+            ctx.Dispose();
+            ctxLoaded.Dispose();
+            File.Delete(path);
+        }
+
         [TestMethod]
         [DataRow(1)]
         [DataRow(12)]
@@ -795,6 +1496,154 @@ namespace Warp9.Test
             BitmapAsserts.AssertEqual("PcaTest_0.png", bmpPcs);
         }
 
+        [TestMethod]
+        public void PcaTruncatedTest()
+        {
+            TestUtils.LoadBitmapAsFloatGrey("_lena256.png", out float[] bmpData, out int bmpHeight, out int bmpWidth);
+
+            const int NumPcs = 16;
+            Pca? pcaFull = Pca.Fit(bmpData, bmpWidth, true);
+            Pca? pcaTrunc = Pca.Fit(bmpData, bmpWidth, true, NumPcs);
+            Assert.IsNotNull(pcaFull);
+            Assert.IsNotNull(pcaTrunc);
+            Assert.AreEqual(NumPcs, pcaTrunc.NumPcs);
+            Assert.AreEqual(NumPcs, pcaTrunc.PcVariance.Length);
+
+            for (int i = 0; i < NumPcs; i++)
+            {
+                Assert.AreEqual(pcaFull.PcVariance[i], pcaTrunc.PcVariance[i], 1e-4f);
+
+                // The eigenvectors are only determined up to sign.
+                ReadOnlySpan<float> a = pcaFull.GetPrincipalComponent(i);
+                ReadOnlySpan<float> b = pcaTrunc.GetPrincipalComponent(i);
+                float dot = 0;
+                for (int j = 0; j < a.Length; j++)
+                    dot += a[j] * b[j];
+
+                Assert.AreEqual(1.0f, MathF.Abs(dot), 1e-3f);
+            }
+
+            float[] scores = new float[NumPcs];
+            float[] pred = new float[bmpWidth];
+            Assert.IsTrue(pcaTrunc.TryGetScores(bmpData.AsSpan(0, bmpWidth), scores));
+            Assert.IsTrue(pcaTrunc.TryPredict(scores, pred));
+            Assert.Throws<ArgumentOutOfRangeException>(() => pcaTrunc.Synthesize(pred, (NumPcs, 1.0f)));
+
+            Pca? pcaLoaded = Pca.FromMatrixCollection(pcaTrunc.ToMatrixCollection());
+            Assert.IsNotNull(pcaLoaded);
+            Assert.AreEqual(NumPcs, pcaLoaded.NumPcs);
+            Assert.AreEqual(bmpHeight, pcaLoaded.NumSourceData);
+        }
+
+        [TestMethod]
+        public void PcaStreamTest()
+        {
+            TestUtils.LoadBitmapAsFloatGrey("_lena256.png", out float[] bmpData, out int bmpHeight, out int bmpWidth);
+
+            const int NumPcs = 16;
+            int n = bmpHeight, m = bmpWidth;
+            Pca? pcaRef = Pca.Fit(bmpData, bmpWidth, true, NumPcs);
+            Assert.IsNotNull(pcaRef);
+
+            // A small memory limit forces many panels of rows.
+            int numReads = 0;
+            Pca? pcaStream = Pca.FitStream(n, m, (r0, r1, dest) =>
+            {
+                for (int i = 0; i < n; i++)
+                    bmpData.AsSpan(i * m + r0, r1 - r0).CopyTo(dest.Slice(i * (r1 - r0)));
+                numReads++;
+                return true;
+            }, null, true, NumPcs, 40 * n * sizeof(float));
+            Assert.IsNotNull(pcaStream);
+            Assert.AreEqual(3 * 7, numReads);
+
+            string path = Path.GetTempFileName();
+            try
+            {
+                using (FileStream fs = File.Create(path))
+                {
+                    fs.Write(new byte[64]);
+                    fs.Write(MemoryMarshal.AsBytes(bmpData.AsSpan()));
+                }
+
+                Pca? pcaFile = Pca.FitFile(path, 64, n, m, null, true, NumPcs);
+                Assert.IsNotNull(pcaFile);
+
+                Assert.IsNull(Pca.FitFile(path, 64, n + 1, m, null, true, NumPcs));
+
+                // The native side maps the file through a UTF-8 path.
+                string pathUnicode = Path.Combine(Path.GetTempPath(), "pca_\u010dt\u011bn\u00ed_\u4e3b\u6210\u5206.bin");
+                File.Copy(path, pathUnicode, true);
+                Pca? pcaUnicode = Pca.FitFile(pathUnicode, 64, n, m, null, true, NumPcs);
+                File.Delete(pathUnicode);
+                Assert.IsNotNull(pcaUnicode);
+                Assert.AreEqual(pcaFile.PcVariance[0], pcaUnicode.PcVariance[0]);
+                Assert.IsNull(Pca.FitStream(n, m, (r0, r1, dest) => r0 == 0));
+
+                foreach (Pca pca in new Pca[] { pcaStream, pcaFile })
+                {
+                    for (int j = 0; j < m; j++)
+                        Assert.AreEqual(pcaRef.GetMean()[j], pca.GetMean()[j], 1e-5f);
+
+                    for (int i = 0; i < NumPcs; i++)
+                    {
+                        Assert.AreEqual(pcaRef.PcVariance[i], pca.PcVariance[i], 1e-4f);
+
+                        ReadOnlySpan<float> a = pcaRef.GetPrincipalComponent(i);
+                        ReadOnlySpan<float> b = pca.GetPrincipalComponent(i);
+                        float dot = 0;
+                        for (int j = 0; j < a.Length; j++)
+                            dot += a[j] * b[j];
+
+                        Assert.AreEqual(1.0f, MathF.Abs(dot), 1e-3f);
+                    }
+                }
+            }
+            finally
+            {
+                File.Delete(path);
+            }
+        }
+
+        [TestMethod]
+        public void PcaBatchTest()
+        {
+            Mesh mesh = TestUtils.LoadObjAsset("teapot.obj", IO.ObjImportMode.PositionsOnly);
+
+            const int NumSpecimens = 12;
+            PointCloud[] pcls = new PointCloud[NumSpecimens];
+            for (int i = 0; i < NumSpecimens; i++)
+                pcls[i] = DistortPcl(mesh, new Vector3(0.1f * i, -0.05f * i, 0.02f * i * i), 1.0f + 0.03f * (i % 4), 0.1f + 0.02f * i);
+
+            bool[] allow = new bool[mesh.VertexCount];
+            for (int i = 0; i < allow.Length; i++)
+                allow[i] = (i % 7) != 3;
+
+            Pca? pca = Pca.Fit(pcls, allow);
+            Assert.IsNotNull(pca);
+
+            int npcs = pca.NumPcs;
+            int m = pca.Dimension;
+            float[] scores = new float[NumSpecimens * npcs];
+            Assert.IsTrue(pca.TryGetScores(pcls, scores));
+
+            float[] pred = new float[NumSpecimens * m];
+            Assert.IsTrue(pca.TryPredict(scores, NumSpecimens, pred));
+
+            float[] scores1 = new float[npcs];
+            float[] pred1 = new float[m];
+            for (int i = 0; i < NumSpecimens; i++)
+            {
+                Assert.IsTrue(pca.TryGetScores(pcls[i], scores1));
+                for (int j = 0; j < npcs; j++)
+                    Assert.AreEqual(scores1[j], scores[i * npcs + j], 1e-3f);
+
+                Assert.IsTrue(pca.TryPredict(scores1, pred1));
+                for (int j = 0; j < m; j++)
+                    Assert.AreEqual(pred1[j], pred[i * m + j], 1e-3f);
+            }
+        }
+
         private static Bitmap RoundtripPcaTrim(Pca pca, float[] bmpSrc, int height, int width, int numPcsKeep)
         {
             Lut lut = Lut.Create(256, Lut.GreyColors);